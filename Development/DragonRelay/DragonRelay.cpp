@@ -0,0 +1,970 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+/**
+ * dragon-relay, a headless relay between Dragonframe and any number of LiveLinkDragon nodes.
+ *
+ * Dragonframe sends to exactly one host:port and expects that host to answer its hello. Run this on that host,
+ * next to the stage, and list the render nodes. The relay answers the handshake once and re-emits every event
+ * to all nodes, so each of them sees the same stream without Dragonframe knowing about any of them.
+ *
+ *   g++ -O2 -std=c++17 -o dragon-relay DragonRelay.cpp
+ *   ./dragon-relay --listen 55555 --node 10.0.0.11:55555 --node 10.0.0.12:55555 --binary
+ *
+ * A node can also be a multicast group, e.g. --node 239.1.2.3:55555 with MulticastGroup set on the nodes.
+ *
+ * The relay only takes a host for Dragonframe once it says hello, which Dragonframe does whenever it starts sending,
+ * and ignores everyone else sending to the listen port. If Dragonframe is already running when the relay starts,
+ * or to shut out other hosts altogether, name it with --dragonframe.
+ *
+ * Commands (play, stepForward, ...) are only passed upstream from the primary node, which is the first unicast
+ * node unless --primary says otherwise. Hellos and viewFrameUpdates from the nodes are swallowed, the relay has
+ * already sent Dragonframe its own.
+ *
+ * With --binary, events go out in the compact framing from LiveLinkDragonBinaryProtocol.h, which gives the nodes
+ * sequence numbers and relay timestamps. Either way the relay pings every node and answers their pings, so the
+ * nodes clock sync against the relay and the relay can report the latency of each hop.
+ *
+ * Linux only, it relies on dual-stack sockets, sendmmsg and SO_TIMESTAMPNS.
+ */
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+//~ Binary framing, mirrors FDragonBinaryHeader in LiveLinkDragonBinaryProtocol.h
+
+constexpr uint32_t DragonMagic = 0x4E475244; // "DRGN"
+constexpr uint8_t DragonVersion = 1;
+constexpr size_t DragonHeaderSize = 20;
+
+enum class EDragonFrameType : uint8_t
+{
+	Event = 0x00,
+	Ping = 0x01,
+	Pong = 0x02,
+};
+
+struct FDragonHeader
+{
+	EDragonFrameType Type = EDragonFrameType::Event;
+	uint32_t Sequence = 0;
+	uint64_t SendTime = 0;
+
+	static bool Read(const uint8_t* Data, size_t DataSize, FDragonHeader& OutHeader)
+	{
+		uint32_t Magic = 0;
+		if (DataSize < DragonHeaderSize)
+		{
+			return false;
+		}
+		memcpy(&Magic, Data, sizeof(Magic));
+		if (Magic != DragonMagic || Data[4] != DragonVersion)
+		{
+			return false;
+		}
+
+		OutHeader.Type = static_cast<EDragonFrameType>(Data[5]);
+		memcpy(&OutHeader.Sequence, Data + 8, sizeof(OutHeader.Sequence));
+		memcpy(&OutHeader.SendTime, Data + 12, sizeof(OutHeader.SendTime));
+		return true;
+	}
+
+	void Write(uint8_t* Data) const
+	{
+		const uint32_t Magic = DragonMagic;
+		const uint16_t Flags = 0;
+		memcpy(Data, &Magic, sizeof(Magic));
+		Data[4] = DragonVersion;
+		Data[5] = static_cast<uint8_t>(Type);
+		memcpy(Data + 6, &Flags, sizeof(Flags));
+		memcpy(Data + 8, &Sequence, sizeof(Sequence));
+		memcpy(Data + 12, &SendTime, sizeof(SendTime));
+	}
+};
+
+//~ Time
+
+uint64_t NowNanoseconds()
+{
+	timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return uint64_t(Now.tv_sec) * 1000000000ull + uint64_t(Now.tv_nsec);
+}
+
+/** Moves a kernel arrival stamp (CLOCK_REALTIME) onto the monotonic clock everything else uses */
+uint64_t KernelToMonotonic(const timespec& KernelTime)
+{
+	const uint64_t MonotonicNow = NowNanoseconds();
+
+	timespec RealNow;
+	clock_gettime(CLOCK_REALTIME, &RealNow);
+
+	const int64_t Age = (int64_t(RealNow.tv_sec) - int64_t(KernelTime.tv_sec)) * 1000000000ll + (int64_t(RealNow.tv_nsec) - int64_t(KernelTime.tv_nsec));
+	return Age > 0 && uint64_t(Age) < MonotonicNow ? MonotonicNow - uint64_t(Age) : MonotonicNow;
+}
+
+/** Power-of-two microsecond buckets, like FLiveLinkDragonLatencyHistogram */
+struct FHistogram
+{
+	static constexpr int NumBuckets = 32;
+
+	uint64_t Buckets[NumBuckets] = {};
+	uint64_t Count = 0;
+
+	void Record(uint64_t Nanoseconds)
+	{
+		const uint64_t Microseconds = Nanoseconds / 1000;
+		int Bucket = 0;
+		while (Bucket < NumBuckets - 1 && (Microseconds >> (Bucket + 1)) != 0)
+		{
+			++Bucket;
+		}
+		++Buckets[Bucket];
+		++Count;
+	}
+
+	/** Upper edge of the bucket holding the percentile, in microseconds */
+	double Percentile(double Fraction) const
+	{
+		if (Count == 0)
+		{
+			return 0.0;
+		}
+
+		const uint64_t Target = std::max<uint64_t>(1, uint64_t(Fraction * double(Count) + 0.999999));
+		uint64_t Seen = 0;
+		for (int Bucket = 0; Bucket < NumBuckets; ++Bucket)
+		{
+			Seen += Buckets[Bucket];
+			if (Seen >= Target)
+			{
+				return double(uint64_t(1) << (Bucket + 1));
+			}
+		}
+		return double(uint64_t(1) << NumBuckets);
+	}
+};
+
+//~ Addresses, all sockets are dual-stack so IPv4 addresses are kept v4-mapped
+
+struct FEndpoint
+{
+	sockaddr_in6 Address = {};
+	bool bMatchPort = true;
+
+	bool IsMulticast() const
+	{
+		if (IN6_IS_ADDR_V4MAPPED(&Address.sin6_addr))
+		{
+			return (Address.sin6_addr.s6_addr[12] & 0xF0) == 0xE0;
+		}
+		return IN6_IS_ADDR_MULTICAST(&Address.sin6_addr);
+	}
+
+	bool Matches(const sockaddr_in6& Other) const
+	{
+		return memcmp(&Address.sin6_addr, &Other.sin6_addr, sizeof(in6_addr)) == 0
+			&& (!bMatchPort || Address.sin6_port == Other.sin6_port);
+	}
+};
+
+std::string ToString(const sockaddr_in6& Address)
+{
+	char Text[INET6_ADDRSTRLEN] = {};
+	if (IN6_IS_ADDR_V4MAPPED(&Address.sin6_addr))
+	{
+		inet_ntop(AF_INET, &Address.sin6_addr.s6_addr[12], Text, sizeof(Text));
+		return std::string(Text) + ":" + std::to_string(ntohs(Address.sin6_port));
+	}
+	inet_ntop(AF_INET6, &Address.sin6_addr, Text, sizeof(Text));
+	return "[" + std::string(Text) + "]:" + std::to_string(ntohs(Address.sin6_port));
+}
+
+/** Parses host:port, [v6]:port, or just a port when a default host is given. Host names are resolved. */
+bool ParseEndpoint(const std::string& Text, const char* DefaultHost, FEndpoint& OutEndpoint)
+{
+	std::string Host;
+	std::string Port;
+
+	if (!Text.empty() && Text[0] == '[')
+	{
+		const size_t Close = Text.find(']');
+		if (Close == std::string::npos)
+		{
+			return false;
+		}
+		Host = Text.substr(1, Close - 1);
+		if (Close + 1 < Text.size() && Text[Close + 1] == ':')
+		{
+			Port = Text.substr(Close + 2);
+		}
+	}
+	else
+	{
+		const size_t Colon = Text.rfind(':');
+		const bool bOnlyPort = Colon == std::string::npos && Text.find_first_not_of("0123456789") == std::string::npos;
+		if (bOnlyPort && DefaultHost)
+		{
+			Host = DefaultHost;
+			Port = Text;
+		}
+		else if (Colon == std::string::npos)
+		{
+			Host = Text;
+		}
+		else
+		{
+			Host = Text.substr(0, Colon);
+			Port = Text.substr(Colon + 1);
+		}
+	}
+
+	addrinfo Hints = {};
+	Hints.ai_family = AF_INET6;
+	Hints.ai_socktype = SOCK_DGRAM;
+	Hints.ai_flags = AI_V4MAPPED | AI_ADDRCONFIG | AI_NUMERICSERV;
+
+	addrinfo* Results = nullptr;
+	if (getaddrinfo(Host.c_str(), Port.empty() ? "0" : Port.c_str(), &Hints, &Results) != 0 || Results == nullptr)
+	{
+		return false;
+	}
+
+	memcpy(&OutEndpoint.Address, Results->ai_addr, sizeof(sockaddr_in6));
+	OutEndpoint.bMatchPort = !Port.empty();
+	freeaddrinfo(Results);
+	return true;
+}
+
+//~ JSON, just enough to read one string field out of a Dragonframe message without parsing all of it
+
+bool FindStringField(std::string_view Json, std::string_view Field, std::string_view& OutValue)
+{
+	size_t Search = 0;
+	while (true)
+	{
+		const size_t Key = Json.find(Field, Search);
+		if (Key == std::string_view::npos)
+		{
+			return false;
+		}
+		Search = Key + Field.size();
+
+		// Must be a whole quoted key followed by a colon
+		if (Key == 0 || Json[Key - 1] != '"' || Search >= Json.size() || Json[Search] != '"')
+		{
+			continue;
+		}
+
+		size_t Cursor = Search + 1;
+		while (Cursor < Json.size() && (Json[Cursor] == ' ' || Json[Cursor] == '\t' || Json[Cursor] == '\n' || Json[Cursor] == '\r'))
+		{
+			++Cursor;
+		}
+		if (Cursor >= Json.size() || Json[Cursor] != ':')
+		{
+			continue;
+		}
+
+		const size_t Open = Json.find('"', Cursor + 1);
+		if (Open == std::string_view::npos)
+		{
+			return false;
+		}
+		const size_t Close = Json.find('"', Open + 1);
+		if (Close == std::string_view::npos)
+		{
+			return false;
+		}
+		OutValue = Json.substr(Open + 1, Close - Open - 1);
+		return true;
+	}
+}
+
+//~ Relay
+
+struct FSettings
+{
+	FEndpoint Listen;
+	std::vector<FEndpoint> Nodes;
+	FEndpoint Primary;
+	bool bHasPrimary = false;
+	FEndpoint Dragonframe;
+	bool bHasDragonframe = false;
+	bool bBinary = false;
+	int MulticastTtl = 1;
+	double PingIntervalSeconds = 1.0;
+	double StatsIntervalSeconds = 5.0;
+};
+
+struct FNodeStats
+{
+	uint64_t PacketsSent = 0;
+	uint64_t SendErrors = 0;
+};
+
+/** Whoever answered our pings, per address. For a multicast node that's every member of the group. */
+struct FHopStats
+{
+	FHistogram RoundTrip;
+	uint64_t LastRoundTrip = 0;
+	uint64_t Pongs = 0;
+};
+
+volatile sig_atomic_t bStopRequested = 0;
+
+void OnSignal(int)
+{
+	bStopRequested = 1;
+}
+
+class FDragonRelay
+{
+public:
+
+	explicit FDragonRelay(const FSettings& InSettings)
+		: Settings(InSettings)
+		, NodeStats(InSettings.Nodes.size())
+	{
+	}
+
+	~FDragonRelay()
+	{
+		if (UpstreamSocket >= 0)
+		{
+			close(UpstreamSocket);
+		}
+		if (DownstreamSocket >= 0)
+		{
+			close(DownstreamSocket);
+		}
+	}
+
+	bool Open()
+	{
+		UpstreamSocket = OpenSocket(Settings.Listen.Address);
+		if (UpstreamSocket < 0)
+		{
+			fprintf(stderr, "dragon-relay: could not bind %s: %s\n", ToString(Settings.Listen.Address).c_str(), strerror(errno));
+			return false;
+		}
+
+		// Nodes talk to an ephemeral port of their own, so their replies never get mixed up with Dragonframe's events
+		sockaddr_in6 AnyAddress = {};
+		AnyAddress.sin6_family = AF_INET6;
+		AnyAddress.sin6_addr = in6addr_any;
+		DownstreamSocket = OpenSocket(AnyAddress);
+		if (DownstreamSocket < 0)
+		{
+			fprintf(stderr, "dragon-relay: could not open the node socket: %s\n", strerror(errno));
+			return false;
+		}
+
+		const int MulticastHops = Settings.MulticastTtl;
+		setsockopt(DownstreamSocket, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &MulticastHops, sizeof(MulticastHops));
+		setsockopt(DownstreamSocket, IPPROTO_IP, IP_MULTICAST_TTL, &MulticastHops, sizeof(MulticastHops));
+
+		// One message per node, all pointing at the same payload so an event is never copied per node
+		Messages.resize(Settings.Nodes.size());
+		for (size_t NodeIndex = 0; NodeIndex < Settings.Nodes.size(); ++NodeIndex)
+		{
+			msghdr& Message = Messages[NodeIndex].msg_hdr;
+			Message.msg_name = const_cast<sockaddr_in6*>(&Settings.Nodes[NodeIndex].Address);
+			Message.msg_namelen = sizeof(sockaddr_in6);
+			Message.msg_iov = EventVector;
+		}
+
+		return true;
+	}
+
+	void Run()
+	{
+		const uint64_t StartTime = NowNanoseconds();
+		NextPingTime = StartTime;
+		NextStatsTime = StartTime + SecondsToNanoseconds(Settings.StatsIntervalSeconds);
+		StatsWindowStart = StartTime;
+
+		pollfd Sockets[2] = {
+			{ UpstreamSocket, POLLIN, 0 },
+			{ DownstreamSocket, POLLIN, 0 },
+		};
+
+		while (!bStopRequested)
+		{
+			const uint64_t Now = NowNanoseconds();
+			const uint64_t NextTimer = std::min(Settings.PingIntervalSeconds > 0.0 ? NextPingTime : UINT64_MAX, NextStatsTime);
+			const int TimeoutMilliseconds = NextTimer > Now ? int(std::min<uint64_t>((NextTimer - Now) / 1000000 + 1, 100)) : 0;
+
+			if (poll(Sockets, 2, TimeoutMilliseconds) < 0 && errno != EINTR)
+			{
+				fprintf(stderr, "dragon-relay: poll failed: %s\n", strerror(errno));
+				break;
+			}
+
+			if (Sockets[0].revents & POLLIN)
+			{
+				ReceiveUpstream();
+			}
+			if (Sockets[1].revents & POLLIN)
+			{
+				ReceiveDownstream();
+			}
+
+			const uint64_t AfterReceive = NowNanoseconds();
+			if (Settings.PingIntervalSeconds > 0.0 && AfterReceive >= NextPingTime)
+			{
+				PingNodes(AfterReceive);
+				NextPingTime = AfterReceive + SecondsToNanoseconds(Settings.PingIntervalSeconds);
+			}
+			if (AfterReceive >= NextStatsTime)
+			{
+				PrintStats(AfterReceive);
+				NextStatsTime = AfterReceive + SecondsToNanoseconds(Settings.StatsIntervalSeconds);
+			}
+		}
+
+		PrintStats(NowNanoseconds());
+	}
+
+private:
+
+	static constexpr size_t MaxDatagramSize = 65507;
+
+	static uint64_t SecondsToNanoseconds(double Seconds)
+	{
+		return uint64_t(Seconds * 1.0e9);
+	}
+
+	static int OpenSocket(const sockaddr_in6& BindAddress)
+	{
+		const int Socket = socket(AF_INET6, SOCK_DGRAM, 0);
+		if (Socket < 0)
+		{
+			return -1;
+		}
+
+		const int Off = 0;
+		const int On = 1;
+		const int BufferSize = 1024 * 256;
+		setsockopt(Socket, IPPROTO_IPV6, IPV6_V6ONLY, &Off, sizeof(Off));
+		setsockopt(Socket, SOL_SOCKET, SO_REUSEADDR, &On, sizeof(On));
+		setsockopt(Socket, SOL_SOCKET, SO_TIMESTAMPNS, &On, sizeof(On));
+		setsockopt(Socket, SOL_SOCKET, SO_RCVBUF, &BufferSize, sizeof(BufferSize));
+		setsockopt(Socket, SOL_SOCKET, SO_SNDBUF, &BufferSize, sizeof(BufferSize));
+
+		if (bind(Socket, reinterpret_cast<const sockaddr*>(&BindAddress), sizeof(BindAddress)) != 0)
+		{
+			const int BindError = errno;
+			close(Socket);
+			errno = BindError;
+			return -1;
+		}
+		return Socket;
+	}
+
+	/** recvmsg with the kernel arrival time. Returns the datagram size, or -1. */
+	static ssize_t Receive(int Socket, uint8_t* Data, size_t Size, sockaddr_in6& OutSource, uint64_t& OutArrivalTime)
+	{
+		iovec Vector = { Data, Size };
+		alignas(cmsghdr) uint8_t Control[CMSG_SPACE(sizeof(timespec))];
+
+		msghdr Message = {};
+		Message.msg_name = &OutSource;
+		Message.msg_namelen = sizeof(OutSource);
+		Message.msg_iov = &Vector;
+		Message.msg_iovlen = 1;
+		Message.msg_control = Control;
+		Message.msg_controllen = sizeof(Control);
+
+		const ssize_t Result = recvmsg(Socket, &Message, MSG_DONTWAIT);
+		OutArrivalTime = NowNanoseconds();
+		if (Result < 0)
+		{
+			return -1;
+		}
+
+		for (cmsghdr* ControlMessage = CMSG_FIRSTHDR(&Message); ControlMessage != nullptr; ControlMessage = CMSG_NXTHDR(&Message, ControlMessage))
+		{
+			if (ControlMessage->cmsg_level == SOL_SOCKET && ControlMessage->cmsg_type == SCM_TIMESTAMPNS)
+			{
+				timespec KernelTime;
+				memcpy(&KernelTime, CMSG_DATA(ControlMessage), sizeof(KernelTime));
+				OutArrivalTime = KernelToMonotonic(KernelTime);
+				break;
+			}
+		}
+		return Result;
+	}
+
+	//~ Dragonframe side
+
+	void ReceiveUpstream()
+	{
+		sockaddr_in6 Source = {};
+		uint64_t ArrivalTime = 0;
+
+		// Leave room in front for the binary header, so framing never has to move the payload
+		const ssize_t Size = Receive(UpstreamSocket, EventBuffer + DragonHeaderSize, MaxDatagramSize, Source, ArrivalTime);
+		if (Size <= 0)
+		{
+			return;
+		}
+
+		const std::string_view Json(reinterpret_cast<const char*>(EventBuffer + DragonHeaderSize), size_t(Size));
+		std::string_view Event;
+		const bool bIsHello = FindStringField(Json, "event", Event) && Event == "hello";
+
+		// Anything can send to the listen port, only a hello (or the host named with --dragonframe) makes a sender
+		// Dragonframe. A hello from elsewhere is Dragonframe restarting, everything else from elsewhere is dropped.
+		const bool bIsDragonframe = bHasDragonframe && memcmp(&Source, &DragonframeAddress, sizeof(Source)) == 0;
+		if (!bIsDragonframe)
+		{
+			const bool bMayBeDragonframe = Settings.bHasDragonframe ? Settings.Dragonframe.Matches(Source) : bIsHello;
+			if (!bMayBeDragonframe)
+			{
+				++EventsRejected;
+				return;
+			}
+
+			printf("dragon-relay: Dragonframe is at %s\n", ToString(Source).c_str());
+			DragonframeAddress = Source;
+			bHasDragonframe = true;
+			bHandshook = false;
+		}
+
+		++EventsReceived;
+
+		// The first thing back after our hello closes the only round trip plain Dragonframe gives us
+		if (HandshakeSentTime != 0 && !bIsHello)
+		{
+			HandshakeRoundTrip = ArrivalTime > HandshakeSentTime ? ArrivalTime - HandshakeSentTime : 0;
+			HandshakeSentTime = 0;
+		}
+
+		// Answer a hello, or say hello ourselves if Dragonframe was already running when we started
+		if (bIsHello || !bHandshook)
+		{
+			SendHandshake();
+		}
+
+		// Hellos go out too, the nodes treat them as Dragonframe restarting
+		ForwardEvent(size_t(Size), ArrivalTime);
+	}
+
+	void SendHandshake()
+	{
+		static const char Hello[] = "{\"command\":\"hello\",\"version\":1,\"doNotPing\":true}";
+		static const char ViewFrameUpdates[] = "{\"command\":\"viewFrameUpdates\",\"active\":true}";
+
+		SendUpstream(reinterpret_cast<const uint8_t*>(Hello), sizeof(Hello) - 1);
+		SendUpstream(reinterpret_cast<const uint8_t*>(ViewFrameUpdates), sizeof(ViewFrameUpdates) - 1);
+
+		HandshakeSentTime = NowNanoseconds();
+		bHandshook = true;
+	}
+
+	bool SendUpstream(const uint8_t* Data, size_t Size)
+	{
+		if (!bHasDragonframe)
+		{
+			return false;
+		}
+		return sendto(UpstreamSocket, Data, Size, 0, reinterpret_cast<const sockaddr*>(&DragonframeAddress), sizeof(DragonframeAddress)) == ssize_t(Size);
+	}
+
+	void ForwardEvent(size_t PayloadSize, uint64_t ArrivalTime)
+	{
+		if (Messages.empty())
+		{
+			return;
+		}
+
+		uint8_t* Frame = EventBuffer + DragonHeaderSize;
+		size_t FrameSize = PayloadSize;
+		if (Settings.bBinary)
+		{
+			FDragonHeader Header;
+			Header.Type = EDragonFrameType::Event;
+			Header.Sequence = EventSequence++;
+			Header.SendTime = NowNanoseconds();
+			Header.Write(EventBuffer);
+
+			Frame = EventBuffer;
+			FrameSize += DragonHeaderSize;
+		}
+
+		EventVector[0].iov_base = Frame;
+		EventVector[0].iov_len = FrameSize;
+		for (mmsghdr& Message : Messages)
+		{
+			Message.msg_hdr.msg_iovlen = 1;
+			Message.msg_len = 0;
+		}
+
+		// sendmmsg stops at the first failing message, so step over it and carry on with the rest
+		size_t Next = 0;
+		while (Next < Messages.size())
+		{
+			const int Sent = sendmmsg(DownstreamSocket, Messages.data() + Next, unsigned(Messages.size() - Next), 0);
+			if (Sent < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				++NodeStats[Next].SendErrors;
+				++Next;
+				continue;
+			}
+
+			for (int Index = 0; Index < Sent; ++Index)
+			{
+				++NodeStats[Next + Index].PacketsSent;
+			}
+			Next += size_t(Sent);
+		}
+
+		RelayLatency.Record(NowNanoseconds() - ArrivalTime);
+	}
+
+	//~ Node side
+
+	void ReceiveDownstream()
+	{
+		sockaddr_in6 Source = {};
+		uint64_t ArrivalTime = 0;
+
+		const ssize_t Size = Receive(DownstreamSocket, CommandBuffer, sizeof(CommandBuffer), Source, ArrivalTime);
+		if (Size <= 0)
+		{
+			return;
+		}
+
+		FDragonHeader Header;
+		if (FDragonHeader::Read(CommandBuffer, size_t(Size), Header))
+		{
+			if (Header.Type == EDragonFrameType::Pong)
+			{
+				HandlePong(Source, CommandBuffer + DragonHeaderSize, size_t(Size) - DragonHeaderSize, ArrivalTime);
+			}
+			else if (Header.Type == EDragonFrameType::Ping)
+			{
+				AnswerPing(Source, Header, CommandBuffer + DragonHeaderSize, size_t(Size) - DragonHeaderSize, ArrivalTime);
+			}
+			return;
+		}
+
+		const std::string_view Json(reinterpret_cast<const char*>(CommandBuffer), size_t(Size));
+		std::string_view Command;
+		if (!FindStringField(Json, "command", Command))
+		{
+			++CommandsDropped;
+			return;
+		}
+
+		// Every node says hello when it hears Dragonframe's, the relay already did that for all of them
+		if (Command == "hello" || Command == "viewFrameUpdates")
+		{
+			++CommandsSwallowed;
+			return;
+		}
+
+		if (!Settings.bHasPrimary || !Settings.Primary.Matches(Source) || !SendUpstream(CommandBuffer, size_t(Size)))
+		{
+			++CommandsDropped;
+			return;
+		}
+
+		++CommandsForwarded;
+		CommandLatency.Record(NowNanoseconds() - ArrivalTime);
+	}
+
+	void PingNodes(uint64_t Now)
+	{
+		uint8_t Ping[DragonHeaderSize + sizeof(uint64_t)];
+
+		FDragonHeader Header;
+		Header.Type = EDragonFrameType::Ping;
+		Header.Sequence = PingSequence++;
+		Header.SendTime = Now;
+		Header.Write(Ping);
+		memcpy(Ping + DragonHeaderSize, &Now, sizeof(Now));
+
+		for (const FEndpoint& Node : Settings.Nodes)
+		{
+			sendto(DownstreamSocket, Ping, sizeof(Ping), 0, reinterpret_cast<const sockaddr*>(&Node.Address), sizeof(Node.Address));
+		}
+	}
+
+	void HandlePong(const sockaddr_in6& Source, const uint8_t* Payload, size_t PayloadSize, uint64_t ArrivalTime)
+	{
+		uint64_t OriginateTime = 0;
+		if (PayloadSize < sizeof(uint64_t) * 2)
+		{
+			return;
+		}
+		memcpy(&OriginateTime, Payload, sizeof(OriginateTime));
+
+		if (ArrivalTime <= OriginateTime)
+		{
+			return;
+		}
+
+		FHopStats& Hop = Hops[ToString(Source)];
+		Hop.LastRoundTrip = ArrivalTime - OriginateTime;
+		Hop.RoundTrip.Record(Hop.LastRoundTrip);
+		++Hop.Pongs;
+	}
+
+	/** Nodes ping whoever sends them binary frames, this lets them clock sync against the relay */
+	void AnswerPing(const sockaddr_in6& Source, const FDragonHeader& PingHeader, const uint8_t* Payload, size_t PayloadSize, uint64_t ArrivalTime)
+	{
+		if (PayloadSize < sizeof(uint64_t))
+		{
+			return;
+		}
+
+		uint8_t Pong[DragonHeaderSize + sizeof(uint64_t) * 2];
+
+		FDragonHeader Header;
+		Header.Type = EDragonFrameType::Pong;
+		Header.Sequence = PingHeader.Sequence;
+		Header.SendTime = NowNanoseconds();
+		Header.Write(Pong);
+		memcpy(Pong + DragonHeaderSize, Payload, sizeof(uint64_t));
+		memcpy(Pong + DragonHeaderSize + sizeof(uint64_t), &ArrivalTime, sizeof(ArrivalTime));
+
+		sendto(DownstreamSocket, Pong, sizeof(Pong), 0, reinterpret_cast<const sockaddr*>(&Source), sizeof(Source));
+	}
+
+	//~ Reporting
+
+	void PrintStats(uint64_t Now)
+	{
+		const double WindowSeconds = double(Now - StatsWindowStart) * 1.0e-9;
+		const double EventRate = WindowSeconds > 0.0 ? double(EventsReceived - WindowEvents) / WindowSeconds : 0.0;
+		WindowEvents = EventsReceived;
+		StatsWindowStart = Now;
+
+		printf("dragon-relay: %llu events (%.1f/s) from %s, %llu from others rejected, handshake rtt %.2f ms, in relay p50/p99 %.0f/%.0f us, commands %llu forwarded (p50 %.0f us), %llu swallowed, %llu dropped\n",
+			static_cast<unsigned long long>(EventsReceived), EventRate,
+			bHasDragonframe ? ToString(DragonframeAddress).c_str() : "nobody yet",
+			static_cast<unsigned long long>(EventsRejected),
+			double(HandshakeRoundTrip) * 1.0e-6,
+			RelayLatency.Percentile(0.5), RelayLatency.Percentile(0.99),
+			static_cast<unsigned long long>(CommandsForwarded), CommandLatency.Percentile(0.5),
+			static_cast<unsigned long long>(CommandsSwallowed),
+			static_cast<unsigned long long>(CommandsDropped));
+
+		for (size_t NodeIndex = 0; NodeIndex < Settings.Nodes.size(); ++NodeIndex)
+		{
+			const FEndpoint& Node = Settings.Nodes[NodeIndex];
+			printf("  node %s%s: %llu sent, %llu send errors\n",
+				ToString(Node.Address).c_str(),
+				Settings.bHasPrimary && Settings.Primary.Matches(Node.Address) ? " (primary)" : "",
+				static_cast<unsigned long long>(NodeStats[NodeIndex].PacketsSent),
+				static_cast<unsigned long long>(NodeStats[NodeIndex].SendErrors));
+		}
+
+		// One way is taken as half the round trip, the nodes' own clock sync has the finer picture
+		for (const auto& [Address, Hop] : Hops)
+		{
+			printf("  hop to %s: one way p50/p99 %.0f/%.0f us, last rtt %.0f us, %llu pongs\n",
+				Address.c_str(),
+				Hop.RoundTrip.Percentile(0.5) * 0.5, Hop.RoundTrip.Percentile(0.99) * 0.5,
+				double(Hop.LastRoundTrip) * 1.0e-3,
+				static_cast<unsigned long long>(Hop.Pongs));
+		}
+		fflush(stdout);
+	}
+
+private:
+
+	const FSettings Settings;
+
+	int UpstreamSocket = -1;
+	int DownstreamSocket = -1;
+
+	sockaddr_in6 DragonframeAddress = {};
+	bool bHasDragonframe = false;
+	bool bHandshook = false;
+	uint64_t HandshakeSentTime = 0;
+	uint64_t HandshakeRoundTrip = 0;
+
+	alignas(8) uint8_t EventBuffer[DragonHeaderSize + MaxDatagramSize];
+	alignas(8) uint8_t CommandBuffer[MaxDatagramSize];
+	iovec EventVector[1] = {};
+	std::vector<mmsghdr> Messages;
+
+	uint32_t EventSequence = 0;
+	uint32_t PingSequence = 0;
+	uint64_t NextPingTime = 0;
+	uint64_t NextStatsTime = 0;
+
+	std::vector<FNodeStats> NodeStats;
+	std::map<std::string, FHopStats> Hops;
+
+	uint64_t EventsReceived = 0;
+	uint64_t EventsRejected = 0;	// sent to the listen port by something that isn't Dragonframe
+	uint64_t CommandsForwarded = 0;
+	uint64_t CommandsSwallowed = 0;
+	uint64_t CommandsDropped = 0;
+	FHistogram RelayLatency;	// kernel arrival from Dragonframe to sent to every node
+	FHistogram CommandLatency;	// kernel arrival from the primary to sent to Dragonframe
+
+	uint64_t StatsWindowStart = 0;
+	uint64_t WindowEvents = 0;
+};
+
+void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: dragon-relay --node HOST:PORT [--node HOST:PORT ...] [options]\n"
+		"  --listen [HOST:]PORT   where Dragonframe sends to, default 55555\n"
+		"  --node HOST:PORT       a LiveLinkDragon node or multicast group, repeatable\n"
+		"  --primary HOST[:PORT]  the node whose commands go to Dragonframe, default the first unicast node\n"
+		"  --dragonframe HOST[:PORT]  only take events from here, default whoever says hello first\n"
+		"  --binary               send events in the compact binary framing\n"
+		"  --ttl N                multicast TTL, default 1\n"
+		"  --ping SECONDS         how often to ping the nodes for hop latency, 0 to disable, default 1\n"
+		"  --stats SECONDS        how often to print statistics, default 5\n");
+}
+
+bool ParseArguments(int ArgCount, char** Args, FSettings& OutSettings)
+{
+	ParseEndpoint("55555", "::", OutSettings.Listen);
+
+	for (int Index = 1; Index < ArgCount; ++Index)
+	{
+		const std::string Arg = Args[Index];
+		const bool bHasValue = Index + 1 < ArgCount;
+
+		if (Arg == "--binary")
+		{
+			OutSettings.bBinary = true;
+		}
+		else if (Arg == "--listen" && bHasValue)
+		{
+			if (!ParseEndpoint(Args[++Index], "::", OutSettings.Listen))
+			{
+				fprintf(stderr, "dragon-relay: bad listen address %s\n", Args[Index]);
+				return false;
+			}
+		}
+		else if (Arg == "--node" && bHasValue)
+		{
+			FEndpoint Node;
+			if (!ParseEndpoint(Args[++Index], nullptr, Node) || !Node.bMatchPort)
+			{
+				fprintf(stderr, "dragon-relay: bad node address %s, expected HOST:PORT\n", Args[Index]);
+				return false;
+			}
+			OutSettings.Nodes.push_back(Node);
+		}
+		else if (Arg == "--primary" && bHasValue)
+		{
+			if (!ParseEndpoint(Args[++Index], nullptr, OutSettings.Primary))
+			{
+				fprintf(stderr, "dragon-relay: bad primary address %s\n", Args[Index]);
+				return false;
+			}
+			OutSettings.bHasPrimary = true;
+		}
+		else if (Arg == "--dragonframe" && bHasValue)
+		{
+			if (!ParseEndpoint(Args[++Index], nullptr, OutSettings.Dragonframe))
+			{
+				fprintf(stderr, "dragon-relay: bad Dragonframe address %s\n", Args[Index]);
+				return false;
+			}
+			OutSettings.bHasDragonframe = true;
+		}
+		else if (Arg == "--ttl" && bHasValue)
+		{
+			OutSettings.MulticastTtl = atoi(Args[++Index]);
+		}
+		else if (Arg == "--ping" && bHasValue)
+		{
+			OutSettings.PingIntervalSeconds = atof(Args[++Index]);
+		}
+		else if (Arg == "--stats" && bHasValue)
+		{
+			OutSettings.StatsIntervalSeconds = std::max(0.1, atof(Args[++Index]));
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	if (OutSettings.Nodes.empty())
+	{
+		return false;
+	}
+
+	if (!OutSettings.bHasPrimary)
+	{
+		for (const FEndpoint& Node : OutSettings.Nodes)
+		{
+			if (!Node.IsMulticast())
+			{
+				OutSettings.Primary = Node;
+				OutSettings.bHasPrimary = true;
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+} // namespace
+
+int main(int ArgCount, char** Args)
+{
+	FSettings Settings;
+	if (!ParseArguments(ArgCount, Args, Settings))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+
+	// Big buffers, keep them off the stack
+	FDragonRelay* Relay = new FDragonRelay(Settings);
+	if (!Relay->Open())
+	{
+		delete Relay;
+		return 1;
+	}
+
+	printf("dragon-relay: listening on %s, relaying to %zu node(s)%s%s\n",
+		ToString(Settings.Listen.Address).c_str(), Settings.Nodes.size(),
+		Settings.bBinary ? " in binary framing" : "",
+		Settings.bHasPrimary ? (", primary " + ToString(Settings.Primary.Address)).c_str() : ", no primary");
+
+	Relay->Run();
+	delete Relay;
+	return 0;
+}
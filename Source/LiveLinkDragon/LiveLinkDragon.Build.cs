@@ -1,5 +1,6 @@
 // Copyright (c) RITMPS, Rochester Institute of Technology, 2022
 
+using System.IO;
 using UnrealBuildTool;
 
 public class LiveLinkDragon : ModuleRules
@@ -11,6 +12,7 @@ public class LiveLinkDragon : ModuleRules
 		PublicDependencyModuleNames.AddRange(
 			new string[]
 			{
+				"Engine",
 				"LiveLinkInterface"
 			});
 
@@ -20,9 +22,25 @@ public class LiveLinkDragon : ModuleRules
 			{
 				"Core",
 				"CoreUObject",
+				"ImageWrapper",
 				"Json",
 				"Networking",
+				"RenderCore",
+				"RHI",
 				"Sockets"
 			});
+
+		// Kernel receive timestamps need the native socket handle, which only the BSD socket implementation exposes.
+		// That is engine internals, so only go there if this engine still has it, everything else uses plain FSocket reads.
+		string SocketsBSDHeader = Path.Combine(EngineDirectory, "Source/Runtime/Sockets/Private/BSDSockets/SocketsBSD.h");
+		if (Target.Platform == UnrealTargetPlatform.Linux && File.Exists(SocketsBSDHeader))
+		{
+			PrivateIncludePaths.Add(Path.Combine(EngineDirectory, "Source/Runtime/Sockets/Private"));
+			PrivateDefinitions.Add("LIVELINKDRAGON_KERNEL_TIMESTAMPS=1");
+		}
+		else
+		{
+			PrivateDefinitions.Add("LIVELINKDRAGON_KERNEL_TIMESTAMPS=0");
+		}
 	}
 }
@@ -1,5 +1,28 @@
 // Copyright (c) RITMPS, Rochester Institute of Technology, 2022
 
 #include "Modules/ModuleManager.h"
+
+#include "LiveLinkDragonCaptureEvents.h"
+#include "LiveLinkDragonStats.h"
+
+DEFINE_STAT(STAT_DragonPacketsReceived);
+DEFINE_STAT(STAT_DragonPacketsLost);
+DEFINE_STAT(STAT_DragonPacketsReordered);
+DEFINE_STAT(STAT_DragonPacketsDuplicated);
+DEFINE_STAT(STAT_DragonStaleUpdatesDropped);
+DEFINE_STAT(STAT_DragonPacketsFiltered);
+DEFINE_STAT(STAT_DragonEventsCoalesced);
 	
+FOnLiveLinkDragonCapture& FLiveLinkDragonCaptureEvents::OnCapture()
+{
+	static FOnLiveLinkDragonCapture OnCaptureDelegate;
+	return OnCaptureDelegate;
+}
+
+FOnLiveLinkDragonCaptureAnyThread& FLiveLinkDragonCaptureEvents::OnCapture_AnyThread()
+{
+	static FOnLiveLinkDragonCaptureAnyThread OnCaptureDelegate;
+	return OnCaptureDelegate;
+}
+
 IMPLEMENT_MODULE(FDefaultModuleImpl, LiveLinkDragon)
\ No newline at end of file
@@ -0,0 +1,85 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Compact framing spoken by bridges and relays sitting in front of Dragonframe.
+ * Dragonframe itself only sends bare JSON, so a datagram is binary only if it starts with the magic.
+ *
+ * Layout, little endian:
+ *   uint32 Magic        'DRGN'
+ *   uint8  Version
+ *   uint8  Type         EDragonFrameType
+ *   uint16 Flags        reserved, zero
+ *   uint32 Sequence     per-sender, increments by one for every Event frame. Pings and pongs number their own.
+ *   uint64 SendTime     sender's clock, nanoseconds
+ *   ...payload          Event: the JSON text, Ping: uint64 OriginateTime, Pong: uint64 OriginateTime, uint64 ReceiveTime
+ *
+ * Either side may ping, a pong echoes the ping's sequence. Nodes ping their bridge for clock sync and a relay
+ * pings its nodes to measure each hop.
+ */
+enum class EDragonFrameType : uint8
+{
+	Event = 0x00,
+	Ping = 0x01,
+	Pong = 0x02,
+};
+
+struct FDragonBinaryHeader
+{
+	static constexpr uint32 Magic = 0x4E475244; // "DRGN"
+	static constexpr uint8 CurrentVersion = 1;
+	static constexpr int32 Size = 20;
+
+	uint8 Version = CurrentVersion;
+	EDragonFrameType Type = EDragonFrameType::Event;
+	uint16 Flags = 0;
+	uint32 Sequence = 0;
+	uint64 SendTime = 0;
+
+	/** Returns false if the datagram is not binary framed */
+	static bool Read(const uint8* Data, int32 DataSize, FDragonBinaryHeader& OutHeader)
+	{
+		if (DataSize < Size)
+		{
+			return false;
+		}
+
+		uint32 ReadMagic = 0;
+		FMemory::Memcpy(&ReadMagic, Data, sizeof(ReadMagic));
+		if (ReadMagic != Magic)
+		{
+			return false;
+		}
+
+		OutHeader.Version = Data[4];
+		OutHeader.Type = static_cast<EDragonFrameType>(Data[5]);
+		FMemory::Memcpy(&OutHeader.Flags, Data + 6, sizeof(OutHeader.Flags));
+		FMemory::Memcpy(&OutHeader.Sequence, Data + 8, sizeof(OutHeader.Sequence));
+		FMemory::Memcpy(&OutHeader.SendTime, Data + 12, sizeof(OutHeader.SendTime));
+		return OutHeader.Version == CurrentVersion;
+	}
+
+	void Write(uint8* Data) const
+	{
+		const uint32 WriteMagic = Magic;
+		FMemory::Memcpy(Data, &WriteMagic, sizeof(WriteMagic));
+		Data[4] = Version;
+		Data[5] = static_cast<uint8>(Type);
+		FMemory::Memcpy(Data + 6, &Flags, sizeof(Flags));
+		FMemory::Memcpy(Data + 8, &Sequence, sizeof(Sequence));
+		FMemory::Memcpy(Data + 12, &SendTime, sizeof(SendTime));
+	}
+};
+
+static inline uint64 DragonSecondsToNanoseconds(double Seconds)
+{
+	return static_cast<uint64>(Seconds * 1.0e9);
+}
+
+static inline double DragonNanosecondsToSeconds(uint64 Nanoseconds)
+{
+	return static_cast<double>(Nanoseconds) * 1.0e-9;
+}
@@ -0,0 +1,128 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonCaptureJournal.h"
+
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+
+FLiveLinkDragonCaptureIndex::~FLiveLinkDragonCaptureIndex()
+{
+	Close();
+}
+
+FString FLiveLinkDragonCaptureIndex::GetTakePath(const FString& JournalDirectory, const FString& Production, const FString& Scene, const FString& Take)
+{
+	auto PathPart = [](const FString& Part)
+	{
+		return Part.IsEmpty() ? FString(TEXT("Unnamed")) : FPaths::MakeValidFileName(Part, TEXT('_'));
+	};
+
+	const FString Directory = JournalDirectory.IsEmpty() ? GetDefaultJournalDirectory() : JournalDirectory;
+	return FPaths::Combine(Directory, PathPart(Production), PathPart(Scene), PathPart(Take));
+}
+
+FString FLiveLinkDragonCaptureIndex::GetDefaultJournalDirectory()
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("LiveLinkDragon"), TEXT("Journal"));
+}
+
+bool FLiveLinkDragonCaptureIndex::Open(const FString& InTakePath)
+{
+	Close();
+	TakePath = InTakePath;
+	return Refresh();
+}
+
+void FLiveLinkDragonCaptureIndex::Close()
+{
+	// Regions before the handles they were mapped from
+	JournalRegion.Reset();
+	IndexRegion.Reset();
+	JournalHandle.Reset();
+	IndexHandle.Reset();
+}
+
+bool FLiveLinkDragonCaptureIndex::Refresh()
+{
+	const FString Path = TakePath;
+	Close();
+	TakePath = Path;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	auto MapFile = [&PlatformFile](const FString& Filename, uint32 Magic, uint32 RecordSize, TUniquePtr<IMappedFileHandle>& OutHandle, TUniquePtr<IMappedFileRegion>& OutRegion)
+	{
+		OutHandle.Reset(PlatformFile.OpenMapped(*Filename));
+		if (!OutHandle.IsValid() || OutHandle->GetFileSize() < static_cast<int64>(sizeof(FDragonCaptureFileHeader)))
+		{
+			OutHandle.Reset();
+			return false;
+		}
+
+		OutRegion.Reset(OutHandle->MapRegion(0, OutHandle->GetFileSize()));
+		if (!OutRegion.IsValid())
+		{
+			OutHandle.Reset();
+			return false;
+		}
+
+		const FDragonCaptureFileHeader* Header = reinterpret_cast<const FDragonCaptureFileHeader*>(OutRegion->GetMappedPtr());
+		if (Header->Magic != Magic || Header->Version != FDragonCaptureFileHeader::CurrentVersion || Header->RecordSize != RecordSize)
+		{
+			OutRegion.Reset();
+			OutHandle.Reset();
+			return false;
+		}
+		return true;
+	};
+
+	if (!MapFile(TakePath + TEXT(".dragonjournal"), FDragonCaptureFileHeader::JournalMagic, sizeof(FDragonCaptureRecord), JournalHandle, JournalRegion)
+		|| !MapFile(TakePath + TEXT(".dragonindex"), FDragonCaptureFileHeader::IndexMagic, sizeof(uint32), IndexHandle, IndexRegion))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+int32 FLiveLinkDragonCaptureIndex::NumRecords() const
+{
+	if (!JournalRegion.IsValid())
+	{
+		return 0;
+	}
+
+	// A record the writer is halfway through doesn't count yet
+	return static_cast<int32>((JournalRegion->GetMappedSize() - sizeof(FDragonCaptureFileHeader)) / sizeof(FDragonCaptureRecord));
+}
+
+const FDragonCaptureRecord* FLiveLinkDragonCaptureIndex::GetRecord(int32 RecordIndex) const
+{
+	if (RecordIndex < 0 || RecordIndex >= NumRecords())
+	{
+		return nullptr;
+	}
+
+	const uint8* Records = JournalRegion->GetMappedPtr() + sizeof(FDragonCaptureFileHeader);
+	return reinterpret_cast<const FDragonCaptureRecord*>(Records + static_cast<int64>(RecordIndex) * sizeof(FDragonCaptureRecord));
+}
+
+const FDragonCaptureRecord* FLiveLinkDragonCaptureIndex::Find(int32 Frame, int32 Exposure) const
+{
+	if (!IndexRegion.IsValid() || Frame < 0 || Exposure < 0 || Exposure >= static_cast<int32>(FDragonCaptureFileHeader::ExposureSlots))
+	{
+		return nullptr;
+	}
+
+	const int64 Slot = static_cast<int64>(Frame) * FDragonCaptureFileHeader::ExposureSlots + Exposure;
+	const int64 SlotOffset = sizeof(FDragonCaptureFileHeader) + Slot * sizeof(uint32);
+	if (SlotOffset + static_cast<int64>(sizeof(uint32)) > IndexRegion->GetMappedSize())
+	{
+		return nullptr;
+	}
+
+	uint32 RecordNumber;
+	FMemory::Memcpy(&RecordNumber, IndexRegion->GetMappedPtr() + SlotOffset, sizeof(uint32));
+	return RecordNumber > 0 ? GetRecord(static_cast<int32>(RecordNumber - 1)) : nullptr;
+}
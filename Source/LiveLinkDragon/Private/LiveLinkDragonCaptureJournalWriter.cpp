@@ -0,0 +1,241 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonCaptureJournalWriter.h"
+
+#include "HAL/Event.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLiveLinkDragonCaptureJournal, Log, All);
+
+FLiveLinkDragonCaptureJournalWriter::FLiveLinkDragonCaptureJournalWriter(const FString& InJournalDirectory)
+	: JournalDirectory(InJournalDirectory.IsEmpty() ? FLiveLinkDragonCaptureIndex::GetDefaultJournalDirectory() : InJournalDirectory)
+{
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool();
+}
+
+FLiveLinkDragonCaptureJournalWriter::~FLiveLinkDragonCaptureJournalWriter()
+{
+	if (Thread.IsValid())
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		Thread.Reset();
+	}
+
+	// Anything queued after the thread went away still makes it to disk
+	WriteBatch();
+	CloseTake();
+
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+}
+
+void FLiveLinkDragonCaptureJournalWriter::Start()
+{
+	bIsRunning = true;
+	Thread.Reset(FRunnableThread::Create(this, TEXT("Dragon Capture Journal"), 0, TPri_BelowNormal));
+}
+
+void FLiveLinkDragonCaptureJournalWriter::Stop()
+{
+	bIsRunning = false;
+	WakeEvent->Trigger();
+}
+
+void FLiveLinkDragonCaptureJournalWriter::Enqueue(FDragonCaptureJournalEntry&& Entry)
+{
+	PendingEntries.Enqueue(MoveTemp(Entry));
+	WakeEvent->Trigger();
+}
+
+uint32 FLiveLinkDragonCaptureJournalWriter::Run()
+{
+	while (bIsRunning)
+	{
+		WakeEvent->Wait();
+
+		// Give a burst of captures (e.g. all exposures of a frame) the chance to land in one batch
+		if (bIsRunning)
+		{
+			FPlatformProcess::Sleep(BatchInterval);
+		}
+
+		WriteBatch();
+	}
+	return 0;
+}
+
+void FLiveLinkDragonCaptureJournalWriter::WriteBatch()
+{
+	FDragonCaptureJournalEntry Entry;
+	while (PendingEntries.Dequeue(Entry))
+	{
+		WriteEntry(Entry);
+	}
+
+	if (bHasUnflushedWrites)
+	{
+		// Index after journal, so a slot never points at a record that isn't on disk yet
+		JournalFile->Flush();
+		IndexFile->Flush();
+		bHasUnflushedWrites = false;
+	}
+}
+
+void FLiveLinkDragonCaptureJournalWriter::WriteEntry(const FDragonCaptureJournalEntry& Entry)
+{
+	const FString TakePath = FLiveLinkDragonCaptureIndex::GetTakePath(JournalDirectory, Entry.Production, Entry.Scene, Entry.Take);
+	if (TakePath != OpenTakePath && !OpenTake(TakePath))
+	{
+		return;
+	}
+
+	const FDragonCaptureRecord& Record = Entry.Record;
+	if (!JournalFile->Write(reinterpret_cast<const uint8*>(&Record), sizeof(FDragonCaptureRecord)))
+	{
+		UE_LOG(LogLiveLinkDragonCaptureJournal, Warning, TEXT("Could not append to %s.dragonjournal"), *OpenTakePath);
+		return;
+	}
+	++NumRecords;
+	bHasUnflushedWrites = true;
+
+	if (!EnsureFrameCapacity(Record.Frame))
+	{
+		return;
+	}
+
+	if (EnumHasAnyFlags(Record.Flags, EDragonCaptureRecordFlags::Deleted))
+	{
+		// Dragonframe deletes whole frames
+		for (uint32 Exposure = 0; Exposure < FDragonCaptureFileHeader::ExposureSlots; ++Exposure)
+		{
+			WriteSlot(Record.Frame, Exposure, 0);
+		}
+	}
+	else if (Record.Exposure < FDragonCaptureFileHeader::ExposureSlots)
+	{
+		WriteSlot(Record.Frame, Record.Exposure, NumRecords);
+	}
+}
+
+bool FLiveLinkDragonCaptureJournalWriter::OpenTake(const FString& TakePath)
+{
+	// Flush what belongs to the previous take before moving on
+	if (bHasUnflushedWrites)
+	{
+		JournalFile->Flush();
+		IndexFile->Flush();
+		bHasUnflushedWrites = false;
+	}
+	CloseTake();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(TakePath));
+
+	const FString JournalFilename = TakePath + TEXT(".dragonjournal");
+	const FString IndexFilename = TakePath + TEXT(".dragonindex");
+
+	// Picking a take back up after a restart keeps appending to it
+	const int64 JournalSize = PlatformFile.FileSize(*JournalFilename);
+	const int64 IndexSize = PlatformFile.FileSize(*IndexFilename);
+	const bool bResume = JournalSize >= static_cast<int64>(sizeof(FDragonCaptureFileHeader)) && IndexSize >= static_cast<int64>(sizeof(FDragonCaptureFileHeader));
+
+	FDragonCaptureFileHeader IndexHeader;
+	if (bResume)
+	{
+		TUniquePtr<IFileHandle> Reader(PlatformFile.OpenRead(*IndexFilename, true));
+		if (!Reader.IsValid() || !Reader->Read(reinterpret_cast<uint8*>(&IndexHeader), sizeof(IndexHeader)) || IndexHeader.Magic != FDragonCaptureFileHeader::IndexMagic || IndexHeader.Version != FDragonCaptureFileHeader::CurrentVersion)
+		{
+			UE_LOG(LogLiveLinkDragonCaptureJournal, Warning, TEXT("%s is not a capture index this version can append to, not journalling this take"), *IndexFilename);
+			return false;
+		}
+	}
+
+	JournalFile.Reset(PlatformFile.OpenWrite(*JournalFilename, bResume, true));
+	IndexFile.Reset(PlatformFile.OpenWrite(*IndexFilename, bResume, true));
+	if (!JournalFile.IsValid() || !IndexFile.IsValid())
+	{
+		UE_LOG(LogLiveLinkDragonCaptureJournal, Warning, TEXT("Could not open capture journal %s"), *TakePath);
+		CloseTake();
+		return false;
+	}
+
+	if (bResume)
+	{
+		// Drop a record that was only partly written when we last stopped
+		NumRecords = static_cast<uint32>((JournalSize - sizeof(FDragonCaptureFileHeader)) / sizeof(FDragonCaptureRecord));
+		JournalFile->Seek(sizeof(FDragonCaptureFileHeader) + static_cast<int64>(NumRecords) * sizeof(FDragonCaptureRecord));
+		FrameCapacity = IndexHeader.FrameCapacity;
+	}
+	else
+	{
+		FDragonCaptureFileHeader JournalHeader;
+		JournalHeader.Magic = FDragonCaptureFileHeader::JournalMagic;
+		JournalHeader.RecordSize = sizeof(FDragonCaptureRecord);
+		JournalFile->Write(reinterpret_cast<const uint8*>(&JournalHeader), sizeof(JournalHeader));
+
+		IndexHeader.Magic = FDragonCaptureFileHeader::IndexMagic;
+		IndexHeader.RecordSize = sizeof(uint32);
+		IndexHeader.FrameCapacity = 0;
+		IndexFile->Write(reinterpret_cast<const uint8*>(&IndexHeader), sizeof(IndexHeader));
+
+		NumRecords = 0;
+		FrameCapacity = 0;
+		EnsureFrameCapacity(InitialFrameCapacity - 1);
+	}
+
+	OpenTakePath = TakePath;
+	UE_LOG(LogLiveLinkDragonCaptureJournal, Log, TEXT("Journalling captures to %s (%u records so far)"), *TakePath, NumRecords);
+	return true;
+}
+
+void FLiveLinkDragonCaptureJournalWriter::CloseTake()
+{
+	JournalFile.Reset();
+	IndexFile.Reset();
+	OpenTakePath.Reset();
+	NumRecords = 0;
+	FrameCapacity = 0;
+}
+
+bool FLiveLinkDragonCaptureJournalWriter::EnsureFrameCapacity(uint32 Frame)
+{
+	if (Frame < FrameCapacity)
+	{
+		return true;
+	}
+
+	// The slot of a frame doesn't depend on capacity, so growing is zero-filling the tail and bumping the header
+	uint32 NewCapacity = FMath::Max(FrameCapacity, InitialFrameCapacity);
+	while (NewCapacity <= Frame)
+	{
+		NewCapacity *= 2;
+	}
+
+	const int64 SlotBytesPerFrame = FDragonCaptureFileHeader::ExposureSlots * sizeof(uint32);
+	TArray<uint8> Zeros;
+	Zeros.SetNumZeroed((NewCapacity - FrameCapacity) * SlotBytesPerFrame);
+
+	if (!IndexFile->Seek(sizeof(FDragonCaptureFileHeader) + FrameCapacity * SlotBytesPerFrame) || !IndexFile->Write(Zeros.GetData(), Zeros.Num()))
+	{
+		UE_LOG(LogLiveLinkDragonCaptureJournal, Warning, TEXT("Could not grow %s.dragonindex"), *OpenTakePath);
+		return false;
+	}
+
+	// FrameCapacity is the last member of the header
+	IndexFile->Seek(STRUCT_OFFSET(FDragonCaptureFileHeader, FrameCapacity));
+	IndexFile->Write(reinterpret_cast<const uint8*>(&NewCapacity), sizeof(NewCapacity));
+
+	FrameCapacity = NewCapacity;
+	bHasUnflushedWrites = true;
+	return true;
+}
+
+void FLiveLinkDragonCaptureJournalWriter::WriteSlot(uint32 Frame, uint32 Exposure, uint32 Value)
+{
+	const int64 Slot = static_cast<int64>(Frame) * FDragonCaptureFileHeader::ExposureSlots + Exposure;
+	IndexFile->Seek(sizeof(FDragonCaptureFileHeader) + Slot * sizeof(uint32));
+	IndexFile->Write(reinterpret_cast<const uint8*>(&Value), sizeof(Value));
+}
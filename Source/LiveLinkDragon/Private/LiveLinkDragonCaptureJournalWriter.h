@@ -0,0 +1,75 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Containers/Queue.h"
+
+#include "LiveLinkDragonCaptureJournal.h"
+
+#include <atomic>
+
+class FEvent;
+class FRunnableThread;
+class IFileHandle;
+
+struct FDragonCaptureJournalEntry
+{
+	FString Production;
+	FString Scene;
+	FString Take;
+	FDragonCaptureRecord Record;
+};
+
+/**
+ * Appends captures to the per-take journal and index files on its own thread.
+ *
+ * The message thread only queues entries, the disk is touched here in batches,
+ * with one flush per batch rather than per capture.
+ */
+class FLiveLinkDragonCaptureJournalWriter : public FRunnable
+{
+public:
+
+	explicit FLiveLinkDragonCaptureJournalWriter(const FString& InJournalDirectory);
+	~FLiveLinkDragonCaptureJournalWriter();
+
+	void Start();
+
+	/** Called from the message thread only */
+	void Enqueue(FDragonCaptureJournalEntry&& Entry);
+
+	//~ FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End FRunnable Interface
+
+private:
+
+	void WriteBatch();
+	void WriteEntry(const FDragonCaptureJournalEntry& Entry);
+
+	bool OpenTake(const FString& TakePath);
+	void CloseTake();
+	bool EnsureFrameCapacity(uint32 Frame);
+	void WriteSlot(uint32 Frame, uint32 Exposure, uint32 Value);
+
+	const FString JournalDirectory;
+
+	TQueue<FDragonCaptureJournalEntry, EQueueMode::Spsc> PendingEntries;
+	FEvent* WakeEvent = nullptr;
+	TUniquePtr<FRunnableThread> Thread;
+	std::atomic<bool> bIsRunning{ false };
+
+	// The take currently open, captures almost always go to the same one
+	FString OpenTakePath;
+	TUniquePtr<IFileHandle> JournalFile;
+	TUniquePtr<IFileHandle> IndexFile;
+	uint32 NumRecords = 0;
+	uint32 FrameCapacity = 0;
+	bool bHasUnflushedWrites = false;
+
+	static constexpr uint32 InitialFrameCapacity = 1024;
+	static constexpr float BatchInterval = 0.25f; // seconds to let captures pile up before writing them
+};
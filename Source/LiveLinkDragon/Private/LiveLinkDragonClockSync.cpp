@@ -0,0 +1,112 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonClockSync.h"
+
+void FLiveLinkDragonClockSync::Reset()
+{
+	*this = FLiveLinkDragonClockSync();
+}
+
+void FLiveLinkDragonClockSync::AddRoundTrip(double RequestTime, double ReplyTime)
+{
+	// Dragonframe may take its time to send anything back, and that wait is not network delay
+	if (ReplyTime > RequestTime && ReplyTime - RequestTime < MaxPlainRoundTrip)
+	{
+		AddRoundTripSample(ReplyTime - RequestTime);
+	}
+}
+
+void FLiveLinkDragonClockSync::AddPingExchange(double OriginateTime, double RemoteReceiveTime, double RemoteTransmitTime, double DestinationTime)
+{
+	// Classic NTP: the remote's turnaround time is not part of the path delay
+	const double RoundTrip = (DestinationTime - OriginateTime) - (RemoteTransmitTime - RemoteReceiveTime);
+	if (RoundTrip < 0.0)
+	{
+		return;
+	}
+
+	AddRoundTripSample(RoundTrip);
+
+	FExchange& Exchange = Exchanges[NumExchanges++];
+	Exchange.LocalTime = (OriginateTime + DestinationTime) * 0.5;
+	Exchange.Offset = ((RemoteReceiveTime - OriginateTime) + (RemoteTransmitTime - DestinationTime)) * 0.5;
+	Exchange.RoundTrip = RoundTrip;
+
+	// The exchange with the shortest round trip was least disturbed by queuing, so its offset is the one to trust
+	if (NumExchanges == FilterSize || NumOffsetPoints == 0)
+	{
+		const FExchange* Best = &Exchanges[0];
+		for (int32 Index = 1; Index < NumExchanges; ++Index)
+		{
+			if (Exchanges[Index].RoundTrip < Best->RoundTrip)
+			{
+				Best = &Exchanges[Index];
+			}
+		}
+
+		FOffsetPoint& Point = OffsetPoints[NextOffsetPoint];
+		Point.LocalTime = Best->LocalTime;
+		Point.Offset = Best->Offset;
+		NextOffsetPoint = (NextOffsetPoint + 1) % MaxOffsetPoints;
+		NumOffsetPoints = FMath::Min(NumOffsetPoints + 1, MaxOffsetPoints);
+		NumExchanges = 0;
+
+		FitOffset();
+	}
+}
+
+void FLiveLinkDragonClockSync::AddRoundTripSample(double RoundTrip)
+{
+	RoundTrips[NextRoundTrip] = RoundTrip;
+	NextRoundTrip = (NextRoundTrip + 1) % FilterSize;
+	NumRoundTrips = FMath::Min(NumRoundTrips + 1, FilterSize);
+
+	MinRoundTrip = RoundTrips[0];
+	for (int32 Index = 1; Index < NumRoundTrips; ++Index)
+	{
+		MinRoundTrip = FMath::Min(MinRoundTrip, RoundTrips[Index]);
+	}
+}
+
+void FLiveLinkDragonClockSync::FitOffset()
+{
+	// Least squares line through the filtered offsets, relative to their mean time to keep the numbers small
+	double MeanTime = 0.0;
+	double MeanOffset = 0.0;
+	double FirstTime = TNumericLimits<double>::Max();
+	double LastTime = TNumericLimits<double>::Lowest();
+	for (int32 Index = 0; Index < NumOffsetPoints; ++Index)
+	{
+		MeanTime += OffsetPoints[Index].LocalTime;
+		MeanOffset += OffsetPoints[Index].Offset;
+		FirstTime = FMath::Min(FirstTime, OffsetPoints[Index].LocalTime);
+		LastTime = FMath::Max(LastTime, OffsetPoints[Index].LocalTime);
+	}
+	MeanTime /= NumOffsetPoints;
+	MeanOffset /= NumOffsetPoints;
+
+	double Covariance = 0.0;
+	double Variance = 0.0;
+	for (int32 Index = 0; Index < NumOffsetPoints; ++Index)
+	{
+		const double DeltaTime = OffsetPoints[Index].LocalTime - MeanTime;
+		Covariance += DeltaTime * (OffsetPoints[Index].Offset - MeanOffset);
+		Variance += DeltaTime * DeltaTime;
+	}
+
+	// Too short a span and the slope is mostly noise
+	Drift = (LastTime - FirstTime >= MinDriftSpan && Variance > 0.0) ? FMath::Clamp(Covariance / Variance, -MaxDrift, MaxDrift) : 0.0;
+	BaseTime = MeanTime;
+	BaseOffset = MeanOffset;
+}
+
+double FLiveLinkDragonClockSync::GetOffset(double LocalTime) const
+{
+	return BaseOffset + Drift * (LocalTime - BaseTime);
+}
+
+double FLiveLinkDragonClockSync::RemoteToLocal(double RemoteTime) const
+{
+	// Offset is evaluated at the remote time, which is off by the offset itself, but drift makes that negligible
+	return RemoteTime - GetOffset(RemoteTime - BaseOffset);
+}
@@ -0,0 +1,84 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Estimates how the Dragonframe (or bridge) host's clock relates to ours.
+ *
+ * With plain Dragonframe there is no remote clock, so all we learn from the hello round trip is the
+ * one-way delay, which is taken off arrival times. A binary-framing bridge answers pings NTP style, which
+ * gives us offset and drift so frames can be stamped with when they were sent, in our clock.
+ *
+ * Only used from the message thread.
+ */
+class FLiveLinkDragonClockSync
+{
+public:
+
+	void Reset();
+
+	/** A request/reply pair where only our own clock is known, e.g. hello command -> first event back */
+	void AddRoundTrip(double RequestTime, double ReplyTime);
+
+	/** A full ping/pong exchange: T0 and T3 in our clock, T1 and T2 in the remote clock, all in seconds */
+	void AddPingExchange(double OriginateTime, double RemoteReceiveTime, double RemoteTransmitTime, double DestinationTime);
+
+	/** True once enough pongs have come back to map remote times into ours */
+	bool HasRemoteClock() const { return NumOffsetPoints > 0; }
+
+	double RemoteToLocal(double RemoteTime) const;
+
+	/** Best guess of when something that arrived at ArrivalTime was actually sent */
+	double CorrectArrivalTime(double ArrivalTime) const { return ArrivalTime - GetOneWayDelay(); }
+
+	/** Remote minus local, in seconds, at the given local time */
+	double GetOffset(double LocalTime) const;
+	double GetDriftPpm() const { return Drift * 1.0e6; }
+	double GetRoundTrip() const { return MinRoundTrip; }
+	double GetOneWayDelay() const { return MinRoundTrip * 0.5; }
+
+private:
+
+	void AddRoundTripSample(double RoundTrip);
+	void FitOffset();
+
+	struct FOffsetPoint
+	{
+		double LocalTime = 0.0;
+		double Offset = 0.0;
+	};
+
+	// Raw exchanges waiting to be filtered, the one with the shortest round trip wins
+	static constexpr int32 FilterSize = 8;
+	struct FExchange
+	{
+		double LocalTime = 0.0;
+		double Offset = 0.0;
+		double RoundTrip = 0.0;
+	};
+	FExchange Exchanges[FilterSize];
+	int32 NumExchanges = 0;
+
+	// Filtered offsets the drift is fitted to
+	static constexpr int32 MaxOffsetPoints = 16;
+	FOffsetPoint OffsetPoints[MaxOffsetPoints];
+	int32 NumOffsetPoints = 0;
+	int32 NextOffsetPoint = 0;
+
+	double RoundTrips[FilterSize] = { 0.0 };
+	int32 NumRoundTrips = 0;
+	int32 NextRoundTrip = 0;
+	double MinRoundTrip = 0.0;
+
+	// Offset(t) = BaseOffset + Drift * (t - BaseTime)
+	double BaseTime = 0.0;
+	double BaseOffset = 0.0;
+	double Drift = 0.0;
+
+	// Anything beyond this is a bad fit, not a real crystal
+	static constexpr double MaxDrift = 500.0e-6;
+	static constexpr double MinDriftSpan = 5.0;
+	static constexpr double MaxPlainRoundTrip = 0.25;
+};
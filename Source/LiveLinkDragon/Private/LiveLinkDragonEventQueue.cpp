@@ -0,0 +1,39 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonEventQueue.h"
+
+FLiveLinkDragonEventQueue& FLiveLinkDragonEventQueue::Get()
+{
+	// Never destroyed, a message thread still shutting down at exit may be enqueuing
+	static FLiveLinkDragonEventQueue* Queue = new FLiveLinkDragonEventQueue();
+	return *Queue;
+}
+
+void FLiveLinkDragonEventQueue::Enqueue(const FLiveLinkDragonCaptureEvent& Event)
+{
+	FLiveLinkDragonCaptureEvent* Slot = FreeEvents.Pop();
+	if (Slot == nullptr)
+	{
+		if (NumAllocated.fetch_add(1, std::memory_order_relaxed) >= MaxEvents)
+		{
+			NumAllocated.fetch_sub(1, std::memory_order_relaxed);
+			DroppedEvents.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		Slot = new FLiveLinkDragonCaptureEvent();
+	}
+
+	// Assigning over a recycled slot reuses its string buffers
+	*Slot = Event;
+	PendingEvents.Push(Slot);
+}
+
+FLiveLinkDragonCaptureEvent* FLiveLinkDragonEventQueue::Dequeue()
+{
+	return PendingEvents.Pop();
+}
+
+void FLiveLinkDragonEventQueue::Recycle(FLiveLinkDragonCaptureEvent* Event)
+{
+	FreeEvents.Push(Event);
+}
@@ -0,0 +1,42 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LockFreeList.h"
+
+#include "LiveLinkDragonCaptureEvents.h"
+
+#include <atomic>
+
+/**
+ * Capture events on their way from the message threads to the game thread.
+ * Any number of sources enqueue, only the event subsystem dequeues. Events live in pooled slots that go back
+ * to the pool once delivered, so a busy session settles at a handful of slots and allocates nothing.
+ */
+class FLiveLinkDragonEventQueue
+{
+public:
+
+	static FLiveLinkDragonEventQueue& Get();
+
+	/** Any thread. Dropped, and counted, if the game thread has fallen too far behind to take it. */
+	void Enqueue(const FLiveLinkDragonCaptureEvent& Event);
+
+	/** Game thread. Oldest first, hand it back with Recycle once delivered. */
+	FLiveLinkDragonCaptureEvent* Dequeue();
+	void Recycle(FLiveLinkDragonCaptureEvent* Event);
+
+	uint64 GetDroppedEvents() const { return DroppedEvents.load(std::memory_order_relaxed); }
+
+private:
+
+	// Captures are seconds apart and shoots a few a second at most, this is minutes with nobody draining
+	static constexpr int32 MaxEvents = 1024;
+
+	TLockFreePointerListFIFO<FLiveLinkDragonCaptureEvent, PLATFORM_CACHE_LINE_SIZE> PendingEvents;
+	TLockFreePointerListUnordered<FLiveLinkDragonCaptureEvent, PLATFORM_CACHE_LINE_SIZE> FreeEvents;
+
+	std::atomic<int32> NumAllocated{ 0 };
+	std::atomic<uint64> DroppedEvents{ 0 };
+};
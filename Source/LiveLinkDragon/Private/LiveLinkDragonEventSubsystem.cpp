@@ -0,0 +1,138 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonEventSubsystem.h"
+
+#include "LiveLinkDragonEventQueue.h"
+#include "LiveLinkDragonPlateExporter.h"
+#include "LiveLinkDragonStillCache.h"
+
+bool ULiveLinkDragonEventSubsystem::GetDeviceState(FName SubjectName, FLiveLinkDragonDeviceState& OutState)
+{
+	const uint32 Version = FLiveLinkDragonMetricsRegistry::GetVersion();
+	if (Version != SourcesVersion)
+	{
+		Sources = FLiveLinkDragonMetricsRegistry::GetEntries();
+		SourcesVersion = Version;
+	}
+
+	const FLiveLinkDragonMetricsRegistry::FEntry* Source = Sources.FindByPredicate([SubjectName](const FLiveLinkDragonMetricsRegistry::FEntry& Entry) { return Entry.SubjectName == SubjectName; });
+	if (Source == nullptr)
+	{
+		return false;
+	}
+
+	const FLiveLinkDragonDeviceSnapshot Device = Source->Metrics->Device.Read();
+	OutState.Production = FLiveLinkDragonDeviceSnapshot::ToString(Device.Production);
+	OutState.Scene = FLiveLinkDragonDeviceSnapshot::ToString(Device.Scene);
+	OutState.Take = FLiveLinkDragonDeviceSnapshot::ToString(Device.Take);
+	OutState.ExposureName = FLiveLinkDragonDeviceSnapshot::ToString(Device.ExposureName);
+	OutState.CaptureState = FLiveLinkDragonDeviceSnapshot::ToString(Device.CaptureState);
+	OutState.ImageFileName = FLiveLinkDragonDeviceSnapshot::ToString(Device.ImageFileName);
+	OutState.bReadyToCapture = Device.bReadyToCapture;
+	OutState.Frame = Device.Frame;
+	OutState.MocoFrame = Device.MocoFrame;
+	OutState.Exposure = Device.Exposure;
+	OutState.StereoIndex = Device.StereoIndex;
+	OutState.MinAPIVersion = Device.MinAPIVersion;
+	OutState.MaxAPIVersion = Device.MaxAPIVersion;
+	return true;
+}
+
+UTexture2D* ULiveLinkDragonEventSubsystem::FindStill(const FString& Take, int32 Frame, int32 Exposure, int32 StereoIndex)
+{
+	return StillCache.IsValid() ? StillCache->Find(Take, Frame, Exposure, StereoIndex) : nullptr;
+}
+
+TArray<UTexture2D*> ULiveLinkDragonEventSubsystem::GetRecentStills(int32 Count) const
+{
+	TArray<UTexture2D*> Stills;
+	if (StillCache.IsValid())
+	{
+		StillCache->GetRecent(Count, Stills);
+	}
+	return Stills;
+}
+
+int64 ULiveLinkDragonEventSubsystem::GetDroppedEvents() const
+{
+	return static_cast<int64>(FLiveLinkDragonEventQueue::Get().GetDroppedEvents());
+}
+
+void ULiveLinkDragonEventSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PlateExporter = MakeShared<FLiveLinkDragonPlateExporter>();
+
+	StillCache = MakeShared<FLiveLinkDragonStillCache>();
+	StillCache->Start();
+}
+
+void ULiveLinkDragonEventSubsystem::Deinitialize()
+{
+	PlateExporter.Reset();
+	StillCache.Reset();
+
+	// Hand back whatever nobody will see now
+	FLiveLinkDragonEventQueue& Queue = FLiveLinkDragonEventQueue::Get();
+	while (FLiveLinkDragonCaptureEvent* Event = Queue.Dequeue())
+	{
+		Queue.Recycle(Event);
+	}
+
+	Super::Deinitialize();
+}
+
+void ULiveLinkDragonEventSubsystem::Tick(float DeltaTime)
+{
+	FLiveLinkDragonEventQueue& Queue = FLiveLinkDragonEventQueue::Get();
+	const bool bBatching = OnEventBatch.IsBound();
+
+	Batch.Reset();
+	while (FLiveLinkDragonCaptureEvent* Event = Queue.Dequeue())
+	{
+		Deliver(*Event);
+		if (bBatching)
+		{
+			Batch.Add(*Event);
+		}
+		Queue.Recycle(Event);
+	}
+
+	if (Batch.Num() > 0)
+	{
+		OnEventBatch.Broadcast(Batch);
+	}
+}
+
+void ULiveLinkDragonEventSubsystem::Deliver(const FLiveLinkDragonCaptureEvent& Event)
+{
+	switch (Event.Kind)
+	{
+	case ELiveLinkDragonCaptureEventKind::Shoot:
+		OnShoot.Broadcast(Event);
+		break;
+	case ELiveLinkDragonCaptureEventKind::Delete:
+		OnDelete.Broadcast(Event);
+		break;
+	case ELiveLinkDragonCaptureEventKind::CaptureComplete:
+		OnCaptureComplete.Broadcast(Event);
+		FLiveLinkDragonCaptureEvents::OnCapture().Broadcast(Event);
+		break;
+	case ELiveLinkDragonCaptureEventKind::FrameComplete:
+		OnFrameComplete.Broadcast(Event);
+		FLiveLinkDragonCaptureEvents::OnCapture().Broadcast(Event);
+		break;
+	}
+}
+
+ETickableTickType ULiveLinkDragonEventSubsystem::GetTickableTickType() const
+{
+	// The class default object is never initialized, only the real subsystem should drain the queue
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId ULiveLinkDragonEventSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULiveLinkDragonEventSubsystem, STATGROUP_Tickables);
+}
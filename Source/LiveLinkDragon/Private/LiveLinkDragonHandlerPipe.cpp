@@ -0,0 +1,46 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonHandlerPipe.h"
+
+#include "LiveLinkDragonMetrics.h"
+
+FLiveLinkDragonHandlerPipe::FLiveLinkDragonHandlerPipe(FLiveLinkDragonMetrics& InMetrics)
+	: Pipe(TEXT("Dragon Handlers"))
+	, Metrics(InMetrics)
+{
+}
+
+FLiveLinkDragonHandlerPipe::~FLiveLinkDragonHandlerPipe()
+{
+	WaitUntilEmpty();
+}
+
+bool FLiveLinkDragonHandlerPipe::Launch(const TCHAR* DebugName, TUniqueFunction<void()>&& Work)
+{
+	// Only the message thread adds, so a count that was under the limit can't be pushed over it by anyone else
+	const int32 Pending = PendingTasks.load(std::memory_order_relaxed);
+	if (Pending >= MaxPendingTasks)
+	{
+		Metrics.HandlerTasksDropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	PendingTasks.fetch_add(1, std::memory_order_relaxed);
+	if (Pending + 1 > Metrics.HandlerTasksHighWater.load(std::memory_order_relaxed))
+	{
+		Metrics.HandlerTasksHighWater.store(Pending + 1, std::memory_order_relaxed);
+	}
+
+	Pipe.Launch(DebugName, [this, Work = MoveTemp(Work)]()
+	{
+		Work();
+		PendingTasks.fetch_sub(1, std::memory_order_relaxed);
+	}, UE::Tasks::ETaskPriority::BackgroundNormal);
+
+	return true;
+}
+
+void FLiveLinkDragonHandlerPipe::WaitUntilEmpty()
+{
+	Pipe.WaitUntilEmpty();
+}
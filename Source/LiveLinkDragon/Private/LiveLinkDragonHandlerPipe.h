@@ -0,0 +1,41 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Pipe.h"
+
+#include <atomic>
+
+struct FLiveLinkDragonMetrics;
+
+/**
+ * Runs a source's slow handlers on the task system, one after another in the order they were launched.
+ *
+ * The message thread hands work over and goes straight back to the socket, the pipe keeps it in order for the
+ * source's subjects without tying up a thread of its own. At most MaxPendingTasks wait at once, beyond that new
+ * work is dropped and counted rather than queued without bound behind a slow disk.
+ */
+class FLiveLinkDragonHandlerPipe
+{
+public:
+
+	static constexpr int32 MaxPendingTasks = 64;
+
+	explicit FLiveLinkDragonHandlerPipe(FLiveLinkDragonMetrics& InMetrics);
+
+	/** Waits for whatever is still running, the handlers may refer to their owner */
+	~FLiveLinkDragonHandlerPipe();
+
+	/** Message thread only. False if the pipe is full and the work was dropped. */
+	bool Launch(const TCHAR* DebugName, TUniqueFunction<void()>&& Work);
+
+	void WaitUntilEmpty();
+
+private:
+
+	UE::Tasks::FPipe Pipe;
+	FLiveLinkDragonMetrics& Metrics;
+
+	std::atomic<int32> PendingTasks{ 0 };
+};
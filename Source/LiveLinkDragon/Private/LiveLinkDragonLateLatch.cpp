@@ -0,0 +1,218 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonLateLatch.h"
+
+#include "GameFramework/Actor.h"
+#include "Misc/ScopeLock.h"
+#include "RenderingThread.h"
+#include "SceneView.h"
+
+namespace LiveLinkDragonLateLatch
+{
+	struct FRegistry
+	{
+		FCriticalSection Lock;
+		// Oldest first, the newest source wins when two latch the same subject name
+		TArray<TPair<FLiveLinkSubjectKey, TSharedRef<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe>>> Slots;
+		TSharedPtr<FLiveLinkDragonLateLatchViewExtension, ESPMode::ThreadSafe> ViewExtension;
+	};
+
+	static FRegistry& GetRegistry()
+	{
+		static FRegistry Registry;
+		return Registry;
+	}
+
+	/** The newest slot latched under a subject name, the registry lock must be held */
+	static const TSharedRef<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe>* FindByName(const FRegistry& Registry, FName SubjectName)
+	{
+		for (int32 Index = Registry.Slots.Num() - 1; Index >= 0; --Index)
+		{
+			if (Registry.Slots[Index].Key.SubjectName == SubjectName)
+			{
+				return &Registry.Slots[Index].Value;
+			}
+		}
+		return nullptr;
+	}
+}
+
+FLiveLinkDragonLatchedPose FLiveLinkDragonLatchedPose::FromTransform(const FTransform& Transform, double InWorldTime)
+{
+	const FVector Translation = Transform.GetTranslation();
+	const FQuat Quat = Transform.GetRotation();
+
+	FLiveLinkDragonLatchedPose Pose;
+	Pose.bValid = true;
+	Pose.Location[0] = Translation.X;
+	Pose.Location[1] = Translation.Y;
+	Pose.Location[2] = Translation.Z;
+	Pose.Rotation[0] = Quat.X;
+	Pose.Rotation[1] = Quat.Y;
+	Pose.Rotation[2] = Quat.Z;
+	Pose.Rotation[3] = Quat.W;
+	Pose.WorldTime = InWorldTime;
+	return Pose;
+}
+
+FTransform FLiveLinkDragonLatchedPose::ToTransform() const
+{
+	return FTransform(FQuat(Rotation[0], Rotation[1], Rotation[2], Rotation[3]), FVector(Location[0], Location[1], Location[2]));
+}
+
+TSharedRef<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> FLiveLinkDragonLateLatch::Register(const FLiveLinkSubjectKey& SubjectKey)
+{
+	check(IsInGameThread());
+
+	LiveLinkDragonLateLatch::FRegistry& Registry = LiveLinkDragonLateLatch::GetRegistry();
+	FScopeLock Lock(&Registry.Lock);
+
+	if (!Registry.ViewExtension.IsValid())
+	{
+		Registry.ViewExtension = FSceneViewExtensions::NewExtension<FLiveLinkDragonLateLatchViewExtension>();
+	}
+
+	// A subject re-registered starts from nothing rather than from its last pose
+	TSharedRef<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> Slot = MakeShared<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe>();
+	Registry.Slots.RemoveAll([&SubjectKey](const auto& Entry) { return Entry.Key == SubjectKey; });
+	Registry.Slots.Emplace(SubjectKey, Slot);
+	return Slot;
+}
+
+void FLiveLinkDragonLateLatch::Unregister(const FLiveLinkSubjectKey& SubjectKey)
+{
+	check(IsInGameThread());
+
+	LiveLinkDragonLateLatch::FRegistry& Registry = LiveLinkDragonLateLatch::GetRegistry();
+	FScopeLock Lock(&Registry.Lock);
+
+	Registry.Slots.RemoveAll([&SubjectKey](const auto& Entry) { return Entry.Key == SubjectKey; });
+	if (Registry.Slots.Num() == 0)
+	{
+		Registry.ViewExtension.Reset();
+	}
+}
+
+TSharedPtr<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> FLiveLinkDragonLateLatch::Find(FName SubjectName)
+{
+	LiveLinkDragonLateLatch::FRegistry& Registry = LiveLinkDragonLateLatch::GetRegistry();
+	FScopeLock Lock(&Registry.Lock);
+
+	const TSharedRef<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe>* Slot = LiveLinkDragonLateLatch::FindByName(Registry, SubjectName);
+	return Slot ? TSharedPtr<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe>(*Slot) : nullptr;
+}
+
+TSharedPtr<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> FLiveLinkDragonLateLatch::FindForActor(const AActor* Actor)
+{
+	if (Actor == nullptr || Actor->Tags.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	LiveLinkDragonLateLatch::FRegistry& Registry = LiveLinkDragonLateLatch::GetRegistry();
+	FScopeLock Lock(&Registry.Lock);
+
+	for (const FName& Tag : Actor->Tags)
+	{
+		if (const TSharedRef<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe>* Slot = LiveLinkDragonLateLatch::FindByName(Registry, Tag))
+		{
+			return *Slot;
+		}
+	}
+	return nullptr;
+}
+
+FLiveLinkDragonLateLatchViewExtension::FLiveLinkDragonLateLatchViewExtension(const FAutoRegister& AutoRegister)
+	: FSceneViewExtensionBase(AutoRegister)
+{
+}
+
+uint32 FLiveLinkDragonLateLatchViewExtension::GetViewKey(const FSceneView& View)
+{
+	return View.State ? View.State->GetViewKey() : 0;
+}
+
+void FLiveLinkDragonLateLatchViewExtension::SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView)
+{
+	// Views without state can't be told apart once the renderer copies them, they keep the game thread pose
+	const uint32 ViewKey = GetViewKey(InView);
+	if (ViewKey == 0)
+	{
+		return;
+	}
+
+	TSharedPtr<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> Slot = FLiveLinkDragonLateLatch::FindForActor(InView.ViewActor);
+	if (!Slot.IsValid())
+	{
+		return;
+	}
+
+	// What the camera was most likely placed from this tick, the render thread corrects by the difference
+	FLatchedView& Latched = GameThreadViews.AddDefaulted_GetRef();
+	Latched.ViewKey = ViewKey;
+	Latched.FrameNumber = InViewFamily.FrameNumber;
+	Latched.Slot = MoveTemp(Slot);
+	Latched.GameThreadPose = Latched.Slot->Read();
+}
+
+void FLiveLinkDragonLateLatchViewExtension::BeginRenderViewFamily(FSceneViewFamily& InViewFamily)
+{
+	if (GameThreadViews.Num() == 0)
+	{
+		return;
+	}
+
+	// Holding a reference, the last source may go and take the extension with it before this runs
+	ENQUEUE_RENDER_COMMAND(LiveLinkDragonLateLatchViews)(
+		[Extension = StaticCastSharedRef<FLiveLinkDragonLateLatchViewExtension>(AsShared()), Views = MoveTemp(GameThreadViews), FrameNumber = InViewFamily.FrameNumber](FRHICommandListImmediate& RHICmdList) mutable
+		{
+			// Families that were set up but never rendered leave their views behind, don't let them pile up
+			Extension->RenderThreadViews.RemoveAll([FrameNumber](const FLatchedView& Latched) { return Latched.FrameNumber + MaxLatchedFrames < FrameNumber; });
+			Extension->RenderThreadViews.Append(MoveTemp(Views));
+		});
+	GameThreadViews.Reset();
+}
+
+void FLiveLinkDragonLateLatchViewExtension::PreRenderView_RenderThread(FRDGBuilder& GraphBuilder, FSceneView& InView)
+{
+	const uint32 ViewKey = GetViewKey(InView);
+	const uint32 FrameNumber = InView.Family ? InView.Family->FrameNumber : 0;
+	const FLatchedView* Latched = RenderThreadViews.FindByPredicate([ViewKey, FrameNumber](const FLatchedView& Candidate)
+		{
+			return Candidate.ViewKey == ViewKey && Candidate.FrameNumber == FrameNumber;
+		});
+	if (ViewKey == 0 || Latched == nullptr)
+	{
+		return;
+	}
+
+	const FLiveLinkDragonLatchedPose Newest = Latched->Slot->Read();
+	if (!Newest.bValid || !Latched->GameThreadPose.bValid || Newest.WorldTime <= Latched->GameThreadPose.WorldTime)
+	{
+		return;
+	}
+
+	// The camera's world pose is the subject pose under whatever it is attached to, so the view moves by
+	// the subject's own motion since the game thread, applied in subject space
+	const FTransform Delta = Newest.ToTransform().GetRelativeTransform(Latched->GameThreadPose.ToTransform());
+	const FTransform ViewPose = Delta * FTransform(InView.ViewRotation, InView.ViewLocation);
+
+	InView.ViewLocation = ViewPose.GetLocation();
+	InView.ViewRotation = ViewPose.Rotator();
+	InView.UpdateViewMatrix();
+}
+
+void FLiveLinkDragonLateLatchViewExtension::PostRenderViewFamily_RenderThread(FRDGBuilder& GraphBuilder, FSceneViewFamily& InViewFamily)
+{
+	const uint32 FrameNumber = InViewFamily.FrameNumber;
+	TArray<uint32, TInlineAllocator<4>> ViewKeys;
+	for (const FSceneView* View : InViewFamily.Views)
+	{
+		ViewKeys.Add(GetViewKey(*View));
+	}
+
+	RenderThreadViews.RemoveAll([FrameNumber, &ViewKeys](const FLatchedView& Latched)
+		{
+			return (Latched.FrameNumber == FrameNumber && ViewKeys.Contains(Latched.ViewKey)) || Latched.FrameNumber + MaxLatchedFrames < FrameNumber;
+		});
+}
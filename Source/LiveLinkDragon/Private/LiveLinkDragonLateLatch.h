@@ -0,0 +1,96 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LiveLinkTypes.h"
+#include "SceneViewExtension.h"
+
+#include "LiveLinkDragonSeqLock.h"
+
+/**
+ * The newest camera pose pushed for a subject. Plain doubles rather than FTransform so the seqlock can copy it as bytes.
+ */
+struct FLiveLinkDragonLatchedPose
+{
+	bool bValid = false;
+
+	double Location[3] = { 0.0, 0.0, 0.0 };
+	double Rotation[4] = { 0.0, 0.0, 0.0, 1.0 };	// quaternion, XYZW
+
+	// World time of the frame the pose came from
+	double WorldTime = 0.0;
+
+	static FLiveLinkDragonLatchedPose FromTransform(const FTransform& Transform, double WorldTime);
+	FTransform ToTransform() const;
+};
+
+using FLiveLinkDragonPoseSlot = TLiveLinkDragonSeqLock<FLiveLinkDragonLatchedPose>;
+
+/**
+ * Late-latched camera poses for live preview.
+ *
+ * Sources that opt in write each pose they push into a per-subject slot straight from the message thread.
+ * The render thread reads the slot just before it builds a view, and moves any view whose actor carries
+ * the subject name as a tag by however far the camera went since the game thread set that view up.
+ * When there is nothing newer the game thread pose stands.
+ *
+ * Slots belong to a source's subject, so two sources with the same subject name don't take each other's slot
+ * away. Lookups by name get the newest source's.
+ *
+ * This assumes the camera follows the latest LiveLink frame. With buffering or interpolation on the
+ * subject the game thread pose is older than the slot's, and the correction would overshoot.
+ */
+class FLiveLinkDragonLateLatch
+{
+public:
+
+	/** Game thread. The view extension is created with the first subject and goes with the last. */
+	static TSharedRef<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> Register(const FLiveLinkSubjectKey& SubjectKey);
+	static void Unregister(const FLiveLinkSubjectKey& SubjectKey);
+
+	/** Game thread. Null when no running source late-latches this subject. */
+	static TSharedPtr<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> Find(FName SubjectName);
+
+	/** Game thread. The slot of the first latched subject the actor is tagged with. */
+	static TSharedPtr<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> FindForActor(const AActor* Actor);
+};
+
+/** Moves tagged views to the newest pose on the render thread */
+class FLiveLinkDragonLateLatchViewExtension : public FSceneViewExtensionBase
+{
+public:
+
+	FLiveLinkDragonLateLatchViewExtension(const FAutoRegister& AutoRegister);
+
+	//~ Begin ISceneViewExtension interface
+	virtual void SetupViewFamily(FSceneViewFamily& InViewFamily) override {}
+	virtual void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override;
+	virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override;
+	virtual void PreRenderView_RenderThread(FRDGBuilder& GraphBuilder, FSceneView& InView) override;
+	virtual void PostRenderViewFamily_RenderThread(FRDGBuilder& GraphBuilder, FSceneViewFamily& InViewFamily) override;
+	//~ End ISceneViewExtension interface
+
+private:
+
+	/**
+	 * A view set up from a latched subject, and the pose it was set up with. The renderer works on its own copy
+	 * of the view, so it is found again by its view state's key and the frame it was set up for.
+	 */
+	struct FLatchedView
+	{
+		uint32 ViewKey = 0;
+		uint32 FrameNumber = 0;
+		TSharedPtr<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> Slot;
+		FLiveLinkDragonLatchedPose GameThreadPose;
+	};
+
+	static uint32 GetViewKey(const FSceneView& View);
+
+	// Filled per view on the game thread, handed over to the render thread with the family
+	TArray<FLatchedView> GameThreadViews;
+	TArray<FLatchedView> RenderThreadViews;
+
+	// Views whose family never rendered are dropped once they are this many frames old
+	static constexpr uint32 MaxLatchedFrames = 2;
+};
@@ -1,9 +1,16 @@
 // Copyright (c) RITMPS, Rochester Institute of Technology, 2022
 
 #include "LiveLinkDragonMessageThread.h"
+#include "LiveLinkDragonBinaryProtocol.h"
+#include "LiveLinkDragonSocketUtils.h"
+#include "LiveLinkDragonStats.h"
 
 #include "HAL/RunnableThread.h"
 
+#include "Common/UdpSocketBuilder.h"
+#include "SocketSubsystem.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+
 #include "Serialization/ArrayReader.h"
 #include "Serialization/ArrayWriter.h"
 
@@ -13,6 +20,16 @@
 #include "Misc/DateTime.h"
 #include "Misc/SecureHash.h"
 
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#elif PLATFORM_UNIX || PLATFORM_MAC
+THIRD_PARTY_INCLUDES_START
+#include <time.h>
+THIRD_PARTY_INCLUDES_END
+#endif
+
 DEFINE_LOG_CATEGORY_STATIC(LogLiveLinkDragonMessageThread, Log, All);
 
 //~ Constant data defined in the Dragon API
@@ -76,8 +93,20 @@ const FString ActiveString = FString(TEXT("active"));
 
 // const FString FDragonDevice::ZeissLensName = FString(TEXT("Carl Zeiss AG"));
 
-FLiveLinkDragonMessageThread::FLiveLinkDragonMessageThread(FSocket *InSocket) : Socket(InSocket)
+FLiveLinkDragonMessageThread::FLiveLinkDragonMessageThread(const FLiveLinkDragonConnectionSettings& InConnectionSettings, FLiveLinkDragonMetrics& InMetrics)
+	: ConnectionSettings(InConnectionSettings)
+	, Metrics(InMetrics)
+	, ReceiveBuffers(InMetrics)
+	, Trace(InConnectionSettings.SubjectName)
+	, HandlerPipe(InMetrics)
+	, SequenceTracker(InMetrics)
 {
+	SenderFilter.Initialize(ConnectionSettings.AllowedSenders);
+
+	if (ConnectionSettings.bCaptureJournal)
+	{
+		CaptureJournal = MakeUnique<FLiveLinkDragonCaptureJournalWriter>(ConnectionSettings.CaptureJournalDirectory);
+	}
 }
 
 FLiveLinkDragonMessageThread::~FLiveLinkDragonMessageThread()
@@ -86,11 +115,20 @@ FLiveLinkDragonMessageThread::~FLiveLinkDragonMessageThread()
 	{
 		Thread->Kill(true);
 	}
+
+	DestroySocket();
 }
 
 void FLiveLinkDragonMessageThread::Start()
 {
 	Thread.Reset(FRunnableThread::Create(this, TEXT("Dragon UDP Message Thread"), ThreadStackSize, TPri_AboveNormal));
+
+	if (CaptureJournal)
+	{
+		CaptureJournal->Start();
+	}
+
+	Trace.Start();
 }
 
 bool FLiveLinkDragonMessageThread::Init()
@@ -104,104 +142,883 @@ void FLiveLinkDragonMessageThread::Stop()
 	bIsThreadRunning = false;
 }
 
+bool FLiveLinkDragonMessageThread::BindSocket()
+{
+	const uint16 PortNumber = ConnectionSettings.Port > 0 ? static_cast<uint16>(ConnectionSettings.Port) : DefaultPort;
+
+	if (!ConnectionSettings.MulticastGroup.IsEmpty())
+	{
+		Socket = BuildMulticastSocket(PortNumber);
+	}
+	else
+	{
+		FUdpSocketBuilder SocketBuilder = FUdpSocketBuilder(TEXT("Dragon Socket"))
+			.AsReusable()
+			.BoundToEndpoint(FIPv4Endpoint(FIPv4Address::Any, PortNumber))
+			.WithReceiveBufferSize(SocketBufferSize)
+			.WithSendBufferSize(SocketBufferSize)
+			.WithBroadcast();
+
+		// Busy polling spins on RecvFrom, which must not block
+		if (ConnectionSettings.bBusyPoll)
+		{
+			SocketBuilder.AsNonBlocking();
+		}
+
+		Socket = SocketBuilder.Build();
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (Socket == nullptr)
+	{
+		UE_LOG(LogLiveLinkDragonMessageThread, Warning, TEXT("Could not bind the Dragon socket to port %d, retrying in %.2fs"), PortNumber, BindBackoff);
+		Metrics.SocketErrors.fetch_add(1, std::memory_order_relaxed);
+
+		NextBindTime = Now + BindBackoff;
+		BindBackoff = FMath::Min(BindBackoff * 2.0, MaxBindBackoff);
+		SetSessionState(bHasBound ? ELiveLinkDragonSessionState::Rebinding : ELiveLinkDragonSessionState::Unbound);
+		return false;
+	}
+
+	const bool bKernelTimestamps = FLiveLinkDragonSocketUtils::EnableReceiveTimestamps(Socket);
+	Metrics.bKernelTimestamps = bKernelTimestamps;
+	if (!bKernelTimestamps && !bHasBound)
+	{
+		UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Kernel receive timestamps not available, frames will be stamped when they are read"));
+	}
+
+	bHasBound = true;
+	SetSessionState(ELiveLinkDragonSessionState::Listening);
+	return true;
+}
+
+FSocket* FLiveLinkDragonMessageThread::BuildMulticastSocket(uint16 PortNumber) const
+{
+	// FUdpSocketBuilder only joins IPv4 groups, so this goes through FSocket directly to cover IPv6 as well
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+
+	const TSharedPtr<FInternetAddr> GroupAddress = SocketSubsystem->GetAddressFromString(ConnectionSettings.MulticastGroup);
+	if (!GroupAddress.IsValid())
+	{
+		UE_LOG(LogLiveLinkDragonMessageThread, Warning, TEXT("Ill-formed multicast group %s"), *ConnectionSettings.MulticastGroup);
+		return nullptr;
+	}
+
+	TSharedPtr<FInternetAddr> InterfaceAddress;
+	if (!ConnectionSettings.MulticastInterface.IsEmpty())
+	{
+		InterfaceAddress = SocketSubsystem->GetAddressFromString(ConnectionSettings.MulticastInterface);
+		if (!InterfaceAddress.IsValid() || InterfaceAddress->GetProtocolType() != GroupAddress->GetProtocolType())
+		{
+			UE_LOG(LogLiveLinkDragonMessageThread, Warning, TEXT("Multicast interface %s is not a %s address"), *ConnectionSettings.MulticastInterface, *GroupAddress->GetProtocolType().ToString());
+			return nullptr;
+		}
+	}
+
+	const FName ProtocolType = GroupAddress->GetProtocolType();
+	FSocket* NewSocket = SocketSubsystem->CreateSocket(NAME_DGram, TEXT("Dragon Multicast Socket"), ProtocolType);
+	if (NewSocket == nullptr)
+	{
+		return nullptr;
+	}
+
+	// Bound to any address rather than the group so replies to Dragonframe can go out of the same socket
+	TSharedRef<FInternetAddr> BindAddress = SocketSubsystem->CreateInternetAddr(ProtocolType);
+	BindAddress->SetAnyAddress();
+	BindAddress->SetPort(PortNumber);
+
+	int32 ActualBufferSize = 0;
+	bool bSucceeded = NewSocket->SetReuseAddr(true)
+		&& NewSocket->SetNonBlocking(ConnectionSettings.bBusyPoll)
+		&& NewSocket->SetReceiveBufferSize(SocketBufferSize, ActualBufferSize)
+		&& NewSocket->SetSendBufferSize(SocketBufferSize, ActualBufferSize)
+		&& NewSocket->Bind(*BindAddress);
+
+	if (bSucceeded)
+	{
+		bSucceeded = InterfaceAddress.IsValid()
+			? NewSocket->JoinMulticastGroup(*GroupAddress, *InterfaceAddress)
+			: NewSocket->JoinMulticastGroup(*GroupAddress);
+
+		if (!bSucceeded)
+		{
+			UE_LOG(LogLiveLinkDragonMessageThread, Warning, TEXT("Could not join multicast group %s"), *GroupAddress->ToString(false));
+		}
+	}
+
+	if (!bSucceeded)
+	{
+		SocketSubsystem->DestroySocket(NewSocket);
+		return nullptr;
+	}
+
+	NewSocket->SetMulticastLoopback(ConnectionSettings.bMulticastLoopback);
+
+	UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Joined multicast group %s on port %d"), *GroupAddress->ToString(false), PortNumber);
+	return NewSocket;
+}
+
+void FLiveLinkDragonMessageThread::DestroySocket()
+{
+	if (Socket)
+	{
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+}
+
+void FLiveLinkDragonMessageThread::OnSocketError()
+{
+	DestroySocket();
+	Metrics.Rebinds.fetch_add(1, std::memory_order_relaxed);
+
+	const double Now = FPlatformTime::Seconds();
+	if (FailureTime == 0.0 || bFailureTentative)
+	{
+		FailureTime = Now;
+	}
+	bFailureTentative = false;
+
+	// Back off in case whatever broke the socket is still going on
+	NextBindTime = Now + BindBackoff;
+	BindBackoff = FMath::Min(BindBackoff * 2.0, MaxBindBackoff);
+	SetSessionState(ELiveLinkDragonSessionState::Rebinding);
+}
+
+void FLiveLinkDragonMessageThread::OnSessionEvent(ELiveLinkDragonEventType EventType)
+{
+	if (EventType == ELiveLinkDragonEventType::KeepAlive)
+	{
+		// Dragonframe only says hello when it starts, so a hello mid-session means it was restarted.
+		// The keep alive handler answers it with a fresh handshake.
+		if (SessionState == ELiveLinkDragonSessionState::Active || SessionState == ELiveLinkDragonSessionState::Stale)
+		{
+			OnPeerRestarted();
+		}
+		return;
+	}
+
+	switch (SessionState)
+	{
+	case ELiveLinkDragonSessionState::Listening:
+		// Dragonframe was already running when we bound, or we rebound mid-session. Say hello ourselves
+		// rather than waiting for a hello that isn't coming.
+		InitiateHandshake(false);
+		break;
+
+	case ELiveLinkDragonSessionState::Stale:
+		SetSessionState(ELiveLinkDragonSessionState::Active);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void FLiveLinkDragonMessageThread::OnPeerRestarted()
+{
+	UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Dragonframe said hello again, it must have restarted"));
+	Metrics.PeerRestarts.fetch_add(1, std::memory_order_relaxed);
+
+	// A stale session that ends in a restart was a crash after all, counted from the last thing we heard
+	if (FailureTime == 0.0)
+	{
+		FailureTime = FPlatformTime::Seconds();
+	}
+	bFailureTentative = false;
+
+	// Nothing we knew about the old instance holds for the new one
+	SequenceTracker.Reset();
+	ClockSync.Reset();
+	PublishClockSync();
+	bPeerSpeaksBinary = false;
+	HandshakeSentTime = 0.0;
+
+	SetSessionState(ELiveLinkDragonSessionState::Listening);
+}
+
+void FLiveLinkDragonMessageThread::UpdateSessionTimers()
+{
+	const double Now = FPlatformTime::Seconds();
+
+	if (SessionState == ELiveLinkDragonSessionState::Active && Now - LastPacketTime > StaleTimeout)
+	{
+		if (FailureTime == 0.0)
+		{
+			FailureTime = LastPacketTime;
+			bFailureTentative = true;
+		}
+		SetSessionState(ELiveLinkDragonSessionState::Stale);
+	}
+}
+
+void FLiveLinkDragonMessageThread::SetSessionState(ELiveLinkDragonSessionState NewState)
+{
+	if (NewState == SessionState && SessionStateTime > 0.0)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Session %s -> %s"), GetDragonSessionStateName(SessionState), GetDragonSessionStateName(NewState));
+
+	SessionState = NewState;
+	SessionStateTime = Now;
+
+	ConnectionState = (NewState == ELiveLinkDragonSessionState::Unbound || NewState == ELiveLinkDragonSessionState::Rebinding)
+		? ELiveLinkDragonConnectionState::Error
+		: ELiveLinkDragonConnectionState::Listening;
+
+	if (NewState == ELiveLinkDragonSessionState::Active)
+	{
+		// A quiet stretch that simply ended was never a failure
+		if (FailureTime > 0.0 && !bFailureTentative)
+		{
+			const double TimeToRecover = Now - FailureTime;
+			Metrics.TimeToRecover.Record(TimeToRecover);
+			LastRecoverySeconds = static_cast<float>(TimeToRecover);
+			UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Session recovered in %.2fs"), TimeToRecover);
+		}
+		FailureTime = 0.0;
+		bFailureTentative = false;
+		BindBackoff = InitialBindBackoff;
+	}
+
+	PublishStatus(true);
+}
+
 uint32 FLiveLinkDragonMessageThread::Run()
 {
 	ISocketSubsystem *SocketSub = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
 	TSharedRef<FInternetAddr> RemoteAddress = SocketSub->CreateInternetAddr();
 
-	// Pre-allocate a buffer to receive data into from the socket
-	uint8 ReceiveBuffer[ReceiveBufferSize];
+	BusyPollReportStartTime = FPlatformTime::Seconds();
+	StatusWindowStartTime = BusyPollReportStartTime;
+
+	SetSessionState(ELiveLinkDragonSessionState::Unbound);
 
 	while (bIsThreadRunning) 
 	{
-		double TimeLeft = Timeout;
-		double StartTime = FPlatformTime::Seconds();
+		if (!Socket)
+		{
+			// Backing off after a failed bind or a socket error, in small steps so Stop() stays responsive
+			const double Now = FPlatformTime::Seconds();
+			if (Now < NextBindTime)
+			{
+				FPlatformProcess::Sleep(static_cast<float>(FMath::Min(NextBindTime - Now, 0.1)));
+				PublishStatus(false);
+				continue;
+			}
+
+			if (!BindSocket())
+			{
+				continue;
+			}
+		}
 
-		if (Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(TimeLeft)))
+		if (Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(GetWaitTimeout())))
 		{
-			double EndTime = FPlatformTime::Seconds();
-			int32 NumBytesReceived = 0;
+			const EReceiveResult Result = ReceivePacket(*RemoteAddress, Metrics.BlockingReceiveLatency);
+			if (Result == EReceiveResult::Error)
+			{
+				OnSocketError();
+				continue;
+			}
 
-			if (Socket->RecvFrom(ReceiveBuffer, ReceiveBufferSize, NumBytesReceived, *RemoteAddress))
+			if (Result == EReceiveResult::Received)
 			{
-				if(NumBytesReceived == 0)
+				Metrics.BlockingPackets.fetch_add(1, std::memory_order_relaxed);
+
+				// Stay hot for a little while, the next packet of a burst is usually right behind this one
+				if (ConnectionSettings.bBusyPoll && !BusyPoll(*RemoteAddress))
 				{
-					UE_LOG(LogLiveLinkDragonMessageThread, Warning, TEXT("Received 0 bytes from socket."));
+					OnSocketError();
 					continue;
 				}
+			}
+		}
+
+		if (ConnectionSettings.bBusyPoll)
+		{
+			UpdateBusyPollReport();
+		}
 
-				FString addy = RemoteAddress->ToString(true);
-				UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Received %d from %s"), NumBytesReceived, *addy);
+		if (ConnectionSettings.bClockSync && bPeerSpeaksBinary && FPlatformTime::Seconds() - LastPingTime >= ConnectionSettings.ClockSyncIntervalSeconds)
+		{
+			SendClockPing();
+		}
 
-				RemotePort = RemoteAddress->GetPort(); // assume localhost for now
-				RemoteIP = RemoteAddress->ToString(false);
+		UpdateSessionTimers();
+		PublishStatus(false);
+	}
 
-				// terminate the packet?
-				ReceiveBuffer[NumBytesReceived] = 0x00;
-				FString Packet = FString((char*) ReceiveBuffer);
+	DestroySocket();
 
-				ParsePacket(Packet); 
-			}
-			else if (Socket->GetConnectionState() == ESocketConnectionState::SCS_ConnectionError)
-			{
-				UE_LOG(LogLiveLinkDragonMessageThread, Warning, TEXT("Socket Error."));
-				break;
-			}
+	// Leave a final word for whoever polls the status after we're gone
+	ConnectionState = ELiveLinkDragonConnectionState::Stopped;
+	PublishStatus(true);
+
+	return 0;
+}
+
+namespace LiveLinkDragonMessageThread
+{
+	/** CPU time of the calling thread alone, zero where the platform doesn't tell */
+	double GetThreadCPUSeconds()
+	{
+#if PLATFORM_WINDOWS
+		FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+		if (::GetThreadTimes(::GetCurrentThread(), &CreationTime, &ExitTime, &KernelTime, &UserTime))
+		{
+			const uint64 Kernel = (uint64(KernelTime.dwHighDateTime) << 32) | KernelTime.dwLowDateTime;
+			const uint64 User = (uint64(UserTime.dwHighDateTime) << 32) | UserTime.dwLowDateTime;
+			return (Kernel + User) * 1.0e-7;
+		}
+#elif PLATFORM_UNIX || PLATFORM_MAC
+		timespec ThreadTime;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ThreadTime) == 0)
+		{
+			return ThreadTime.tv_sec + ThreadTime.tv_nsec * 1.0e-9;
 		}
+#endif
+		return 0.0;
 	}
-	return 0;
 }
 
-void FLiveLinkDragonMessageThread::ParsePacket(const FString InPacket)
+void FLiveLinkDragonMessageThread::PublishStatus(bool bForce)
+{
+	using namespace LiveLinkDragonMessageThread;
+
+	const double Now = FPlatformTime::Seconds();
+	const double Elapsed = Now - StatusWindowStartTime;
+	if (!bForce && Elapsed < StatusPublishInterval)
+	{
+		return;
+	}
+
+	// Forced publishes can come right after the last one, keep the old rates rather than dividing by nothing
+	if (Elapsed >= StatusPublishInterval)
+	{
+		const uint64 Packets = Metrics.PacketsReceived.load(std::memory_order_relaxed);
+		const uint64 Bytes = Metrics.BytesReceived.load(std::memory_order_relaxed);
+
+		Status.PacketsPerSecond = static_cast<float>((Packets - StatusWindowStartPackets) / Elapsed);
+		Status.BytesPerSecond = static_cast<float>((Bytes - StatusWindowStartBytes) / Elapsed);
+
+		StatusWindowStartTime = Now;
+		StatusWindowStartPackets = Packets;
+		StatusWindowStartBytes = Bytes;
+	}
+
+	Status.ConnectionState = ConnectionState;
+	Status.SessionState = SessionState;
+	Status.bHandshook = SessionState == ELiveLinkDragonSessionState::Active || SessionState == ELiveLinkDragonSessionState::Stale;
+	Status.SessionStateTime = SessionStateTime;
+	Status.LastRecoverySeconds = LastRecoverySeconds;
+	Status.LastPacketTime = LastPacketTime;
+	Status.PublishTime = Now;
+	Status.SocketErrors = static_cast<uint32>(Metrics.SocketErrors.load(std::memory_order_relaxed));
+	Status.ParseErrors = static_cast<uint32>(Metrics.ParseErrors.load(std::memory_order_relaxed));
+	Status.ThreadCPUSeconds = GetThreadCPUSeconds();
+
+	Metrics.Status.Write(Status);
+}
+
+double FLiveLinkDragonMessageThread::GetWaitTimeout() const
+{
+	// Wake up in time for the next clock ping when there is someone to answer it
+	// and for the session timers
+	if (ConnectionSettings.bClockSync && bPeerSpeaksBinary)
+	{
+		return FMath::Min<double>(SessionTickInterval, ConnectionSettings.ClockSyncIntervalSeconds);
+	}
+	return FMath::Min<double>(Timeout, SessionTickInterval);
+}
+
+FLiveLinkDragonMessageThread::EReceiveResult FLiveLinkDragonMessageThread::ReceivePacket(FInternetAddr& RemoteAddress, FLiveLinkDragonLatencyHistogram& ReceiveLatency)
+{
+	const EReceiveResult Result = ReceiveDatagram(RemoteAddress, ReceiveLatency);
+
+	// While more is already waiting we've fallen behind, keep reading so stale state can be skipped rather than replayed
+	uint32 PendingDataSize = 0;
+	if (Backlog.Num() > 0 && (Result != EReceiveResult::Received || Backlog.Num() >= MaxBacklogEvents || !Socket->HasPendingData(PendingDataSize)))
+	{
+		ProcessBacklog();
+	}
+
+	return Result;
+}
+
+FLiveLinkDragonMessageThread::EReceiveResult FLiveLinkDragonMessageThread::ReceiveDatagram(FInternetAddr& RemoteAddress, FLiveLinkDragonLatencyHistogram& ReceiveLatency)
+{
+	int32 NumBytesReceived = 0;
+	double ArrivalTime = 0.0;
+
+	if (!PendingReceiveBuffer.IsValid())
+	{
+		PendingReceiveBuffer = ReceiveBuffers.Acquire();
+	}
+
+	bool bTruncated = false;
+	if (!FLiveLinkDragonSocketUtils::RecvFromWithTimestamp(Socket, Metrics.bKernelTimestamps.load(std::memory_order_relaxed), PendingReceiveBuffer.GetData(), PendingReceiveBuffer.GetCapacity(), NumBytesReceived, RemoteAddress, ArrivalTime, bTruncated))
+	{
+		if (Socket->GetConnectionState() == ESocketConnectionState::SCS_ConnectionError)
+		{
+			UE_LOG(LogLiveLinkDragonMessageThread, Warning, TEXT("Socket Error."));
+			Metrics.SocketErrors.fetch_add(1, std::memory_order_relaxed);
+			return EReceiveResult::Error;
+		}
+
+		// Nothing there, which is expected when spinning on a non-blocking socket
+		return EReceiveResult::NoData;
+	}
+
+	if(NumBytesReceived == 0)
+	{
+		UE_LOG(LogLiveLinkDragonMessageThread, Warning, TEXT("Received 0 bytes from socket."));
+		return EReceiveResult::NoData;
+	}
+
+	// Only part of it made it into the buffer, parsing that would at best fail and at worst half-apply an event
+	if (bTruncated)
+	{
+		Metrics.PacketsTruncated.fetch_add(1, std::memory_order_relaxed);
+		return EReceiveResult::NoData;
+	}
+
+	// Before anything else looks at it, so other tools' traffic on a shared network costs next to nothing
+	if (!SenderFilter.IsAllowed(RemoteAddress))
+	{
+		Metrics.PacketsFiltered.fetch_add(1, std::memory_order_relaxed);
+		INC_DWORD_STAT(STAT_DragonPacketsFiltered);
+
+		// As far as busy-poll and packet counts go, nothing arrived
+		return EReceiveResult::NoData;
+	}
+
+	// The datagram is ours now, the buffer goes back to the pool once we're done with it
+	FDragonReceiveBuffer Datagram = MoveTemp(PendingReceiveBuffer);
+	Datagram.SetSize(NumBytesReceived);
+	const uint8* ReceiveBuffer = Datagram.GetData();
+
+	if (NumBytesReceived > Metrics.LargestDatagram.load(std::memory_order_relaxed))
+	{
+		Metrics.LargestDatagram.store(NumBytesReceived, std::memory_order_relaxed);
+	}
+
+	Metrics.PacketsReceived.fetch_add(1, std::memory_order_relaxed);
+	Metrics.BytesReceived.fetch_add(NumBytesReceived, std::memory_order_relaxed);
+	INC_DWORD_STAT(STAT_DragonPacketsReceived);
+	LastPacketTime = ArrivalTime;
+
+	// Formatting addresses costs more than parsing, so only look at who sent it when that changes
+	if (!ReplyAddress.IsValid() || !(*ReplyAddress == RemoteAddress))
+	{
+		OnSenderChanged(RemoteAddress);
+	}
+
+	DRAGON_TRACE(Trace, EDragonTraceCategory::Packet, ELiveLinkDragonEventType::Unknown, SenderHandle, NumBytesReceived, static_cast<float>((FPlatformTime::Seconds() - ArrivalTime) * 1.0e6));
+
+	if (Metrics.bKernelTimestamps.load(std::memory_order_relaxed))
+	{
+		ReceiveLatency.Record(FPlatformTime::Seconds() - ArrivalTime);
+	}
+
+	// Bridges frame their datagrams, Dragonframe itself only ever sends bare JSON
+	FDragonBinaryHeader BinaryHeader;
+	const bool bIsBinary = FDragonBinaryHeader::Read(ReceiveBuffer, NumBytesReceived, BinaryHeader);
+	int32 PayloadOffset = 0;
+	if (bIsBinary)
+	{
+		bPeerSpeaksBinary = true;
+
+		if (BinaryHeader.Type == EDragonFrameType::Pong)
+		{
+			HandlePong(ReceiveBuffer + FDragonBinaryHeader::Size, NumBytesReceived - FDragonBinaryHeader::Size, BinaryHeader.SendTime, ArrivalTime);
+			return EReceiveResult::Received;
+		}
+		else if (BinaryHeader.Type == EDragonFrameType::Ping)
+		{
+			AnswerPing(ReceiveBuffer + FDragonBinaryHeader::Size, NumBytesReceived - FDragonBinaryHeader::Size, BinaryHeader.Sequence, ArrivalTime);
+			return EReceiveResult::Received;
+		}
+		else if (BinaryHeader.Type != EDragonFrameType::Event)
+		{
+			return EReceiveResult::Received;
+		}
+
+		PayloadOffset = FDragonBinaryHeader::Size;
+	}
+
+	// Binary framing numbers its datagrams, for plain JSON all we can do up front is spot copies
+	const EDragonPacketOrder Order = bIsBinary
+		? SequenceTracker.OnSequence(BinaryHeader.Sequence)
+		: SequenceTracker.OnPayload(ReceiveBuffer, NumBytesReceived, ArrivalTime);
+	if (Order == EDragonPacketOrder::Duplicate)
+	{
+		DRAGON_TRACE(Trace, EDragonTraceCategory::Dropped, ELiveLinkDragonEventType::Unknown, SenderHandle, NumBytesReceived, 0.0f);
+		return EReceiveResult::Received;
+	}
+	bIsLateDatagram = Order == EDragonPacketOrder::Late;
+
+	// The first thing back after our hello gives a round trip, which is all plain Dragonframe lets us measure
+	if (HandshakeSentTime > 0.0)
+	{
+		ClockSync.AddRoundTrip(HandshakeSentTime, ArrivalTime);
+		HandshakeSentTime = 0.0;
+		PublishClockSync();
+	}
+
+	// Everything produced from this datagram is stamped with its arrival, not with when we got around to it
+	double WorldTime = ArrivalTime;
+	if (ConnectionSettings.bClockSync)
+	{
+		WorldTime = (bIsBinary && ClockSync.HasRemoteClock())
+			? ClockSync.RemoteToLocal(DragonNanosecondsToSeconds(BinaryHeader.SendTime))
+			: ClockSync.CorrectArrivalTime(ArrivalTime);
+	}
+
+	ParsePacket(Datagram.GetView().RightChop(PayloadOffset), ArrivalTime, WorldTime);
+
+	return EReceiveResult::Received;
+}
+
+void FLiveLinkDragonMessageThread::OnSenderChanged(const FInternetAddr& RemoteAddress)
+{
+	ReplyAddress = RemoteAddress.Clone();
+
+	const TPair<TSharedRef<FInternetAddr>, uint32>* Known = KnownSenders.FindByPredicate([&RemoteAddress](const TPair<TSharedRef<FInternetAddr>, uint32>& Sender) { return *Sender.Key == RemoteAddress; });
+	if (Known)
+	{
+		SenderHandle = Known->Value;
+		return;
+	}
+
+	if (KnownSenders.Num() >= MaxKnownSenders)
+	{
+		KnownSenders.RemoveAt(0, 1, false);
+	}
+	SenderHandle = ++LastSenderHandle;
+	KnownSenders.Emplace(RemoteAddress.Clone(), SenderHandle);
+	DRAGON_TRACE_SENDER(Trace, SenderHandle, RemoteAddress.ToString(true));
+}
+
+bool FLiveLinkDragonMessageThread::BusyPoll(FInternetAddr& RemoteAddress)
+{
+	const double Budget = ConnectionSettings.BusyPollBudgetMicroseconds * 1.0e-6;
+	const double SpinStartTime = FPlatformTime::Seconds();
+
+	double HandlingTime = 0.0;
+	double Deadline = SpinStartTime + Budget;
+	double Now = SpinStartTime;
+
+	while (bIsThreadRunning && Now < Deadline)
+	{
+		const EReceiveResult Result = ReceivePacket(RemoteAddress, Metrics.BusyPollReceiveLatency);
+		const double AfterReceive = FPlatformTime::Seconds();
+
+		if (Result == EReceiveResult::Error)
+		{
+			return false;
+		}
+
+		if (Result == EReceiveResult::Received)
+		{
+			Metrics.BusyPollPackets.fetch_add(1, std::memory_order_relaxed);
+
+			// Time spent parsing and handling is not spin time, and every hit restarts the budget
+			HandlingTime += AfterReceive - Now;
+			Deadline = AfterReceive + Budget;
+		}
+
+		Now = AfterReceive;
+	}
+
+	const double SpinTime = FMath::Max(0.0, Now - SpinStartTime - HandlingTime);
+	Metrics.BusyPollSpinMicroseconds.fetch_add(static_cast<uint64>(SpinTime * 1.0e6), std::memory_order_relaxed);
+
+	return true;
+}
+
+void FLiveLinkDragonMessageThread::UpdateBusyPollReport()
+{
+	const double Now = FPlatformTime::Seconds();
+	const double Elapsed = Now - BusyPollReportStartTime;
+	if (Elapsed < BusyPollReportInterval)
+	{
+		return;
+	}
+
+	const uint64 SpinMicroseconds = Metrics.BusyPollSpinMicroseconds.load(std::memory_order_relaxed);
+	const uint64 BlockingPackets = Metrics.BlockingPackets.load(std::memory_order_relaxed);
+	const uint64 BusyPollPackets = Metrics.BusyPollPackets.load(std::memory_order_relaxed);
+
+	const double WindowSpin = (SpinMicroseconds - BusyPollReportStartSpinMicroseconds) * 1.0e-6;
+	const uint64 WindowBlocking = BlockingPackets - BusyPollReportStartBlockingPackets;
+	const uint64 WindowHits = BusyPollPackets - BusyPollReportStartBusyPollPackets;
+	const uint64 WindowPackets = WindowBlocking + WindowHits;
+
+	const float CpuFraction = static_cast<float>(WindowSpin / Elapsed);
+	const float HitFraction = WindowPackets > 0 ? static_cast<float>(WindowHits) / WindowPackets : 0.0f;
+
+	Metrics.BusyPollCpuFraction.store(CpuFraction, std::memory_order_relaxed);
+	Metrics.BusyPollHitFraction.store(HitFraction, std::memory_order_relaxed);
+
+	UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Busy poll: %.1f%% of a core spinning, %llu of %llu packets caught without a wakeup"),
+		CpuFraction * 100.0f, WindowHits, WindowPackets);
+
+	if (Metrics.bKernelTimestamps.load(std::memory_order_relaxed))
+	{
+		UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Busy poll: median arrival to receive %.0fus spinning vs %.0fus after a wakeup"),
+			Metrics.BusyPollReceiveLatency.GetPercentile(0.5) * 1.0e6, Metrics.BlockingReceiveLatency.GetPercentile(0.5) * 1.0e6);
+	}
+
+	BusyPollReportStartTime = Now;
+	BusyPollReportStartSpinMicroseconds = SpinMicroseconds;
+	BusyPollReportStartBlockingPackets = BlockingPackets;
+	BusyPollReportStartBusyPollPackets = BusyPollPackets;
+}
+
+void FLiveLinkDragonMessageThread::HandlePong(const uint8* Payload, int32 PayloadSize, uint64 RemoteTransmitTime, double ArrivalTime)
+{
+	uint64 OriginateTime = 0;
+	uint64 RemoteReceiveTime = 0;
+	if (PayloadSize < int32(sizeof(OriginateTime) + sizeof(RemoteReceiveTime)))
+	{
+		return;
+	}
+
+	FMemory::Memcpy(&OriginateTime, Payload, sizeof(OriginateTime));
+	FMemory::Memcpy(&RemoteReceiveTime, Payload + sizeof(OriginateTime), sizeof(RemoteReceiveTime));
+
+	ClockSync.AddPingExchange(DragonNanosecondsToSeconds(OriginateTime), DragonNanosecondsToSeconds(RemoteReceiveTime),
+		DragonNanosecondsToSeconds(RemoteTransmitTime), ArrivalTime);
+	PublishClockSync();
+}
+
+void FLiveLinkDragonMessageThread::AnswerPing(const uint8* Payload, int32 PayloadSize, uint32 Sequence, double ArrivalTime)
+{
+	uint64 OriginateTime = 0;
+	if (PayloadSize < int32(sizeof(OriginateTime)))
+	{
+		return;
+	}
+	FMemory::Memcpy(&OriginateTime, Payload, sizeof(OriginateTime));
+
+	const uint64 ReceiveTime = DragonSecondsToNanoseconds(ArrivalTime);
+
+	FDragonBinaryHeader Header;
+	Header.Type = EDragonFrameType::Pong;
+	Header.Sequence = Sequence;
+	Header.SendTime = DragonSecondsToNanoseconds(FPlatformTime::Seconds());
+
+	uint8 Pong[FDragonBinaryHeader::Size + sizeof(uint64) * 2];
+	Header.Write(Pong);
+	FMemory::Memcpy(Pong + FDragonBinaryHeader::Size, &OriginateTime, sizeof(OriginateTime));
+	FMemory::Memcpy(Pong + FDragonBinaryHeader::Size + sizeof(uint64), &ReceiveTime, sizeof(ReceiveTime));
+
+	SendBytesToServer(Pong, sizeof(Pong));
+}
+
+void FLiveLinkDragonMessageThread::SendClockPing()
+{
+	LastPingTime = FPlatformTime::Seconds();
+
+	FDragonBinaryHeader Header;
+	Header.Type = EDragonFrameType::Ping;
+	Header.Sequence = PingSequence++;
+	Header.SendTime = DragonSecondsToNanoseconds(LastPingTime);
+
+	// The bridge echoes the originate time back so we don't have to remember outstanding pings
+	uint8 Ping[FDragonBinaryHeader::Size + sizeof(uint64)];
+	Header.Write(Ping);
+	FMemory::Memcpy(Ping + FDragonBinaryHeader::Size, &Header.SendTime, sizeof(Header.SendTime));
+
+	SendBytesToServer(Ping, sizeof(Ping));
+}
+
+void FLiveLinkDragonMessageThread::PublishClockSync()
+{
+	const double Now = FPlatformTime::Seconds();
+	Metrics.bClockSynced.store(ClockSync.HasRemoteClock(), std::memory_order_relaxed);
+	Metrics.ClockOffsetMicroseconds.store(ClockSync.GetOffset(Now) * 1.0e6, std::memory_order_relaxed);
+	Metrics.ClockDriftPpm.store(ClockSync.GetDriftPpm(), std::memory_order_relaxed);
+	Metrics.OneWayDelayMicroseconds.store(ClockSync.GetOneWayDelay() * 1.0e6, std::memory_order_relaxed);
+}
+
+ELiveLinkDragonEventType FLiveLinkDragonMessageThread::ClassifyEvent(const FString& EventType)
+{
+	static const TPair<FString, ELiveLinkDragonEventType> EventTypes[] =
+	{
+		{ KeepAliveString, ELiveLinkDragonEventType::KeepAlive },
+		{ PositionString, ELiveLinkDragonEventType::Position },
+		{ CaptureStateString, ELiveLinkDragonEventType::CaptureState },
+		{ ShootString, ELiveLinkDragonEventType::Shoot },
+		{ DeleteString, ELiveLinkDragonEventType::Delete },
+		{ CaptureCompleteString, ELiveLinkDragonEventType::CaptureComplete },
+		{ FrameCompleteString, ELiveLinkDragonEventType::FrameComplete },
+		{ ViewFrameString, ELiveLinkDragonEventType::ViewFrame },
+	};
+
+	for (const TPair<FString, ELiveLinkDragonEventType>& Pair : EventTypes)
+	{
+		if (EventType == Pair.Key)
+		{
+			return Pair.Value;
+		}
+	}
+	return ELiveLinkDragonEventType::Unknown;
+}
+
+void FLiveLinkDragonMessageThread::ParsePacket(TArrayView<const uint8> InPacket, double ArrivalTime, double WorldTime)
 {
+	const double ParseStartTime = FPlatformTime::Seconds();
+
+	// Dragonframe sends UTF-8, taken by length as nothing in the datagram terminates it
+	const FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(InPacket.GetData()), InPacket.Num());
+	const FString Packet(Converter.Length(), Converter.Get());
+
 	TSharedPtr<FJsonObject> JsonObject = MakeShared<FJsonObject>();
-	TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<ANSICHAR>::Create(InPacket);
-	FJsonSerializer::Deserialize(JsonReader, JsonObject);
+	TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(Packet);
+	if (!FJsonSerializer::Deserialize(JsonReader, JsonObject))
+	{
+		Metrics.ParseErrors.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	const double ParseTime = FPlatformTime::Seconds() - ParseStartTime;
+	Metrics.ParseLatency.Record(ParseTime);
 
 	FString EventType;
 	if (JsonObject->TryGetStringField(EventString, EventType))
 	{
-		UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Received event of type %s"), *EventType);
+		const ELiveLinkDragonEventType EventKind = ClassifyEvent(EventType);
+		Metrics.EventsReceived[static_cast<int32>(EventKind)].fetch_add(1, std::memory_order_relaxed);
 
-		if (EventType == KeepAliveString) {
-			HandleKeepAliveEvent(JsonObject);
-		}
-		else if (EventType == PositionString)
+		DRAGON_TRACE(Trace, EventKind == ELiveLinkDragonEventType::Unknown ? EDragonTraceCategory::UnknownEvent : EDragonTraceCategory::Event, EventKind, SenderHandle, InPacket.Num(), static_cast<float>(ParseTime * 1.0e6));
+
+		// Liveness is about what arrived, however far behind handling it is
+		OnSessionEvent(EventKind);
+
+		// A late state update would overwrite newer state, edges still go through
+		if (bIsLateDatagram && IsStateUpdate(EventKind))
 		{
-			HandlePositionEvent(JsonObject);
+			DRAGON_TRACE(Trace, EDragonTraceCategory::Dropped, EventKind, SenderHandle, InPacket.Num(), 0.0f);
+			SequenceTracker.OnStaleUpdateDropped();
+			return;
 		}
-		else if (EventType == CaptureStateString)
+
+		// Unknown and empty event types were traced above
+		if (EventKind == ELiveLinkDragonEventType::Unknown)
 		{
-			HandleCaptureStateEvent(JsonObject);
+			return;
 		}
-		else if (EventType == ShootString) {
-			HandleShootEvent(JsonObject);
+
+		FQueuedEvent& Event = Backlog.AddDefaulted_GetRef();
+		Event.JsonObject = MoveTemp(JsonObject);
+		Event.EventType = EventKind;
+		Event.ArrivalTime = ArrivalTime;
+		Event.WorldTime = WorldTime;
+		Event.bLate = bIsLateDatagram;
+
+		double StereoIndex = 0.0;
+		if (Event.JsonObject->TryGetNumberField(StereoIndexString, StereoIndex))
+		{
+			Event.StereoIndex = static_cast<int32>(StereoIndex);
 		}
-		else if (EventType == DeleteString) {
-			HandleDeleteEvent(JsonObject);
+
+		if (Backlog.Num() > Metrics.BacklogHighWater.load(std::memory_order_relaxed))
+		{
+			Metrics.BacklogHighWater.store(Backlog.Num(), std::memory_order_relaxed);
 		}
-		else if (EventType == CaptureCompleteString) {
-			HandleCaptureCompleteEvent(JsonObject);
+	}
+	else {
+		DRAGON_TRACE(Trace, EDragonTraceCategory::UnknownEvent, ELiveLinkDragonEventType::Unknown, SenderHandle, InPacket.Num(), static_cast<float>(ParseTime * 1.0e6));
+	}
+}
+
+bool FLiveLinkDragonMessageThread::IsStateUpdate(ELiveLinkDragonEventType EventType)
+{
+	return EventType == ELiveLinkDragonEventType::Position
+		|| EventType == ELiveLinkDragonEventType::CaptureState
+		|| EventType == ELiveLinkDragonEventType::ViewFrame;
+}
+
+void FLiveLinkDragonMessageThread::ProcessBacklog()
+{
+	// Walk back from the newest so the first state update seen for a subject is the one that survives.
+	// Edges (hello, shoot, delete, captures) are never dropped and nothing moves across them, as they
+	// act on the state that came before. So coalescing only happens between two edges.
+	TArray<uint64, TInlineAllocator<16>> NewestSeen;
+	for (int32 Index = Backlog.Num() - 1; Index >= 0; --Index)
+	{
+		FQueuedEvent& Event = Backlog[Index];
+		if (!IsStateUpdate(Event.EventType))
+		{
+			NewestSeen.Reset();
+			continue;
 		}
-		else if (EventType == FrameCompleteString) {
-			HandleFrameCompleteEvent(JsonObject);
+
+		const uint64 Key = (static_cast<uint64>(Event.EventType) << 32) | static_cast<uint32>(Event.StereoIndex);
+		if (NewestSeen.Contains(Key))
+		{
+			Event.bCoalesced = true;
+			Metrics.EventsCoalesced[static_cast<int32>(Event.EventType)].fetch_add(1, std::memory_order_relaxed);
+			INC_DWORD_STAT(STAT_DragonEventsCoalesced);
+			DRAGON_TRACE(Trace, EDragonTraceCategory::Dropped, Event.EventType, SenderHandle, 0, 0.0f);
 		}
-		else if (EventType == ViewFrameString) {
-			HandleViewFrameEvent(JsonObject);
+		else
+		{
+			NewestSeen.Add(Key);
 		}
-		else {
-			if( !EventType.IsEmpty() )
-			{
-				UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Received unknown event type: %s"), *EventType);
-			}
-			else 
-			{
-				UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Received empty event!"));
-			}
+	}
+
+	for (FQueuedEvent& Event : Backlog)
+	{
+		if (!Event.bCoalesced)
+		{
+			LensData.ArrivalTime = Event.ArrivalTime;
+			LensData.WorldTime = Event.WorldTime;
+			bIsLateEvent = Event.bLate;
+			DispatchEvent(Event.EventType, Event.JsonObject);
 		}
 	}
-	else {
-		UE_LOG(LogLiveLinkDragonMessageThread, Log, TEXT("Received event with no type: %s"), *InPacket);
+
+	Backlog.Reset();
+
+	// Once per batch, readers only ever want the latest
+	PublishDevice();
+}
+
+void FLiveLinkDragonMessageThread::DispatchEvent(ELiveLinkDragonEventType EventType, const TSharedPtr<FJsonObject>& JsonObject)
+{
+	switch (EventType)
+	{
+	case ELiveLinkDragonEventType::KeepAlive:
+		HandleKeepAliveEvent(JsonObject);
+		break;
+	case ELiveLinkDragonEventType::Position:
+		HandlePositionEvent(JsonObject);
+		break;
+	case ELiveLinkDragonEventType::CaptureState:
+		HandleCaptureStateEvent(JsonObject);
+		break;
+	case ELiveLinkDragonEventType::Shoot:
+		HandleShootEvent(JsonObject);
+		break;
+	case ELiveLinkDragonEventType::Delete:
+		HandleDeleteEvent(JsonObject);
+		break;
+	case ELiveLinkDragonEventType::CaptureComplete:
+		HandleCaptureCompleteEvent(JsonObject);
+		break;
+	case ELiveLinkDragonEventType::FrameComplete:
+		HandleFrameCompleteEvent(JsonObject);
+		break;
+	case ELiveLinkDragonEventType::ViewFrame:
+		HandleViewFrameEvent(JsonObject);
+		break;
+	default:
+		break;
 	}
 }
 
@@ -228,7 +1045,210 @@ void FLiveLinkDragonMessageThread::HandleKeepAliveEvent(const TSharedPtr<FJsonOb
 	}
 
 	// Send a handshake reply
-	InitiateHandshake();
+	InitiateHandshake(true);
+}
+
+void FLiveLinkDragonMessageThread::UpdateSceneString(FDragonStringHandle& Field, const TSharedPtr<FJsonObject>& InJsonObject, const FString& FieldName)
+{
+	FString Value;
+	if (!InJsonObject->TryGetStringField(FieldName, Value))
+	{
+		return;
+	}
+
+	if (SceneStrings.Get(Field).Equals(Value, ESearchCase::CaseSensitive))
+	{
+		return;
+	}
+
+	const FDragonStringHandle NewHandle = SceneStrings.Intern(Value);
+	if (NewHandle != Field)
+	{
+		Field = NewHandle;
+		bSceneMetadataDirty = true;
+		bDeviceStringsDirty = true;
+	}
+}
+
+void FLiveLinkDragonMessageThread::UpdateSceneStrings(const TSharedPtr<FJsonObject>& InJsonObject)
+{
+	UpdateSceneString(DragonDevice.Production, InJsonObject, ProductionString);
+	UpdateSceneString(DragonDevice.Scene, InJsonObject, SceneString);
+	UpdateSceneString(DragonDevice.Take, InJsonObject, TakeString);
+	UpdateSceneString(DragonDevice.ExposureName, InJsonObject, ExposureNameString);
+}
+
+void FLiveLinkDragonMessageThread::UpdateImageFileName(const TSharedPtr<FJsonObject>& InJsonObject)
+{
+	FString Value;
+	if (InJsonObject->TryGetStringField(ImageFileNameString, Value) && !DragonDevice.ImageFileName.Equals(Value, ESearchCase::CaseSensitive))
+	{
+		DragonDevice.ImageFileName = MoveTemp(Value);
+		bSceneMetadataDirty = true;
+		bDeviceStringsDirty = true;
+	}
+}
+
+FLiveLinkDragonMessageThread::FCaptureRef FLiveLinkDragonMessageThread::GetCurrentCapture() const
+{
+	FCaptureRef Capture;
+	Capture.Production = DragonDevice.Production;
+	Capture.Scene = DragonDevice.Scene;
+	Capture.Take = DragonDevice.Take;
+	Capture.Frame = DragonDevice.Frame;
+	Capture.Exposure = DragonDevice.Exposure;
+	Capture.StereoIndex = DragonDevice.StereoIndex;
+	return Capture;
+}
+
+void FLiveLinkDragonMessageThread::JournalCapture(EDragonCaptureRecordFlags Flags, const FCaptureRef& Capture)
+{
+	if (!CaptureJournal)
+	{
+		return;
+	}
+
+	FDragonCaptureJournalEntry Entry;
+	Entry.Production = SceneStrings.Get(Capture.Production);
+	Entry.Scene = SceneStrings.Get(Capture.Scene);
+	Entry.Take = SceneStrings.Get(Capture.Take);
+
+	FDragonCaptureRecord& Record = Entry.Record;
+	Record.CaptureTimeUtcTicks = FDateTime::UtcNow().GetTicks();
+	Record.WorldTime = LensData.WorldTime;
+	Record.FocalLength = LensData.FocalLength;
+	Record.FocusDistance = LensData.FocusDistance;
+	Record.Aperture = LensData.Aperture;
+	Record.HorizontalFOV = LensData.HorizontalFOV;
+	Record.Frame = Capture.Frame;
+	Record.Exposure = Capture.Exposure;
+	Record.StereoIndex = Capture.StereoIndex;
+	Record.Flags = Flags;
+
+	FTCHARToUTF8 ImageFileName(*DragonDevice.ImageFileName);
+	FMemory::Memcpy(Record.ImageFileName, ImageFileName.Get(), FMath::Min<int32>(ImageFileName.Length(), FDragonCaptureRecord::MaxImageFileNameLength - 1));
+
+	CaptureJournal->Enqueue(MoveTemp(Entry));
+}
+
+void FLiveLinkDragonMessageThread::PublishCapture(ELiveLinkDragonCaptureEventKind Kind, const FCaptureRef& Capture)
+{
+	// The task handler only rebroadcasts, don't copy the event and launch a task when nobody listens there
+	const bool bLaunchTask = CaptureReadyTaskDelegate.IsBound() && FLiveLinkDragonCaptureEvents::OnCapture_AnyThread().IsBound();
+	if (!CaptureReadyDelegate.IsBound() && !bLaunchTask)
+	{
+		return;
+	}
+
+	FLiveLinkDragonCaptureEvent Event;
+	Event.Kind = Kind;
+	Event.Production = SceneStrings.Get(Capture.Production);
+	Event.Scene = SceneStrings.Get(Capture.Scene);
+	Event.Take = SceneStrings.Get(Capture.Take);
+	Event.ImageFileName = DragonDevice.ImageFileName;
+	Event.Frame = Capture.Frame;
+	Event.Exposure = Capture.Exposure;
+	Event.StereoIndex = Capture.StereoIndex;
+	Event.bFrameComplete = Kind == ELiveLinkDragonCaptureEventKind::FrameComplete;
+	Event.FocalLength = LensData.FocalLength;
+	Event.FocusDistance = LensData.FocusDistance;
+	Event.Aperture = LensData.Aperture;
+	Event.HorizontalFOV = LensData.HorizontalFOV;
+	Event.WorldTime = LensData.WorldTime;
+
+	CaptureReadyDelegate.ExecuteIfBound(Event);
+
+	if (bLaunchTask)
+	{
+		HandlerPipe.Launch(TEXT("Dragon Capture Handler"), [this, Event = MoveTemp(Event)]()
+		{
+			CaptureReadyTaskDelegate.ExecuteIfBound(Event);
+		});
+	}
+}
+
+namespace LiveLinkDragonMessageThread
+{
+	template<int32 Size>
+	void CopyToUtf8(ANSICHAR (&Destination)[Size], const FString& Value)
+	{
+		const FTCHARToUTF8 Utf8(*Value);
+		const int32 Length = FMath::Min<int32>(Utf8.Length(), Size - 1);
+		FMemory::Memcpy(Destination, Utf8.Get(), Length);
+		Destination[Length] = 0;
+	}
+}
+
+void FLiveLinkDragonMessageThread::PublishDevice()
+{
+	using namespace LiveLinkDragonMessageThread;
+
+	DeviceSnapshot.bHasAppeared = true;
+	DeviceSnapshot.bReadyToCapture = DragonDevice.ReadyToCapture;
+	DeviceSnapshot.MinAPIVersion = DragonDevice.MinAPIVersion;
+	DeviceSnapshot.MaxAPIVersion = DragonDevice.MaxAPIVersion;
+	DeviceSnapshot.Frame = DragonDevice.Frame;
+	DeviceSnapshot.MocoFrame = DragonDevice.MocoFrame;
+	DeviceSnapshot.Exposure = DragonDevice.Exposure;
+	DeviceSnapshot.StereoIndex = DragonDevice.StereoIndex;
+	DeviceSnapshot.UpdateTime = LensData.WorldTime;
+
+	if (bDeviceStringsDirty)
+	{
+		CopyToUtf8(DeviceSnapshot.Production, SceneStrings.Get(DragonDevice.Production));
+		CopyToUtf8(DeviceSnapshot.Scene, SceneStrings.Get(DragonDevice.Scene));
+		CopyToUtf8(DeviceSnapshot.Take, SceneStrings.Get(DragonDevice.Take));
+		CopyToUtf8(DeviceSnapshot.ExposureName, SceneStrings.Get(DragonDevice.ExposureName));
+		CopyToUtf8(DeviceSnapshot.CaptureState, SceneStrings.Get(DragonDevice.CaptureState));
+		CopyToUtf8(DeviceSnapshot.ImageFileName, DragonDevice.ImageFileName);
+		bDeviceStringsDirty = false;
+	}
+
+	Metrics.Device.Write(DeviceSnapshot);
+}
+
+void FLiveLinkDragonMessageThread::PublishFrame()
+{
+	static const FName ProductionKey(TEXT("Production"));
+	static const FName SceneKey(TEXT("Scene"));
+	static const FName TakeKey(TEXT("Take"));
+	static const FName ExposureNameKey(TEXT("ExposureName"));
+	static const FName CaptureStateKey(TEXT("CaptureState"));
+	static const FName ImageFileNameKey(TEXT("ImageFileName"));
+
+	if (bSceneMetadataDirty || !SceneMetadata.IsValid())
+	{
+		TSharedRef<TMap<FName, FString>, ESPMode::ThreadSafe> NewMetadata = MakeShared<TMap<FName, FString>, ESPMode::ThreadSafe>();
+		auto AddIfSet = [&NewMetadata](FName Key, const FString& Value)
+		{
+			if (!Value.IsEmpty())
+			{
+				NewMetadata->Add(Key, Value);
+			}
+		};
+		AddIfSet(ProductionKey, SceneStrings.Get(DragonDevice.Production));
+		AddIfSet(SceneKey, SceneStrings.Get(DragonDevice.Scene));
+		AddIfSet(TakeKey, SceneStrings.Get(DragonDevice.Take));
+		AddIfSet(ExposureNameKey, SceneStrings.Get(DragonDevice.ExposureName));
+		AddIfSet(CaptureStateKey, SceneStrings.Get(DragonDevice.CaptureState));
+		AddIfSet(ImageFileNameKey, DragonDevice.ImageFileName);
+
+		SceneMetadata = NewMetadata;
+		bSceneMetadataDirty = false;
+	}
+
+	// Only the pointer is copied here, the source copies the strings into a subject's frame when the map is new to it
+	LensData.SceneMetadata = SceneMetadata;
+
+	LensData.StereoIndex = DragonDevice.StereoIndex;
+	LensData.Frame = DragonDevice.Frame;
+	LensData.MocoFrame = DragonDevice.MocoFrame;
+	LensData.Exposure = DragonDevice.Exposure;
+	LensData.bReadyToCapture = DragonDevice.ReadyToCapture;
+
+	FrameDataReadyDelegate.ExecuteIfBound(LensData);
+
+	LensData.SceneMetadata.Reset();
 }
 
 // NB - ther is a 'better' way to do this that decodes the JSON into a struct directly
@@ -247,10 +1267,7 @@ void FLiveLinkDragonMessageThread::HandlePositionEvent(const TSharedPtr<FJsonObj
 	//  "exposureName" : "[EXPOSURE NAME]",
 	//  "stereoIndex" : [INDEX]}
 
-	DragonDevice.Production = InJsonObject->GetStringField(ProductionString);
-	DragonDevice.Scene = InJsonObject->GetStringField(SceneString);
-	DragonDevice.Take = InJsonObject->GetStringField(TakeString);
-	DragonDevice.ExposureName = InJsonObject->GetStringField(ExposureNameString);
+	UpdateSceneStrings(InJsonObject);
 
 	DragonDevice.Frame = InJsonObject->GetNumberField(FrameString);
 	DragonDevice.MocoFrame = InJsonObject->GetNumberField(MocoFrameString);
@@ -258,7 +1275,7 @@ void FLiveLinkDragonMessageThread::HandlePositionEvent(const TSharedPtr<FJsonObj
 	DragonDevice.StereoIndex = InJsonObject->GetNumberField(StereoIndexString);
 
 	// respond to this?
-	FrameDataReadyDelegate.ExecuteIfBound(LensData);
+	PublishFrame();
 }
 
 void FLiveLinkDragonMessageThread::HandleShootEvent(const TSharedPtr<FJsonObject> InJsonObject)
@@ -273,17 +1290,20 @@ void FLiveLinkDragonMessageThread::HandleShootEvent(const TSharedPtr<FJsonObject
 
 	// }
 
-	DragonDevice.Production = InJsonObject->GetStringField(ProductionString);
-	DragonDevice.Scene = InJsonObject->GetStringField(SceneString);
-	DragonDevice.Take = InJsonObject->GetStringField(TakeString);
-	DragonDevice.ExposureName = InJsonObject->GetStringField(ExposureNameString);
+	UpdateSceneStrings(InJsonObject);
 
 	DragonDevice.Frame = InJsonObject->GetNumberField(FrameString);
 	DragonDevice.Exposure = InJsonObject->GetNumberField(ExposureString);
 	DragonDevice.StereoIndex = InJsonObject->GetNumberField(StereoIndexString);
 
-	FrameDataReadyDelegate.ExecuteIfBound(LensData);
-	// respond to this?
+	// A late shoot is from before captures we already have, it must not wind the position back
+	if (!bIsLateEvent)
+	{
+		SequenceTracker.OnShoot(SceneStrings.Get(DragonDevice.Take), DragonDevice.Frame);
+	}
+
+	PublishCapture(ELiveLinkDragonCaptureEventKind::Shoot, GetCurrentCapture());
+	PublishFrame();
 }
 
 void FLiveLinkDragonMessageThread::HandleDeleteEvent(const TSharedPtr<FJsonObject> InJsonObject)
@@ -293,12 +1313,23 @@ void FLiveLinkDragonMessageThread::HandleDeleteEvent(const TSharedPtr<FJsonObjec
 	// 	"scene" : "SCENE",
 	// 	"take" : "READY"	
 
-	DragonDevice.Production = InJsonObject->GetStringField(ProductionString);
-	DragonDevice.Scene = InJsonObject->GetStringField(SceneString);
-	DragonDevice.Take = InJsonObject->GetStringField(TakeString);
+	if (!bIsLateEvent)
+	{
+		SequenceTracker.OnDelete(InJsonObject->GetStringField(TakeString));
+	}
 
-	FrameDataReadyDelegate.ExecuteIfBound(LensData);
-	// respond to this?
+	UpdateSceneStrings(InJsonObject);
+
+	// Deletes carry no frame, Dragonframe always deletes the last one captured, and the one before it is next.
+	// The current position is usually the frame about to be shot, so it can't stand in.
+	if (LastCapture.Frame != INDEX_NONE)
+	{
+		JournalCapture(EDragonCaptureRecordFlags::Deleted, LastCapture);
+	}
+	PublishCapture(ELiveLinkDragonCaptureEventKind::Delete, LastCapture);
+	LastCapture.Frame = LastCapture.Frame > 0 ? LastCapture.Frame - 1 : INDEX_NONE;
+
+	PublishFrame();
 }
 
 void FLiveLinkDragonMessageThread::HandleCaptureStateEvent(const TSharedPtr<FJsonObject> InJsonObject)
@@ -309,10 +1340,10 @@ void FLiveLinkDragonMessageThread::HandleCaptureStateEvent(const TSharedPtr<FJso
 	// }
 
 	DragonDevice.ReadyToCapture = InJsonObject->GetBoolField(ReadyToCaptureString);
-	DragonDevice.CaptureState = InJsonObject->GetStringField(StateString);
+	UpdateSceneString(DragonDevice.CaptureState, InJsonObject, StateString);
 
 	// respond to this?
-	FrameDataReadyDelegate.ExecuteIfBound(LensData);
+	PublishFrame();
 }
 
 void FLiveLinkDragonMessageThread::HandleCaptureCompleteEvent(const TSharedPtr<FJsonObject> InJsonObject)
@@ -327,18 +1358,24 @@ void FLiveLinkDragonMessageThread::HandleCaptureCompleteEvent(const TSharedPtr<F
 	// 	"stereoIndex" : 0,
 	// }
 
-	DragonDevice.Production = InJsonObject->GetStringField(ProductionString);
-	DragonDevice.Scene = InJsonObject->GetStringField(SceneString);
-	DragonDevice.Take = InJsonObject->GetStringField(TakeString);
-	DragonDevice.ExposureName = InJsonObject->GetStringField(ExposureNameString);
+	if (!SequenceTracker.OnCapture(InJsonObject->GetStringField(TakeString), InJsonObject->GetNumberField(FrameString), InJsonObject->GetNumberField(ExposureString), false, bIsLateEvent))
+	{
+		SequenceTracker.OnStaleUpdateDropped();
+		return;
+	}
+
+	UpdateSceneStrings(InJsonObject);
 
 	DragonDevice.Frame = InJsonObject->GetNumberField(FrameString);
 	DragonDevice.Exposure = InJsonObject->GetNumberField(ExposureString);
 	DragonDevice.StereoIndex = InJsonObject->GetNumberField(StereoIndexString);
 
-	DragonDevice.ImageFileName = InJsonObject->GetStringField(ImageFileNameString);
+	UpdateImageFileName(InJsonObject);
+	LastCapture = GetCurrentCapture();
+	JournalCapture(EDragonCaptureRecordFlags::None, LastCapture);
+	PublishCapture(ELiveLinkDragonCaptureEventKind::CaptureComplete, LastCapture);
 
-	FrameDataReadyDelegate.ExecuteIfBound(LensData);
+	PublishFrame();
 }
 
 void FLiveLinkDragonMessageThread::HandleFrameCompleteEvent(const TSharedPtr<FJsonObject> InJsonObject)
@@ -353,18 +1390,30 @@ void FLiveLinkDragonMessageThread::HandleFrameCompleteEvent(const TSharedPtr<FJs
 	// 	"stereoIndex" : 0,
 	// }
 
-	DragonDevice.Production = InJsonObject->GetStringField(ProductionString);
-	DragonDevice.Scene = InJsonObject->GetStringField(SceneString);
-	DragonDevice.Take = InJsonObject->GetStringField(TakeString);
-	DragonDevice.ExposureName = InJsonObject->GetStringField(ExposureNameString);
+	if (!SequenceTracker.OnCapture(InJsonObject->GetStringField(TakeString), InJsonObject->GetNumberField(FrameString), InJsonObject->GetNumberField(ExposureString), true, bIsLateEvent))
+	{
+		SequenceTracker.OnStaleUpdateDropped();
+		return;
+	}
+
+	UpdateSceneStrings(InJsonObject);
 
 	DragonDevice.Frame = InJsonObject->GetNumberField(FrameString);
 	DragonDevice.Exposure = InJsonObject->GetNumberField(ExposureString);
 	DragonDevice.StereoIndex = InJsonObject->GetNumberField(StereoIndexString);
 
-	DragonDevice.ImageFileName = InJsonObject->GetStringField(ImageFileNameString);
+	UpdateImageFileName(InJsonObject);
 
-	FrameDataReadyDelegate.ExecuteIfBound(LensData);
+	// The frame's last exposure was journalled by its captureComplete, only write it here if that never arrived
+	const FCaptureRef Capture = GetCurrentCapture();
+	if (!(Capture == LastCapture))
+	{
+		JournalCapture(EDragonCaptureRecordFlags::FrameComplete, Capture);
+	}
+	LastCapture = Capture;
+	PublishCapture(ELiveLinkDragonCaptureEventKind::FrameComplete, Capture);
+
+	PublishFrame();
 }
 
 void FLiveLinkDragonMessageThread::HandleViewFrameEvent(const TSharedPtr<FJsonObject> InJsonObject)
@@ -373,14 +1422,14 @@ void FLiveLinkDragonMessageThread::HandleViewFrameEvent(const TSharedPtr<FJsonOb
 	DragonDevice.Frame = InJsonObject->GetNumberField(FrameString);
 	DragonDevice.Exposure = InJsonObject->GetNumberField(ExposureString);
 
-	FrameDataReadyDelegate.ExecuteIfBound(LensData);
+	PublishFrame();
 }
 
 //////////////////////////////////////////////////////////////////////////
 //
 // Low level goodness
 //
-void FLiveLinkDragonMessageThread::InitiateHandshake()
+void FLiveLinkDragonMessageThread::InitiateHandshake(bool bAnswersHello)
 {
 	TSharedPtr<FJsonObject> JsonObject = MakeShared<FJsonObject>();
 
@@ -388,7 +1437,11 @@ void FLiveLinkDragonMessageThread::InitiateHandshake()
 	JsonObject->SetStringField(CommandString, KeepAliveString);
 	JsonObject->SetNumberField(VersionString, DragonAPIVersion);
 	JsonObject->SetBoolField(DoNotPingString, true); // keep it from timing out
-	SendMessageToServer( JsonObject );
+	const bool bSentHello = SendMessageToServer( JsonObject );
+
+	// Dragonframe answers with position and capture state, the first of which closes the round trip.
+	// Nothing to time if the hello never went out, and whatever arrives next would not be its answer.
+	HandshakeSentTime = bSentHello && bAnswersHello ? FPlatformTime::Seconds() : 0.0;
 
 	JsonObject->Values.Empty();
 
@@ -396,10 +1449,19 @@ void FLiveLinkDragonMessageThread::InitiateHandshake()
 	JsonObject->SetBoolField(ActiveString, true);
 	SendMessageToServer( JsonObject );
 
-	bIsHandshook = true;
+	// Only ever sent because Dragonframe just sent us something, its hello or any other event, so it is there and
+	// talking. Waiting for a further event would time out whenever the animator is idle after the handshake.
+	SetSessionState(ELiveLinkDragonSessionState::Active);
 
 	// Call the delegate to let the rest of UE know that the handshake is complete
 	HandshakeEstablishedDelegate.ExecuteIfBound();
+	if (HandshakeEstablishedTaskDelegate.IsBound())
+	{
+		HandlerPipe.Launch(TEXT("Dragon Handshake Handler"), [this]()
+		{
+			HandshakeEstablishedTaskDelegate.ExecuteIfBound();
+		});
+	}
 
 	// After this, it sends a position and a 'ready to go' event
 
@@ -408,23 +1470,33 @@ void FLiveLinkDragonMessageThread::InitiateHandshake()
 	// SubscribeToDeviceMetadataUpdates(EDragonDeviceType::Lens);
 }
 
-void FLiveLinkDragonMessageThread::SendMessageToServer(const TSharedPtr<FJsonObject> JsonObject)
+bool FLiveLinkDragonMessageThread::SendMessageToServer(const TSharedPtr<FJsonObject> JsonObject)
 {
 	FString Msg;
 	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Msg);
 	FJsonSerializer::Serialize(JsonObject.ToSharedRef(), Writer);
 
-	TSharedRef<FInternetAddr> RemoteAddress = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
-	
-	bool OK;
-	RemoteAddress->SetIp(*RemoteIP, OK);
-	RemoteAddress->SetPort(RemotePort);
+	const FTCHARToUTF8 Utf8(*Msg);
+	return SendBytesToServer(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+}
 
-	int32 Sent;
-	Socket->SendTo((uint8 *)TCHAR_TO_UTF8(*Msg), Msg.Len(), Sent, *RemoteAddress);
+bool FLiveLinkDragonMessageThread::SendBytesToServer(const uint8* InData, int32 InDataSize)
+{
+	// Nobody has talked to us yet, we're between sockets, or another node answers Dragonframe
+	if (!ReplyAddress.IsValid() || !Socket || !ConnectionSettings.bReplyToSender)
+	{
+		return false;
+	}
+
+	int32 Sent = 0;
+	Socket->SendTo(InData, InDataSize, Sent, *ReplyAddress);
 
-	if (Sent != Msg.Len())
-		UE_LOG(LogLiveLinkDragonMessageThread, Warning, TEXT("Full message was not sent to the Dragon server %d vs %d"), Sent, Msg.Len());
+	if (Sent != InDataSize)
+	{
+		UE_LOG(LogLiveLinkDragonMessageThread, Warning, TEXT("Full message was not sent to the Dragon server %d vs %d"), Sent, InDataSize);
+		return false;
+	}
+	return true;
 }
 
 void FLiveLinkDragonMessageThread::AcknowledgeMessageFromServer(const TArray<uint8> InMessageFromServer, const uint32 InServerMessageLength)
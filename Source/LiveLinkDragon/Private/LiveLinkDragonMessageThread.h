@@ -17,6 +17,18 @@
 #include "Serialization/JsonReader.h"
 #include "Serialization/JsonSerializer.h"
 
+#include "LiveLinkDragonCaptureEvents.h"
+#include "LiveLinkDragonCaptureJournalWriter.h"
+#include "LiveLinkDragonClockSync.h"
+#include "LiveLinkDragonConnectionSettings.h"
+#include "LiveLinkDragonHandlerPipe.h"
+#include "LiveLinkDragonMetrics.h"
+#include "LiveLinkDragonReceiveBuffer.h"
+#include "LiveLinkDragonSenderFilter.h"
+#include "LiveLinkDragonSequenceTracker.h"
+#include "LiveLinkDragonStringTable.h"
+#include "LiveLinkDragonTrace.h"
+
 class FRunnable;
 class FSocket;
 
@@ -28,6 +40,7 @@ struct FLensPacket;
 
 DECLARE_DELEGATE_OneParam(FOnFrameDataReady, FLensPacket InData);
 DECLARE_DELEGATE(FOnHandshakeEstablished);
+DECLARE_DELEGATE_OneParam(FOnCaptureReady, FLiveLinkDragonCaptureEvent InEvent);
 
 struct FLensPacket
 {
@@ -41,6 +54,24 @@ struct FLensPacket
 	float DistortionData[6] = { 0.0f };
 
 	float FocalLength = 0.0f;
+
+	// Which eye of a stereo rig the event was for, 0 for mono or the left eye
+	uint16 StereoIndex = 0;
+
+	// Scene state, for the state subject
+	uint16 Frame = 0;
+	uint16 MocoFrame = 0;
+	uint16 Exposure = 0;
+	bool bReadyToCapture = false;
+
+	// When the datagram this came from arrived, in FPlatformTime::Seconds()
+	double ArrivalTime = 0.0;
+
+	// When the datagram was sent, in our clock, after clock sync corrections
+	double WorldTime = 0.0;
+
+	// Production, scene, take etc. for LiveLink string metadata. Shared and never modified, a new map means the strings changed.
+	TSharedPtr<const TMap<FName, FString>, ESPMode::ThreadSafe> SceneMetadata;
 };
 
 enum class EDragonDeviceType : uint8
@@ -77,10 +108,11 @@ struct FDragonDevice
 	double MaxAPIVersion = 0.0;
 
 	//~ Begin scene state information
-	FString Production;
-	FString Scene;
-	FString Take;
-	FString ExposureName;
+	// Interned, these repeat in nearly every event but rarely change
+	FDragonStringHandle Production;
+	FDragonStringHandle Scene;
+	FDragonStringHandle Take;
+	FDragonStringHandle ExposureName;
 
 	uint16 Frame = 0;
 	uint16 MocoFrame = 0;
@@ -89,7 +121,9 @@ struct FDragonDevice
 	uint16 StereoIndex = 0;
 
 	bool ReadyToCapture = false;
-	FString CaptureState;
+	FDragonStringHandle CaptureState;
+
+	// Different for every capture, so not worth interning
 	FString ImageFileName;
 	//~ End scene state information
 
@@ -176,7 +210,7 @@ class FLiveLinkDragonMessageThread : public FRunnable
 {
 public:
 
-	FLiveLinkDragonMessageThread(FSocket* InSocket);
+	FLiveLinkDragonMessageThread(const FLiveLinkDragonConnectionSettings& InConnectionSettings, FLiveLinkDragonMetrics& InMetrics);
 	~FLiveLinkDragonMessageThread();
 
 	void Start();
@@ -196,6 +230,26 @@ public:
 		return HandshakeEstablishedDelegate;
 	}
 
+	FOnCaptureReady& OnCaptureReady_AnyThread()
+	{
+		return CaptureReadyDelegate;
+	}
+
+	/**
+	 * Handlers too slow to run on the socket thread. They run on the task system, in the order their events
+	 * arrived, after the inline handler for the same event. Dropped if too many are already waiting.
+	 * Capture tasks are only launched while FLiveLinkDragonCaptureEvents::OnCapture_AnyThread has listeners.
+	 */
+	FOnHandshakeEstablished& OnHandshakeEstablished_Task()
+	{
+		return HandshakeEstablishedTaskDelegate;
+	}
+
+	FOnCaptureReady& OnCaptureReady_Task()
+	{
+		return CaptureReadyTaskDelegate;
+	}
+
 public:
 
 	//~ FRunnable Interface
@@ -206,9 +260,98 @@ public:
 
 private:
 
+	enum class EReceiveResult : uint8
+	{
+		Received,
+		NoData,
+		Error,
+	};
+
+	//~ Begin session state machine
+	/** Create and bind the socket. On failure, schedules the next attempt with exponential backoff. */
+	bool BindSocket();
+	FSocket* BuildMulticastSocket(uint16 PortNumber) const;
+	void DestroySocket();
+	void OnSocketError();
+
+	/** Drive the session from an event Dragonframe sent us */
+	void OnSessionEvent(ELiveLinkDragonEventType EventType);
+	void OnPeerRestarted();
+
+	/** Timed transitions, i.e. going stale */
+	void UpdateSessionTimers();
+	void SetSessionState(ELiveLinkDragonSessionState NewState);
+	//~ End session state machine
+
+	/** Read one datagram into the backlog, then handle the backlog once nothing more is waiting on the socket */
+	EReceiveResult ReceivePacket(FInternetAddr& RemoteAddress, FLiveLinkDragonLatencyHistogram& ReceiveLatency);
+	EReceiveResult ReceiveDatagram(FInternetAddr& RemoteAddress, FLiveLinkDragonLatencyHistogram& ReceiveLatency);
+
+	/** Remember who to reply to and give them a trace handle. Only runs when the sender changes. */
+	void OnSenderChanged(const FInternetAddr& RemoteAddress);
+
+	/** Spin on the non-blocking socket until the busy-poll budget runs out with nothing arriving. Returns false on socket error. */
+	bool BusyPoll(FInternetAddr& RemoteAddress);
+	void UpdateBusyPollReport();
+
+	double GetWaitTimeout() const;
+	void HandlePong(const uint8* Payload, int32 PayloadSize, uint64 RemoteTransmitTime, double ArrivalTime);
+	void SendClockPing();
+
+	/** Relays ping us to measure their hop to this node */
+	void AnswerPing(const uint8* Payload, int32 PayloadSize, uint32 Sequence, double ArrivalTime);
+	void PublishClockSync();
+
+	/** Publish connection state and telemetry for other threads. Throttled unless forced. */
+	void PublishStatus(bool bForce);
+
 	void GenerateFrameRateMap();
 
-	void ParsePacket(const FString InPacket);
+	/** Parse an event and queue it on the backlog, stamped with when its datagram arrived */
+	void ParsePacket(TArrayView<const uint8> InPacket, double ArrivalTime, double WorldTime);
+	static ELiveLinkDragonEventType ClassifyEvent(const FString& EventType);
+
+	/** Position, capture state and view frame replace what came before, so only the newest of each matters */
+	static bool IsStateUpdate(ELiveLinkDragonEventType EventType);
+
+	/** Coalesce the backlog's state updates to the newest per subject, then handle what is left in order */
+	void ProcessBacklog();
+	void DispatchEvent(ELiveLinkDragonEventType EventType, const TSharedPtr<FJsonObject>& JsonObject);
+
+	/** Update an interned scene field from the event, if present. Marks the metadata dirty only when the value actually changed. */
+	void UpdateSceneString(FDragonStringHandle& Field, const TSharedPtr<FJsonObject>& InJsonObject, const FString& FieldName);
+	void UpdateSceneStrings(const TSharedPtr<FJsonObject>& InJsonObject);
+	void UpdateImageFileName(const TSharedPtr<FJsonObject>& InJsonObject);
+
+	/** Which capture a journal record or capture event is about */
+	struct FCaptureRef
+	{
+		FDragonStringHandle Production;
+		FDragonStringHandle Scene;
+		FDragonStringHandle Take;
+		int32 Frame = INDEX_NONE;
+		int32 Exposure = 0;
+		int32 StereoIndex = 0;
+
+		bool operator==(const FCaptureRef& Other) const
+		{
+			return Frame == Other.Frame && Exposure == Other.Exposure && StereoIndex == Other.StereoIndex
+				&& Take == Other.Take && Scene == Other.Scene && Production == Other.Production;
+		}
+	};
+
+	/** The capture the device state is on, i.e. the one the event just handled was for */
+	FCaptureRef GetCurrentCapture() const;
+
+	/** Queue the capture for the journal, if it is enabled */
+	void JournalCapture(EDragonCaptureRecordFlags Flags, const FCaptureRef& Capture);
+	void PublishCapture(ELiveLinkDragonCaptureEventKind Kind, const FCaptureRef& Capture);
+
+	/** Hand the current lens data to the source, with the scene metadata attached */
+	void PublishFrame();
+
+	/** Copy the device state out for other threads. Strings are only re-encoded when one changed. */
+	void PublishDevice();
 
 	void HandleKeepAliveEvent(const TSharedPtr<FJsonObject> InEvent);
 	void HandlePositionEvent(const TSharedPtr<FJsonObject> InEvent);
@@ -219,9 +362,12 @@ private:
 	void HandleFrameCompleteEvent(const TSharedPtr<FJsonObject> InEvent);
 	void HandleViewFrameEvent(const TSharedPtr<FJsonObject> InEvent);
 	
-	void InitiateHandshake();
+	/** Say hello back. Only a hello answering Dragonframe's own is timed for clock sync, otherwise more events are likely already on their way. */
+	void InitiateHandshake(bool bAnswersHello);
 
-	void SendMessageToServer(const TSharedPtr<FJsonObject> InMessageToSend);
+	/** True if the whole message went out. Listener nodes that leave replies to another node send nothing. */
+	bool SendMessageToServer(const TSharedPtr<FJsonObject> InMessageToSend);
+	bool SendBytesToServer(const uint8* InData, int32 InDataSize);
 	void AcknowledgeMessageFromServer(const TArray<uint8> InMessageFromServer, const uint32 InServerMessageLength);
 
 	void HashDataRequestMessage(const FArrayWriter InMessage, const FString InRequestName);
@@ -234,18 +380,43 @@ private:
 	
 private:
 	
-	//ISocketSubsystem *SocketSubsystem = nullptr;
-	FSocket* const Socket;
+	// Owned by the thread, so it can be thrown away and rebound when it fails
+	FSocket* Socket = nullptr;
+
+	const FLiveLinkDragonConnectionSettings ConnectionSettings;
+	FLiveLinkDragonMetrics& Metrics;
+
+	// Datagrams land in pooled buffers. One is kept in hand between packets, so an empty poll costs nothing.
+	FLiveLinkDragonReceiveBufferPool ReceiveBuffers;
+	FDragonReceiveBuffer PendingReceiveBuffer;
 
-	// The IP address and port of the Dragonframe client
-	FString RemoteIP;
-	int32 RemotePort;
+	// Where the last datagram came from, which is who we talk back to
+	TSharedPtr<FInternetAddr> ReplyAddress;
+	// Senders seen lately, oldest first, with the trace handle each was given. Handles are never reused, so records
+	// still in flight when a sender is forgotten keep pointing at the right one. 0 is no sender yet.
+	TArray<TPair<TSharedRef<FInternetAddr>, uint32>> KnownSenders;
+	uint32 SenderHandle = 0;
+	uint32 LastSenderHandle = 0;
+
+	FLiveLinkDragonSenderFilter SenderFilter;
+
+	FLiveLinkDragonTrace Trace;
 
 	TUniquePtr<FRunnableThread>	Thread;
 	bool bIsThreadRunning = false;
 
-	// handshaky stuff -  first time through
-	bool bIsHandshook = false;
+	// Session state machine
+	ELiveLinkDragonSessionState SessionState = ELiveLinkDragonSessionState::Unbound;
+	double SessionStateTime = 0.0;
+	double NextBindTime = 0.0;
+	double BindBackoff = InitialBindBackoff;
+	bool bHasBound = false;
+
+	// When the session last broke, zero if it is healthy. Going stale is only tentatively a failure,
+	// it might just be a quiet stretch between shots.
+	double FailureTime = 0.0;
+	bool bFailureTentative = false;
+	float LastRecoverySeconds = 0.0f;
 
 	// // probably unnecessary
 	// TMap<FMessageHash, FString> DataRequests;
@@ -253,6 +424,9 @@ private:
 
 	FDragonDevice DragonDevice;
 
+	// The last capture that completed. Deletes carry no frame and always remove it, Frame is INDEX_NONE if there's none.
+	FCaptureRef LastCapture;
+
 	// useful for something
 	TMap<FString, FFrameRate> FrameRates;
 	FFrameRate DragonFrameRate = { 24, 0 };
@@ -260,8 +434,70 @@ private:
 
 	FLensPacket LensData;
 
+	// Null unless capture journalling is enabled
+	TUniquePtr<FLiveLinkDragonCaptureJournalWriter> CaptureJournal;
+
+	// Scene metadata, rebuilt only when one of its strings changes
+	FLiveLinkDragonStringTable SceneStrings;
+	TSharedPtr<const TMap<FName, FString>, ESPMode::ThreadSafe> SceneMetadata;
+	bool bSceneMetadataDirty = true;
+
+	// The last device state published, kept so unchanged strings needn't be encoded again
+	FLiveLinkDragonDeviceSnapshot DeviceSnapshot;
+	bool bDeviceStringsDirty = true;
+
 	FOnHandshakeEstablished HandshakeEstablishedDelegate;
 	FOnFrameDataReady FrameDataReadyDelegate;
+	FOnCaptureReady CaptureReadyDelegate;
+
+	FOnHandshakeEstablished HandshakeEstablishedTaskDelegate;
+	FOnCaptureReady CaptureReadyTaskDelegate;
+
+	// Where the task handlers run. Declared after them, so it drains before they go away.
+	FLiveLinkDragonHandlerPipe HandlerPipe;
+
+	// What gets published in the status snapshot
+	ELiveLinkDragonConnectionState ConnectionState = ELiveLinkDragonConnectionState::Listening;
+	double LastPacketTime = 0.0;
+	double StatusWindowStartTime = 0.0;
+	uint64 StatusWindowStartPackets = 0;
+	uint64 StatusWindowStartBytes = 0;
+	FLiveLinkDragonStatusSnapshot Status;
+
+	// Loss, reorder and duplicate detection
+	FLiveLinkDragonSequenceTracker SequenceTracker;
+	bool bIsLateDatagram = false;
+
+	// Whether the event being handled came from a datagram that arrived late
+	bool bIsLateEvent = false;
+
+	/** An event off the wire that hasn't been handled yet */
+	struct FQueuedEvent
+	{
+		TSharedPtr<FJsonObject> JsonObject;
+		ELiveLinkDragonEventType EventType = ELiveLinkDragonEventType::Unknown;
+		int32 StereoIndex = 0;
+		double ArrivalTime = 0.0;
+		double WorldTime = 0.0;
+		bool bLate = false;
+		bool bCoalesced = false;
+	};
+
+	// Events read while more datagrams were still waiting. Empty between bursts.
+	TArray<FQueuedEvent> Backlog;
+
+	// Clock sync with the Dragonframe or bridge host
+	FLiveLinkDragonClockSync ClockSync;
+	bool bPeerSpeaksBinary = false;
+	double HandshakeSentTime = 0.0;
+	double LastPingTime = 0.0;
+	uint32 PingSequence = 0;
+
+	// Busy-poll bookkeeping for the current report window
+	double BusyPollReportStartTime = 0.0;
+	uint64 BusyPollReportStartSpinMicroseconds = 0;
+	uint64 BusyPollReportStartBlockingPackets = 0;
+	uint64 BusyPollReportStartBusyPollPackets = 0;
 
 	// Pre-allocated space to copy the data for one Dragon packet into
 	// FArrayReader Packet;
@@ -271,7 +507,16 @@ private:
 
 private:
 
-	static constexpr uint32 ReceiveBufferSize = 1024; // these are pretty small tezxt strings
+	static constexpr int32 SocketBufferSize = 1024 * 256; // room for a few maximum size datagrams
+	static constexpr uint16 DefaultPort = 55555;
 	static constexpr uint32 ThreadStackSize = 1024 * 128;
 	static constexpr float Timeout = 10.0f;
+	static constexpr double BusyPollReportInterval = 5.0;
+	static constexpr double StatusPublishInterval = 0.25;
+	static constexpr int32 MaxKnownSenders = 256;
+	static constexpr int32 MaxBacklogEvents = 256; // a flood still gets handled in slices rather than read forever
+	static constexpr double InitialBindBackoff = 0.25;
+	static constexpr double MaxBindBackoff = 8.0;
+	static constexpr double StaleTimeout = 20.0;
+	static constexpr double SessionTickInterval = 1.0;
 };
@@ -0,0 +1,54 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonMetrics.h"
+
+#include "Misc/ScopeLock.h"
+
+namespace LiveLinkDragonMetricsRegistry
+{
+	static FCriticalSection& GetLock()
+	{
+		static FCriticalSection Lock;
+		return Lock;
+	}
+
+	static TArray<FLiveLinkDragonMetricsRegistry::FEntry>& GetEntries()
+	{
+		static TArray<FLiveLinkDragonMetricsRegistry::FEntry> Entries;
+		return Entries;
+	}
+
+	static std::atomic<uint32> Version{ 0 };
+}
+
+void FLiveLinkDragonMetricsRegistry::Register(const FGuid& SourceGuid, FName SubjectName, TSharedRef<const FLiveLinkDragonMetrics, ESPMode::ThreadSafe> Metrics)
+{
+	FScopeLock Lock(&LiveLinkDragonMetricsRegistry::GetLock());
+
+	TArray<FEntry>& Entries = LiveLinkDragonMetricsRegistry::GetEntries();
+	Entries.RemoveAll([&SourceGuid](const FEntry& Entry) { return Entry.SourceGuid == SourceGuid; });
+	Entries.Add(FEntry{ SourceGuid, SubjectName, MoveTemp(Metrics) });
+
+	++LiveLinkDragonMetricsRegistry::Version;
+}
+
+void FLiveLinkDragonMetricsRegistry::Unregister(const FGuid& SourceGuid)
+{
+	FScopeLock Lock(&LiveLinkDragonMetricsRegistry::GetLock());
+
+	if (LiveLinkDragonMetricsRegistry::GetEntries().RemoveAll([&SourceGuid](const FEntry& Entry) { return Entry.SourceGuid == SourceGuid; }) > 0)
+	{
+		++LiveLinkDragonMetricsRegistry::Version;
+	}
+}
+
+TArray<FLiveLinkDragonMetricsRegistry::FEntry> FLiveLinkDragonMetricsRegistry::GetEntries()
+{
+	FScopeLock Lock(&LiveLinkDragonMetricsRegistry::GetLock());
+	return LiveLinkDragonMetricsRegistry::GetEntries();
+}
+
+uint32 FLiveLinkDragonMetricsRegistry::GetVersion()
+{
+	return LiveLinkDragonMetricsRegistry::Version.load();
+}
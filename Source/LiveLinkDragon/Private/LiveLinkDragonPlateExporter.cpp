@@ -0,0 +1,332 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonPlateExporter.h"
+
+#include "LiveLinkDragonCaptureEvents.h"
+#include "LiveLinkDragonSourceSettings.h"
+
+#include "Async/Async.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Features/IModularFeatures.h"
+#include "HAL/FileManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "ILiveLinkClient.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "RHIGPUReadback.h"
+#include "RenderingThread.h"
+#include "TextureResource.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLiveLinkDragonPlates, Log, All);
+
+FLiveLinkDragonPlateWriter::FLiveLinkDragonPlateWriter()
+	: ImageWrapperModule(FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper")))
+{
+}
+
+FLiveLinkDragonPlateWriter::~FLiveLinkDragonPlateWriter()
+{
+	// Workers hold a reference, so by now they are all done
+	while (TArray<uint8>* Pixels = FreeBuffers.Pop())
+	{
+		delete Pixels;
+	}
+}
+
+bool FLiveLinkDragonPlateWriter::IsSupportedFormat(EPixelFormat Format)
+{
+	return Format == PF_B8G8R8A8 || Format == PF_R8G8B8A8 || Format == PF_A2B10G10R10 || Format == PF_FloatRGBA;
+}
+
+TArray<uint8>* FLiveLinkDragonPlateWriter::AcquireBuffer()
+{
+	if (TArray<uint8>* Pixels = FreeBuffers.Pop())
+	{
+		return Pixels;
+	}
+
+	if (NumBuffers.fetch_add(1, std::memory_order_relaxed) >= MaxBuffers)
+	{
+		NumBuffers.fetch_sub(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	return new TArray<uint8>();
+}
+
+void FLiveLinkDragonPlateWriter::Enqueue(FString FileName, FIntPoint Size, EPixelFormat Format, TArray<uint8>* Pixels)
+{
+	bool bStartWorker = false;
+	{
+		FScopeLock ScopeLock(&Lock);
+		Jobs.Add(FJob{ MoveTemp(FileName), Size, Format, Pixels });
+
+		if (ActiveWorkers < MaxWorkers)
+		{
+			++ActiveWorkers;
+			bStartWorker = true;
+		}
+	}
+
+	if (bStartWorker)
+	{
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Writer = AsShared()]()
+		{
+			Writer->RunWorker();
+		});
+	}
+}
+
+void FLiveLinkDragonPlateWriter::RunWorker()
+{
+	for (;;)
+	{
+		FJob Job;
+		{
+			FScopeLock ScopeLock(&Lock);
+			if (Jobs.Num() == 0)
+			{
+				--ActiveWorkers;
+				return;
+			}
+			Job = MoveTemp(Jobs[0]);
+			Jobs.RemoveAt(0, 1, false);
+		}
+
+		Write(Job);
+
+		// Keeps its allocation, the next plate is almost certainly the same size
+		FreeBuffers.Push(Job.Pixels);
+	}
+}
+
+void FLiveLinkDragonPlateWriter::Write(const FJob& Job) const
+{
+	TArray<uint8>& Pixels = *Job.Pixels;
+	const int32 NumPixels = Job.Size.X * Job.Size.Y;
+	if (NumPixels == 0 || Pixels.Num() != NumPixels * GPixelFormats[Job.Format].BlockBytes)
+	{
+		UE_LOG(LogLiveLinkDragonPlates, Warning, TEXT("Plate %s came back empty, skipped"), *Job.FileName);
+		return;
+	}
+
+	ERGBFormat RGBFormat = ERGBFormat::BGRA;
+	TArray<FColor> Converted;
+	const void* Raw = Pixels.GetData();
+	int32 RawSize = Pixels.Num();
+	if (Job.Format == PF_FloatRGBA)
+	{
+		// Float targets hold linear scene color, plates are sRGB like the stills they go with
+		const FFloat16Color* HalfPixels = reinterpret_cast<const FFloat16Color*>(Pixels.GetData());
+		Converted.SetNumUninitialized(NumPixels);
+		for (int32 Index = 0; Index < NumPixels; ++Index)
+		{
+			Converted[Index] = FLinearColor(HalfPixels[Index]).ToFColor(true);
+			Converted[Index].A = 255;
+		}
+		Raw = Converted.GetData();
+		RawSize = Converted.Num() * sizeof(FColor);
+	}
+	else if (Job.Format == PF_A2B10G10R10)
+	{
+		// Already display encoded, red in the low bits, only needs cutting down to 8 bits a channel
+		const uint32* PackedPixels = reinterpret_cast<const uint32*>(Pixels.GetData());
+		Converted.SetNumUninitialized(NumPixels);
+		for (int32 Index = 0; Index < NumPixels; ++Index)
+		{
+			const uint32 Packed = PackedPixels[Index];
+			Converted[Index] = FColor(((Packed >> 0) & 0x3FF) >> 2, ((Packed >> 10) & 0x3FF) >> 2, ((Packed >> 20) & 0x3FF) >> 2, 255);
+		}
+		Raw = Converted.GetData();
+		RawSize = Converted.Num() * sizeof(FColor);
+	}
+	else
+	{
+		// Most render targets leave alpha at zero, which would make the whole plate transparent
+		for (int32 Index = 3; Index < Pixels.Num(); Index += 4)
+		{
+			Pixels[Index] = 255;
+		}
+		RGBFormat = Job.Format == PF_R8G8B8A8 ? ERGBFormat::RGBA : ERGBFormat::BGRA;
+	}
+
+	TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+	if (!ImageWrapper.IsValid() || !ImageWrapper->SetRaw(Raw, RawSize, Job.Size.X, Job.Size.Y, RGBFormat, 8))
+	{
+		UE_LOG(LogLiveLinkDragonPlates, Warning, TEXT("Could not encode plate %s"), *Job.FileName);
+		return;
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Job.FileName), true);
+	if (!FFileHelper::SaveArrayToFile(ImageWrapper->GetCompressed(), *Job.FileName))
+	{
+		UE_LOG(LogLiveLinkDragonPlates, Warning, TEXT("Could not write plate %s"), *Job.FileName);
+	}
+}
+
+FLiveLinkDragonPlateExporter::FLiveLinkDragonPlateExporter()
+	: Writer(MakeShared<FLiveLinkDragonPlateWriter, ESPMode::ThreadSafe>())
+{
+	OnCaptureHandle = FLiveLinkDragonCaptureEvents::OnCapture().AddRaw(this, &FLiveLinkDragonPlateExporter::OnCapture);
+	OnEndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FLiveLinkDragonPlateExporter::OnEndFrame);
+}
+
+FLiveLinkDragonPlateExporter::~FLiveLinkDragonPlateExporter()
+{
+	FLiveLinkDragonCaptureEvents::OnCapture().Remove(OnCaptureHandle);
+	FCoreDelegates::OnEndFrame.Remove(OnEndFrameHandle);
+
+	// Render commands still queued refer to us, and the readbacks are the render thread's to release
+	ENQUEUE_RENDER_COMMAND(LiveLinkDragonReleasePlates)([this](FRHICommandListImmediate& RHICmdList)
+	{
+		Readbacks.Empty();
+	});
+	FlushRenderingCommands();
+}
+
+void FLiveLinkDragonPlateExporter::OnCapture(const FLiveLinkDragonCaptureEvent& Event)
+{
+	// One plate per still, frameComplete has no image of its own
+	if (Event.Kind != ELiveLinkDragonCaptureEventKind::CaptureComplete || Event.ImageFileName.IsEmpty())
+	{
+		return;
+	}
+
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	if (!ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+	{
+		return;
+	}
+	ILiveLinkClient& Client = ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName);
+
+	const ULiveLinkDragonSourceSettings* Settings = Cast<ULiveLinkDragonSourceSettings>(Client.GetSourceSettings(Event.SourceGuid));
+	if (!Settings || !Settings->bExportPlates)
+	{
+		return;
+	}
+
+	// Dragonframe may send a bare name, those plates go where the capture journals do
+	FString Directory = Settings->PlateDirectory.IsEmpty() ? FPaths::GetPath(Event.ImageFileName) : Settings->PlateDirectory;
+	if (Directory.IsEmpty())
+	{
+		Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("LiveLinkDragon"), TEXT("Plates"));
+	}
+	FString FileName = FPaths::Combine(Directory, FPaths::GetBaseFilename(Event.ImageFileName) + Settings->PlateSuffix + TEXT(".png"));
+
+	// Dragonframe's PNG stills would be overwritten by a plate with no suffix
+	if (Settings->PlateSuffix.IsEmpty() || FPaths::IsSamePath(FileName, Event.ImageFileName))
+	{
+		UE_LOG(LogLiveLinkDragonPlates, Warning, TEXT("Plate export for %s needs a plate suffix, the plate would overwrite %s"), *Event.SubjectName.ToString(), *Event.ImageFileName);
+		return;
+	}
+
+	// The game viewport can't be used, its back buffer is only valid until it is presented, before this frame ends
+	UTextureRenderTarget2D* RenderTarget = Cast<UTextureRenderTarget2D>(Settings->PlateRenderTarget.TryLoad());
+	if (RenderTarget == nullptr || RenderTarget->GameThread_GetRenderTargetResource() == nullptr)
+	{
+		UE_LOG(LogLiveLinkDragonPlates, Warning, TEXT("Plate export is enabled for %s but '%s' is not a render target, plates need one"), *Event.SubjectName.ToString(), *Settings->PlateRenderTarget.ToString());
+		return;
+	}
+
+	// Each readback ends up in a writer buffer, there's no point having more in flight than those
+	if (NumReadbacks.load(std::memory_order_relaxed) >= FLiveLinkDragonPlateWriter::MaxBuffers)
+	{
+		UE_LOG(LogLiveLinkDragonPlates, Warning, TEXT("Plates are backing up, dropped %s"), *FileName);
+		return;
+	}
+	NumReadbacks.fetch_add(1, std::memory_order_relaxed);
+
+	Requests.Add(FPlateRequest{ MoveTemp(FileName), TStrongObjectPtr<UTextureRenderTarget2D>(RenderTarget) });
+}
+
+void FLiveLinkDragonPlateExporter::OnEndFrame()
+{
+	if (NumReadbacks.load(std::memory_order_relaxed) == 0)
+	{
+		return;
+	}
+
+	// The targets were kept alive until now, so their resources are only released by commands queued after ours
+	TArray<FPlateCopy> NewCopies;
+	for (FPlateRequest& Request : Requests)
+	{
+		if (FRenderTarget* Target = Request.RenderTarget->GameThread_GetRenderTargetResource())
+		{
+			NewCopies.Add(FPlateCopy{ MoveTemp(Request.FileName), Target });
+		}
+		else
+		{
+			NumReadbacks.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+	Requests.Reset();
+
+	// Queued behind the frame's own drawing, so new copies take the frame the capture arrived in
+	ENQUEUE_RENDER_COMMAND(LiveLinkDragonPlates)([this, NewCopies = MoveTemp(NewCopies)](FRHICommandListImmediate& RHICmdList) mutable
+	{
+		PollReadbacks();
+		for (FPlateCopy& Copy : NewCopies)
+		{
+			StartReadback(RHICmdList, MoveTemp(Copy));
+		}
+	});
+}
+
+void FLiveLinkDragonPlateExporter::StartReadback(FRHICommandListImmediate& RHICmdList, FPlateCopy&& Request)
+{
+	FRHITexture* Texture = Request.Target->GetRenderTargetTexture();
+	if (Texture == nullptr || !FLiveLinkDragonPlateWriter::IsSupportedFormat(Texture->GetDesc().Format))
+	{
+		UE_LOG(LogLiveLinkDragonPlates, Warning, TEXT("Plate %s can't be read from a %s target, dropped"), *Request.FileName,
+			Texture ? GPixelFormats[Texture->GetDesc().Format].Name : TEXT("missing"));
+		NumReadbacks.fetch_sub(1, std::memory_order_relaxed);
+		return;
+	}
+
+	FPlateReadback& Plate = Readbacks.AddDefaulted_GetRef();
+	Plate.FileName = MoveTemp(Request.FileName);
+	Plate.Size = Texture->GetDesc().Extent;
+	Plate.Format = Texture->GetDesc().Format;
+	Plate.Readback = MakeUnique<FRHIGPUTextureReadback>(TEXT("LiveLinkDragonPlate"));
+	Plate.Readback->EnqueueCopy(RHICmdList, Texture);
+}
+
+void FLiveLinkDragonPlateExporter::PollReadbacks()
+{
+	for (int32 Index = 0; Index < Readbacks.Num(); )
+	{
+		FPlateReadback& Plate = Readbacks[Index];
+		if (!Plate.Readback->IsReady())
+		{
+			++Index;
+			continue;
+		}
+
+		if (TArray<uint8>* Pixels = Writer->AcquireBuffer())
+		{
+			// Staging rows may be padded, the writer wants them packed
+			int32 RowPitchInPixels = 0;
+			const uint8* Data = static_cast<const uint8*>(Plate.Readback->Lock(RowPitchInPixels));
+			const int32 BytesPerPixel = GPixelFormats[Plate.Format].BlockBytes;
+			const int32 RowBytes = Plate.Size.X * BytesPerPixel;
+
+			Pixels->SetNumUninitialized(RowBytes * Plate.Size.Y);
+			for (int32 Row = 0; Row < Plate.Size.Y; ++Row)
+			{
+				FMemory::Memcpy(Pixels->GetData() + Row * RowBytes, Data + static_cast<int64>(Row) * RowPitchInPixels * BytesPerPixel, RowBytes);
+			}
+			Plate.Readback->Unlock();
+
+			Writer->Enqueue(MoveTemp(Plate.FileName), Plate.Size, Plate.Format, Pixels);
+		}
+		else
+		{
+			UE_LOG(LogLiveLinkDragonPlates, Warning, TEXT("Plates are backing up, dropped %s"), *Plate.FileName);
+		}
+
+		Readbacks.RemoveAt(Index);
+		NumReadbacks.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,126 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LockFreeList.h"
+#include "PixelFormat.h"
+#include "UObject/StrongObjectPtr.h"
+
+#include <atomic>
+
+struct FLiveLinkDragonCaptureEvent;
+class FRenderTarget;
+class FRHICommandListImmediate;
+class FRHIGPUTextureReadback;
+class IImageWrapperModule;
+class UTextureRenderTarget2D;
+
+/**
+ * Encodes and writes plates on background workers.
+ *
+ * Pixels arrive in pooled buffers, as the render target's own format, and are converted, PNG encoded and written
+ * by at most MaxWorkers tasks at a time, so a slow disk backs plates up here rather than on the game or render
+ * thread. Once MaxBuffers plates are in flight new ones are dropped, with a warning, instead of growing without bound.
+ */
+class FLiveLinkDragonPlateWriter : public TSharedFromThis<FLiveLinkDragonPlateWriter, ESPMode::ThreadSafe>
+{
+public:
+
+	static constexpr int32 MaxWorkers = 2;
+	static constexpr int32 MaxBuffers = 8;
+
+	FLiveLinkDragonPlateWriter();
+	~FLiveLinkDragonPlateWriter();
+
+	/** Formats Enqueue can turn into a plate */
+	static bool IsSupportedFormat(EPixelFormat Format);
+
+	/** Any thread. Null when every buffer is taken. */
+	TArray<uint8>* AcquireBuffer();
+
+	/** Any thread. Pixels are tightly packed rows of Format. Takes the buffer back once the plate is written. */
+	void Enqueue(FString FileName, FIntPoint Size, EPixelFormat Format, TArray<uint8>* Pixels);
+
+private:
+
+	struct FJob
+	{
+		FString FileName;
+		FIntPoint Size = FIntPoint::ZeroValue;
+		EPixelFormat Format = PF_Unknown;
+		TArray<uint8>* Pixels = nullptr;
+	};
+
+	void RunWorker();
+	void Write(const FJob& Job) const;
+
+	IImageWrapperModule& ImageWrapperModule;
+
+	TLockFreePointerListUnordered<TArray<uint8>, PLATFORM_CACHE_LINE_SIZE> FreeBuffers;
+	std::atomic<int32> NumBuffers{ 0 };
+
+	// Plates are seconds apart, a lock around the queue costs nothing
+	FCriticalSection Lock;
+	TArray<FJob> Jobs;
+	int32 ActiveWorkers = 0;
+};
+
+/**
+ * Writes the CG plate matching each Dragonframe capture, for sources with plate export enabled.
+ *
+ * At the end of the frame a capture arrives in, the source's plate render target is copied into a GPU readback of
+ * its own that carries the plate's file name. A render target is required, the game viewport's back buffer has
+ * been presented and let go of by then. The render thread polls the readbacks once a frame and
+ * hands finished ones to the writer, so neither thread ever waits on the GPU.
+ */
+class FLiveLinkDragonPlateExporter
+{
+public:
+
+	FLiveLinkDragonPlateExporter();
+	~FLiveLinkDragonPlateExporter();
+
+private:
+
+	struct FPlateRequest
+	{
+		FString FileName;
+		TStrongObjectPtr<UTextureRenderTarget2D> RenderTarget;
+	};
+
+	struct FPlateCopy
+	{
+		FString FileName;
+		FRenderTarget* Target = nullptr;
+	};
+
+	struct FPlateReadback
+	{
+		FString FileName;
+		FIntPoint Size = FIntPoint::ZeroValue;
+		EPixelFormat Format = PF_Unknown;
+		TUniquePtr<FRHIGPUTextureReadback> Readback;
+	};
+
+	void OnCapture(const FLiveLinkDragonCaptureEvent& Event);
+	void OnEndFrame();
+
+	/** Render thread */
+	void StartReadback(FRHICommandListImmediate& RHICmdList, FPlateCopy&& Request);
+	void PollReadbacks();
+
+	TSharedRef<FLiveLinkDragonPlateWriter, ESPMode::ThreadSafe> Writer;
+
+	// Game thread, captures of this frame. Copied once the frame has been drawn, the targets are held until then.
+	TArray<FPlateRequest> Requests;
+
+	// Requested and not yet handed to the writer or dropped, so the game thread knows whether to poll
+	std::atomic<int32> NumReadbacks{ 0 };
+
+	// Render thread only, oldest first
+	TArray<FPlateReadback> Readbacks;
+
+	FDelegateHandle OnCaptureHandle;
+	FDelegateHandle OnEndFrameHandle;
+};
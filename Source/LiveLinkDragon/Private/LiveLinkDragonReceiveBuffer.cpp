@@ -0,0 +1,100 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonReceiveBuffer.h"
+
+#include "LiveLinkDragonMetrics.h"
+
+FDragonReceiveBuffer::FDragonReceiveBuffer(FDragonReceiveBuffer&& Other)
+	: Pool(Other.Pool)
+	, Data(Other.Data)
+	, Size(Other.Size)
+{
+	Other.Pool = nullptr;
+	Other.Data = nullptr;
+	Other.Size = 0;
+}
+
+FDragonReceiveBuffer& FDragonReceiveBuffer::operator=(FDragonReceiveBuffer&& Other)
+{
+	if (this != &Other)
+	{
+		Release();
+		Pool = Other.Pool;
+		Data = Other.Data;
+		Size = Other.Size;
+		Other.Pool = nullptr;
+		Other.Data = nullptr;
+		Other.Size = 0;
+	}
+	return *this;
+}
+
+FDragonReceiveBuffer::~FDragonReceiveBuffer()
+{
+	Release();
+}
+
+int32 FDragonReceiveBuffer::GetCapacity() const
+{
+	return Data ? FLiveLinkDragonReceiveBufferPool::BufferSize : 0;
+}
+
+void FDragonReceiveBuffer::SetSize(int32 InSize)
+{
+	check(InSize >= 0 && InSize <= GetCapacity());
+	Size = InSize;
+}
+
+void FDragonReceiveBuffer::Release()
+{
+	if (Data)
+	{
+		Pool->Release(Data);
+		Pool = nullptr;
+		Data = nullptr;
+		Size = 0;
+	}
+}
+
+FLiveLinkDragonReceiveBufferPool::FLiveLinkDragonReceiveBufferPool(FLiveLinkDragonMetrics& InMetrics)
+	: Metrics(InMetrics)
+{
+}
+
+FLiveLinkDragonReceiveBufferPool::~FLiveLinkDragonReceiveBufferPool()
+{
+	check(BuffersInUse.load() == 0);
+
+	while (uint8* Data = FreeBuffers.Pop())
+	{
+		FMemory::Free(Data);
+	}
+}
+
+FDragonReceiveBuffer FLiveLinkDragonReceiveBufferPool::Acquire()
+{
+	FDragonReceiveBuffer Buffer;
+	Buffer.Pool = this;
+	Buffer.Data = FreeBuffers.Pop();
+
+	if (Buffer.Data == nullptr)
+	{
+		Buffer.Data = static_cast<uint8*>(FMemory::Malloc(BufferSize));
+		Metrics.ReceiveBuffersAllocated.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Only this thread acquires, so nobody else can raise the mark between the load and the store
+	const int32 InUse = BuffersInUse.fetch_add(1, std::memory_order_relaxed) + 1;
+	if (InUse > Metrics.ReceiveBuffersInUseHighWater.load(std::memory_order_relaxed))
+	{
+		Metrics.ReceiveBuffersInUseHighWater.store(InUse, std::memory_order_relaxed);
+	}
+
+	return Buffer;
+}
+
+void FLiveLinkDragonReceiveBufferPool::Release(uint8* Data)
+{
+	FreeBuffers.Push(Data);
+	BuffersInUse.fetch_sub(1, std::memory_order_relaxed);
+}
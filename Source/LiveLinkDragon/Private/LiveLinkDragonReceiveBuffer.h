@@ -0,0 +1,75 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LockFreeList.h"
+
+#include <atomic>
+
+struct FLiveLinkDragonMetrics;
+class FLiveLinkDragonReceiveBufferPool;
+
+/**
+ * A receive buffer on loan from the pool, handed back when it goes out of scope.
+ * Holds one datagram, which is only ever read through its length, never as a terminated string.
+ */
+class FDragonReceiveBuffer
+{
+public:
+
+	FDragonReceiveBuffer() = default;
+	FDragonReceiveBuffer(FDragonReceiveBuffer&& Other);
+	FDragonReceiveBuffer& operator=(FDragonReceiveBuffer&& Other);
+	~FDragonReceiveBuffer();
+
+	FDragonReceiveBuffer(const FDragonReceiveBuffer&) = delete;
+	FDragonReceiveBuffer& operator=(const FDragonReceiveBuffer&) = delete;
+
+	bool IsValid() const { return Data != nullptr; }
+
+	uint8* GetData() const { return Data; }
+	int32 GetCapacity() const;
+
+	/** The datagram received into the buffer */
+	TArrayView<const uint8> GetView() const { return TArrayView<const uint8>(Data, Size); }
+	void SetSize(int32 InSize);
+
+	void Release();
+
+private:
+
+	friend class FLiveLinkDragonReceiveBufferPool;
+
+	FLiveLinkDragonReceiveBufferPool* Pool = nullptr;
+	uint8* Data = nullptr;
+	int32 Size = 0;
+};
+
+/**
+ * Buffers big enough for any UDP datagram, reused across packets so large ones cost no allocation.
+ * Acquire from one thread only, buffers may be released from any. Every buffer must be back before the pool goes.
+ */
+class FLiveLinkDragonReceiveBufferPool
+{
+public:
+
+	// Above the largest UDP payload, so a datagram can never be truncated
+	static constexpr int32 BufferSize = 64 * 1024;
+
+	explicit FLiveLinkDragonReceiveBufferPool(FLiveLinkDragonMetrics& InMetrics);
+	~FLiveLinkDragonReceiveBufferPool();
+
+	FDragonReceiveBuffer Acquire();
+
+private:
+
+	friend class FDragonReceiveBuffer;
+
+	void Release(uint8* Data);
+
+	TLockFreePointerListUnordered<uint8, PLATFORM_CACHE_LINE_SIZE> FreeBuffers;
+	std::atomic<int32> BuffersInUse{ 0 };
+
+	FLiveLinkDragonMetrics& Metrics;
+};
@@ -0,0 +1,138 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonSenderFilter.h"
+
+#include "Interfaces/IPv4/IPv4Address.h"
+#include "IPAddress.h"
+#include "SocketSubsystem.h"
+#include "SocketTypes.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLiveLinkDragonSenderFilter, Log, All);
+
+void FLiveLinkDragonSenderFilter::Initialize(const TArray<FString>& AllowedSenders)
+{
+	Ipv4Rules.Reset();
+	Ipv6Rules.Reset();
+	LastIpv6Sender.Reset();
+
+	for (const FString& Entry : AllowedSenders)
+	{
+		FString Address = Entry.TrimStartAndEnd();
+		if (Address.IsEmpty())
+		{
+			continue;
+		}
+
+		int32 PrefixLength = -1;
+		FString Prefix;
+		if (Address.Split(TEXT("/"), &Address, &Prefix))
+		{
+			PrefixLength = Prefix.IsNumeric() ? FCString::Atoi(*Prefix) : -2;
+		}
+
+		FIPv4Address Ipv4Address;
+		uint64 Ipv6Words[2];
+		if (FIPv4Address::Parse(Address, Ipv4Address) && PrefixLength >= -1 && PrefixLength <= 32)
+		{
+			const int32 Bits = PrefixLength < 0 ? 32 : PrefixLength;
+			FIpv4Rule& Rule = Ipv4Rules.AddDefaulted_GetRef();
+			Rule.Mask = Bits == 0 ? 0 : ~uint32(0) << (32 - Bits);
+			Rule.Network = Ipv4Address.Value & Rule.Mask;
+		}
+		else if (ParseIpv6(Address, Ipv6Words) && PrefixLength >= -1 && PrefixLength <= 128)
+		{
+			const int32 Bits = PrefixLength < 0 ? 128 : PrefixLength;
+			FIpv6Rule& Rule = Ipv6Rules.AddDefaulted_GetRef();
+			for (int32 Word = 0; Word < 2; ++Word)
+			{
+				const int32 WordBits = FMath::Clamp(Bits - Word * 64, 0, 64);
+				Rule.Mask[Word] = WordBits == 0 ? 0 : ~uint64(0) << (64 - WordBits);
+				Rule.Network[Word] = Ipv6Words[Word] & Rule.Mask[Word];
+			}
+		}
+		else
+		{
+			UE_LOG(LogLiveLinkDragonSenderFilter, Warning, TEXT("Ignoring allowed sender '%s', expected an IPv4 or IPv6 address with an optional /prefix"), *Entry);
+		}
+	}
+}
+
+bool FLiveLinkDragonSenderFilter::IsAllowed(const FInternetAddr& Sender)
+{
+	if (!IsEnabled())
+	{
+		return true;
+	}
+
+	auto MatchesIpv4 = [this](uint32 Address)
+	{
+		for (const FIpv4Rule& Rule : Ipv4Rules)
+		{
+			if ((Address & Rule.Mask) == Rule.Network)
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
+	if (Sender.GetProtocolType() == FNetworkProtocolTypes::IPv4)
+	{
+		uint32 Address = 0;
+		Sender.GetIp(Address);
+		return MatchesIpv4(Address);
+	}
+
+	// Pulling the raw address out allocates, so it is only done when the IPv6 sender changes
+	if (!LastIpv6Sender.IsValid() || !(*LastIpv6Sender == Sender))
+	{
+		LastIpv6Sender = Sender.Clone();
+		bLastIpv6SenderAllowed = false;
+
+		uint64 Words[2];
+		if (GetIpv6Words(Sender, Words))
+		{
+			// Dual-stack sockets report IPv4 senders as ::ffff:a.b.c.d
+			bLastIpv6SenderAllowed = Words[0] == 0 && (Words[1] >> 32) == 0xFFFF && MatchesIpv4(static_cast<uint32>(Words[1]));
+
+			for (const FIpv6Rule& Rule : Ipv6Rules)
+			{
+				bLastIpv6SenderAllowed |= (Words[0] & Rule.Mask[0]) == Rule.Network[0] && (Words[1] & Rule.Mask[1]) == Rule.Network[1];
+			}
+		}
+	}
+	return bLastIpv6SenderAllowed;
+}
+
+bool FLiveLinkDragonSenderFilter::ParseIpv6(const FString& Address, uint64 (&OutWords)[2])
+{
+	if (!Address.Contains(TEXT(":")))
+	{
+		return false;
+	}
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedPtr<FInternetAddr> Parsed = SocketSubsystem ? SocketSubsystem->GetAddressFromString(Address) : nullptr;
+	if (!Parsed.IsValid())
+	{
+		return false;
+	}
+
+	return GetIpv6Words(*Parsed, OutWords);
+}
+
+bool FLiveLinkDragonSenderFilter::GetIpv6Words(const FInternetAddr& Address, uint64 (&OutWords)[2])
+{
+	const TArray<uint8> RawAddress = Address.GetRawIp();
+	if (RawAddress.Num() != 16)
+	{
+		return false;
+	}
+
+	OutWords[0] = OutWords[1] = 0;
+	for (int32 Byte = 0; Byte < 16; ++Byte)
+	{
+		OutWords[Byte / 8] = (OutWords[Byte / 8] << 8) | RawAddress[Byte];
+	}
+	return true;
+}
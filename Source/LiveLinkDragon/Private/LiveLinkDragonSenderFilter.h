@@ -0,0 +1,50 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FInternetAddr;
+
+/**
+ * Allow-list of the hosts and subnets the message thread accepts datagrams from.
+ *
+ * Entries are parsed once up front into network/mask pairs, so checking a sender is a few
+ * integer compares on the raw address, done before anything looks at the payload. IPv6 verdicts
+ * are kept for the last sender, as getting at its raw address allocates.
+ */
+class FLiveLinkDragonSenderFilter
+{
+public:
+
+	/** Entries are addresses or CIDR subnets, e.g. "192.168.1.20", "10.0.0.0/24", "fd00::/8". An empty list allows everyone. */
+	void Initialize(const TArray<FString>& AllowedSenders);
+
+	bool IsEnabled() const { return Ipv4Rules.Num() > 0 || Ipv6Rules.Num() > 0; }
+
+	/** Message thread only, it caches the last IPv6 sender */
+	bool IsAllowed(const FInternetAddr& Sender);
+
+private:
+
+	struct FIpv4Rule
+	{
+		uint32 Network = 0;
+		uint32 Mask = 0;
+	};
+
+	struct FIpv6Rule
+	{
+		uint64 Network[2] = { 0, 0 };
+		uint64 Mask[2] = { 0, 0 };
+	};
+
+	static bool ParseIpv6(const FString& Address, uint64 (&OutWords)[2]);
+	static bool GetIpv6Words(const FInternetAddr& Address, uint64 (&OutWords)[2]);
+
+	TArray<FIpv4Rule> Ipv4Rules;
+	TArray<FIpv6Rule> Ipv6Rules;
+
+	TSharedPtr<FInternetAddr> LastIpv6Sender;
+	bool bLastIpv6SenderAllowed = false;
+};
@@ -0,0 +1,193 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonSequenceTracker.h"
+
+#include "LiveLinkDragonMetrics.h"
+#include "LiveLinkDragonStats.h"
+
+#include "Misc/Crc.h"
+
+FLiveLinkDragonSequenceTracker::FLiveLinkDragonSequenceTracker(FLiveLinkDragonMetrics& InMetrics)
+	: Metrics(InMetrics)
+{
+}
+
+void FLiveLinkDragonSequenceTracker::Reset()
+{
+	bHasSequence = false;
+	NextSequence = 0;
+	ReceivedWindow = 0;
+
+	for (FRecentPayload& Payload : RecentPayloads)
+	{
+		Payload = FRecentPayload();
+	}
+	NextRecentPayload = 0;
+
+	CaptureTake.Reset();
+	CaptureFrame = -1;
+	CaptureExposure = -1;
+	CompletedFrame = -1;
+}
+
+EDragonPacketOrder FLiveLinkDragonSequenceTracker::OnSequence(uint32 Sequence)
+{
+	// Unsigned wrap-around makes both of these work across the 32 bit boundary
+	const uint32 Ahead = Sequence - NextSequence;
+	const uint32 Behind = NextSequence - 1 - Sequence;
+
+	if (!bHasSequence || (Ahead >= RestartThreshold && Behind >= RestartThreshold))
+	{
+		// First packet, or so far off either way that the sender must have restarted
+		bHasSequence = true;
+		NextSequence = Sequence + 1;
+		ReceivedWindow = 1;
+		return EDragonPacketOrder::InOrder;
+	}
+
+	if (Ahead < RestartThreshold)
+	{
+		if (Ahead > 0)
+		{
+			Metrics.PacketsLost.fetch_add(Ahead, std::memory_order_relaxed);
+			INC_DWORD_STAT_BY(STAT_DragonPacketsLost, Ahead);
+		}
+
+		ReceivedWindow = Ahead + 1 < 64 ? (ReceivedWindow << (Ahead + 1)) | 1 : 1;
+		NextSequence = Sequence + 1;
+		return EDragonPacketOrder::InOrder;
+	}
+
+	const uint64 Bit = Behind < 64 ? uint64(1) << Behind : 0;
+	if (Bit != 0 && (ReceivedWindow & Bit) != 0)
+	{
+		Metrics.PacketsDuplicated.fetch_add(1, std::memory_order_relaxed);
+		INC_DWORD_STAT(STAT_DragonPacketsDuplicated);
+		return EDragonPacketOrder::Duplicate;
+	}
+
+	// It was counted lost when the gap opened, it is only late
+	if (Bit != 0)
+	{
+		ReceivedWindow |= Bit;
+		Metrics.PacketsLost.fetch_sub(1, std::memory_order_relaxed);
+		DEC_DWORD_STAT(STAT_DragonPacketsLost);
+	}
+
+	Metrics.PacketsReordered.fetch_add(1, std::memory_order_relaxed);
+	INC_DWORD_STAT(STAT_DragonPacketsReordered);
+	return EDragonPacketOrder::Late;
+}
+
+EDragonPacketOrder FLiveLinkDragonSequenceTracker::OnPayload(const uint8* Data, int32 DataSize, double ArrivalTime)
+{
+	const uint32 Hash = FCrc::MemCrc32(Data, DataSize);
+
+	for (const FRecentPayload& Payload : RecentPayloads)
+	{
+		if (Payload.Hash == Hash && Payload.Size == DataSize && ArrivalTime - Payload.ArrivalTime < DuplicateWindow)
+		{
+			Metrics.PacketsDuplicated.fetch_add(1, std::memory_order_relaxed);
+			INC_DWORD_STAT(STAT_DragonPacketsDuplicated);
+			return EDragonPacketOrder::Duplicate;
+		}
+	}
+
+	FRecentPayload& Recent = RecentPayloads[NextRecentPayload];
+	Recent.Hash = Hash;
+	Recent.Size = DataSize;
+	Recent.ArrivalTime = ArrivalTime;
+	NextRecentPayload = (NextRecentPayload + 1) % NumRecentPayloads;
+
+	return EDragonPacketOrder::InOrder;
+}
+
+bool FLiveLinkDragonSequenceTracker::OnCapture(const FString& Take, int32 Frame, int32 Exposure, bool bFrameComplete, bool bLateDatagram)
+{
+	if (bHasSequence)
+	{
+		// The sequence number already said whether this is late, and lost datagrams were counted when the gap opened
+		if (bLateDatagram)
+		{
+			return false;
+		}
+
+		CaptureTake = Take;
+		CaptureFrame = Frame;
+		CaptureExposure = Exposure;
+		if (bFrameComplete)
+		{
+			CompletedFrame = Frame;
+		}
+		return true;
+	}
+
+	if (Take != CaptureTake)
+	{
+		CaptureTake = Take;
+		CaptureFrame = Frame;
+		CaptureExposure = Exposure;
+		CompletedFrame = bFrameComplete ? Frame : -1;
+		return true;
+	}
+
+	// Capture walks forward through (frame, exposure), anything behind what we have is late
+	if (Frame < CaptureFrame || (Frame == CaptureFrame && Exposure < CaptureExposure) || (bFrameComplete && Frame <= CompletedFrame))
+	{
+		Metrics.PacketsReordered.fetch_add(1, std::memory_order_relaxed);
+		INC_DWORD_STAT(STAT_DragonPacketsReordered);
+		return false;
+	}
+
+	// Frames are completed one at a time, a jump means the frameComplete for the ones in between never came
+	if (bFrameComplete)
+	{
+		if (CompletedFrame >= 0 && Frame > CompletedFrame + 1)
+		{
+			const int32 Missing = Frame - CompletedFrame - 1;
+			Metrics.PacketsLost.fetch_add(Missing, std::memory_order_relaxed);
+			INC_DWORD_STAT_BY(STAT_DragonPacketsLost, Missing);
+		}
+		CompletedFrame = Frame;
+	}
+
+	CaptureFrame = Frame;
+	CaptureExposure = Exposure;
+	return true;
+}
+
+void FLiveLinkDragonSequenceTracker::OnShoot(const FString& Take, int32 Frame)
+{
+	if (Take != CaptureTake || CaptureFrame < 0)
+	{
+		return;
+	}
+
+	// Going forward is what captures do anyway, only a step back needs the position moved
+	if (Frame < CaptureFrame || Frame <= CompletedFrame)
+	{
+		CaptureFrame = Frame;
+		CaptureExposure = -1;
+		CompletedFrame = Frame - 1;
+	}
+}
+
+void FLiveLinkDragonSequenceTracker::OnDelete(const FString& Take)
+{
+	if (Take != CaptureTake || CaptureFrame < 0)
+	{
+		return;
+	}
+
+	// Delete drops the last frame of the take and the next capture re-shoots it
+	const int32 DeletedFrame = CompletedFrame >= 0 ? CompletedFrame : CaptureFrame;
+	CompletedFrame = FMath::Min(CompletedFrame, DeletedFrame - 1);
+	CaptureFrame = DeletedFrame - 1;
+	CaptureExposure = TNumericLimits<int32>::Max();
+}
+
+void FLiveLinkDragonSequenceTracker::OnStaleUpdateDropped()
+{
+	Metrics.StaleUpdatesDropped.fetch_add(1, std::memory_order_relaxed);
+	INC_DWORD_STAT(STAT_DragonStaleUpdatesDropped);
+}
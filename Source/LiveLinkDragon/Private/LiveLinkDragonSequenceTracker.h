@@ -0,0 +1,90 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FLiveLinkDragonMetrics;
+
+enum class EDragonPacketOrder : uint8
+{
+	InOrder,
+	Late,		// older than something we already have, must not overwrite newer state
+	Duplicate,	// already seen, drop it entirely
+};
+
+/**
+ * Works out whether datagrams from Dragonframe are arriving lost, late or twice, and counts it.
+ *
+ * Binary-framed datagrams carry a sequence number, which makes this exact. Plain Dragonframe JSON
+ * does not, so duplicates are spotted by content and order is inferred from how frame and exposure
+ * progress through capture events. Stepping back to re-shoot and deleting frames move that progress
+ * backwards, so shoots and deletes reset it.
+ *
+ * Only used from the message thread, the counters it writes are lock-free atomics in the metrics.
+ */
+class FLiveLinkDragonSequenceTracker
+{
+public:
+
+	explicit FLiveLinkDragonSequenceTracker(FLiveLinkDragonMetrics& InMetrics);
+
+	/** For datagrams with an explicit sequence number */
+	EDragonPacketOrder OnSequence(uint32 Sequence);
+
+	/** For plain JSON datagrams, catches the copies WithBroadcast() and multi-homed hosts like to deliver */
+	EDragonPacketOrder OnPayload(const uint8* Data, int32 DataSize, double ArrivalTime);
+
+	/**
+	 * Returns false if this capture event is stale. With sequence numbers only a late datagram is, and it was
+	 * counted as reordered already. Without them, captures should walk forward through frame/exposure within a take.
+	 */
+	bool OnCapture(const FString& Take, int32 Frame, int32 Exposure, bool bFrameComplete, bool bLateDatagram);
+
+	/** Shooting a frame at or behind the capture position means the animator stepped back to re-shoot from there */
+	void OnShoot(const FString& Take, int32 Frame);
+
+	/** Deleting frames legitimately moves the capture position backwards */
+	void OnDelete(const FString& Take);
+
+	/** Counts a state update that was dropped because it was late */
+	void OnStaleUpdateDropped();
+
+	void Reset();
+
+private:
+
+	FLiveLinkDragonMetrics& Metrics;
+
+	//~ Begin explicit sequence
+	bool bHasSequence = false;
+	uint32 NextSequence = 0;
+	// Bit N set means NextSequence - 1 - N has been received
+	uint64 ReceivedWindow = 0;
+	//~ End explicit sequence
+
+	//~ Begin content duplicates
+	struct FRecentPayload
+	{
+		uint32 Hash = 0;
+		int32 Size = 0;
+		double ArrivalTime = 0.0;
+	};
+	static constexpr int32 NumRecentPayloads = 16;
+	FRecentPayload RecentPayloads[NumRecentPayloads];
+	int32 NextRecentPayload = 0;
+	//~ End content duplicates
+
+	//~ Begin inferred capture order
+	FString CaptureTake;
+	int32 CaptureFrame = -1;
+	int32 CaptureExposure = -1;
+	int32 CompletedFrame = -1;
+	//~ End inferred capture order
+
+	// Anything older than this in sequence numbers is taken as the sender having restarted
+	static constexpr uint32 RestartThreshold = 1024;
+
+	// Identical datagrams further apart than this are assumed to be real repeats, e.g. keep-alives
+	static constexpr double DuplicateWindow = 0.05;
+};
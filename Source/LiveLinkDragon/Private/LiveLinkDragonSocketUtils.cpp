@@ -0,0 +1,152 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonSocketUtils.h"
+
+#include "IPAddress.h"
+#include "Sockets.h"
+
+// The descriptor is only reachable through the engine's BSD socket class, which Linux's platform subsystem always uses
+#define LIVELINKDRAGON_NATIVE_SOCKETS (PLATFORM_LINUX && LIVELINKDRAGON_KERNEL_TIMESTAMPS)
+
+#if LIVELINKDRAGON_NATIVE_SOCKETS
+#include "BSDSockets/SocketsBSD.h"
+
+THIRD_PARTY_INCLUDES_START
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+THIRD_PARTY_INCLUDES_END
+
+namespace LiveLinkDragonSocketUtils
+{
+	/** The socket's descriptor, if it really is a datagram socket bound to the port FSocket says it is */
+	bool GetNativeSocket(FSocket* Socket, SOCKET& OutNativeSocket)
+	{
+		if (Socket == nullptr || Socket->GetSocketType() != SOCKTYPE_Datagram)
+		{
+			return false;
+		}
+
+		const SOCKET NativeSocket = static_cast<FSocketBSD*>(Socket)->GetNativeSocket();
+
+		int Type = 0;
+		socklen_t TypeSize = sizeof(Type);
+		sockaddr_storage LocalAddress;
+		socklen_t LocalAddressSize = sizeof(LocalAddress);
+		if (getsockopt(NativeSocket, SOL_SOCKET, SO_TYPE, &Type, &TypeSize) != 0 || Type != SOCK_DGRAM
+			|| getsockname(NativeSocket, reinterpret_cast<sockaddr*>(&LocalAddress), &LocalAddressSize) != 0)
+		{
+			return false;
+		}
+
+		const uint16 LocalPort = LocalAddress.ss_family == AF_INET6
+			? ntohs(reinterpret_cast<const sockaddr_in6&>(LocalAddress).sin6_port)
+			: ntohs(reinterpret_cast<const sockaddr_in&>(LocalAddress).sin_port);
+		if (LocalPort != Socket->GetPortNo())
+		{
+			return false;
+		}
+
+		OutNativeSocket = NativeSocket;
+		return true;
+	}
+}
+#endif
+
+bool FLiveLinkDragonSocketUtils::EnableReceiveTimestamps(FSocket* Socket)
+{
+#if LIVELINKDRAGON_NATIVE_SOCKETS
+	SOCKET NativeSocket;
+	if (!LiveLinkDragonSocketUtils::GetNativeSocket(Socket, NativeSocket))
+	{
+		return false;
+	}
+
+	const int Enable = 1;
+	return setsockopt(NativeSocket, SOL_SOCKET, SO_TIMESTAMPNS, &Enable, sizeof(Enable)) == 0;
+#else
+	return false;
+#endif
+}
+
+bool FLiveLinkDragonSocketUtils::RecvFromWithTimestamp(FSocket* Socket, bool bKernelTimestamps, uint8* Data, int32 BufferSize, int32& BytesRead, FInternetAddr& Source, double& OutArrivalTime, bool& bOutTruncated)
+{
+	bOutTruncated = false;
+
+#if LIVELINKDRAGON_NATIVE_SOCKETS
+	if (!bKernelTimestamps)
+	{
+		const bool bReceived = Socket->RecvFrom(Data, BufferSize, BytesRead, Source);
+		OutArrivalTime = FPlatformTime::Seconds();
+		return bReceived;
+	}
+
+	// Checked when timestamps were turned on
+	const SOCKET NativeSocket = static_cast<FSocketBSD*>(Socket)->GetNativeSocket();
+
+	sockaddr_storage SourceAddress;
+	iovec IoVector;
+	IoVector.iov_base = Data;
+	IoVector.iov_len = BufferSize;
+
+	alignas(cmsghdr) uint8 Control[CMSG_SPACE(sizeof(timespec))];
+
+	msghdr Message;
+	FMemory::Memzero(Message);
+	Message.msg_name = &SourceAddress;
+	Message.msg_namelen = sizeof(SourceAddress);
+	Message.msg_iov = &IoVector;
+	Message.msg_iovlen = 1;
+	Message.msg_control = Control;
+	Message.msg_controllen = sizeof(Control);
+
+	const ssize_t Result = recvmsg(NativeSocket, &Message, 0);
+	BytesRead = 0;
+	if (Result < 0)
+	{
+		return false;
+	}
+
+	// Sample both clocks back to back so the kernel's wall-clock stamp can be moved into FPlatformTime
+	const double PlatformNow = FPlatformTime::Seconds();
+	OutArrivalTime = PlatformNow;
+
+	for (cmsghdr* ControlMessage = CMSG_FIRSTHDR(&Message); ControlMessage != nullptr; ControlMessage = CMSG_NXTHDR(&Message, ControlMessage))
+	{
+		if (ControlMessage->cmsg_level == SOL_SOCKET && ControlMessage->cmsg_type == SCM_TIMESTAMPNS)
+		{
+			timespec KernelTime;
+			FMemory::Memcpy(&KernelTime, CMSG_DATA(ControlMessage), sizeof(KernelTime));
+
+			timespec RealNow;
+			clock_gettime(CLOCK_REALTIME, &RealNow);
+
+			const double Age = (RealNow.tv_sec - KernelTime.tv_sec) + (RealNow.tv_nsec - KernelTime.tv_nsec) * 1.0e-9;
+			OutArrivalTime = PlatformNow - FMath::Max(0.0, Age);
+			break;
+		}
+	}
+
+	if (SourceAddress.ss_family == AF_INET)
+	{
+		const sockaddr_in& Address4 = reinterpret_cast<const sockaddr_in&>(SourceAddress);
+		Source.SetIp(ntohl(Address4.sin_addr.s_addr));
+		Source.SetPort(ntohs(Address4.sin_port));
+	}
+	else if (SourceAddress.ss_family == AF_INET6)
+	{
+		const sockaddr_in6& Address6 = reinterpret_cast<const sockaddr_in6&>(SourceAddress);
+		Source.SetRawIp(TArray<uint8>(Address6.sin6_addr.s6_addr, sizeof(Address6.sin6_addr.s6_addr)));
+		Source.SetPort(ntohs(Address6.sin6_port));
+	}
+
+	BytesRead = static_cast<int32>(Result);
+	bOutTruncated = (Message.msg_flags & MSG_TRUNC) != 0;
+	return true;
+#else
+	const bool bReceived = Socket->RecvFrom(Data, BufferSize, BytesRead, Source);
+	OutArrivalTime = FPlatformTime::Seconds();
+	return bReceived;
+#endif
+}
@@ -0,0 +1,29 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FSocket;
+class FInternetAddr;
+
+/**
+ * Thin wrappers over the parts of the platform socket API that FSocket does not expose.
+ * Only Linux's BSD sockets get the native path, and only for a socket EnableReceiveTimestamps accepted.
+ * Everywhere else, and for any socket it turned down, these fall back to the plain FSocket calls.
+ */
+struct FLiveLinkDragonSocketUtils
+{
+	/**
+	 * Asks the kernel to stamp every datagram with its arrival time (SO_TIMESTAMPNS). Returns false if that is not
+	 * available, or if the socket's native descriptor doesn't check out as the bound datagram socket.
+	 */
+	static bool EnableReceiveTimestamps(FSocket* Socket);
+
+	/**
+	 * RecvFrom that also returns when the datagram arrived, in FPlatformTime::Seconds() time.
+	 * bKernelTimestamps is what EnableReceiveTimestamps returned for this socket, the native path is only taken then.
+	 * bOutTruncated is set when the datagram was larger than the buffer, its cut-off payload must not be parsed.
+	 */
+	static bool RecvFromWithTimestamp(FSocket* Socket, bool bKernelTimestamps, uint8* Data, int32 BufferSize, int32& BytesRead, FInternetAddr& Source, double& OutArrivalTime, bool& bOutTruncated);
+};
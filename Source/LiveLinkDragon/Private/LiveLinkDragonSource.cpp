@@ -5,17 +5,22 @@
 
 #include "ILiveLinkClient.h"
 
+#include "LiveLinkDragonEventQueue.h"
+
 #include "Interfaces/IPv4/IPv4Address.h"
 #include "Interfaces/IPv4/IPv4Endpoint.h"
 
 #include "Roles/LiveLinkAnimationRole.h"
 #include "Roles/LiveLinkAnimationTypes.h"
+#include "Roles/LiveLinkBasicRole.h"
+#include "Roles/LiveLinkBasicTypes.h"
 #include "Roles/LiveLinkCameraRole.h"
 #include "Roles/LiveLinkCameraTypes.h"
+#include "Roles/LiveLinkLensRole.h"
+#include "Roles/LiveLinkLensTypes.h"
 
 #include "Sockets.h"
 #include "SocketSubsystem.h"
-#include "Common/UdpSocketBuilder.h" // for the fluent socket builder
 
 #include <cmath>
 #include <chrono>
@@ -28,14 +33,48 @@ DEFINE_LOG_CATEGORY_STATIC(LogLiveLinkDragonPlugin, Log, All);
 // #define RECV_BUFFER_SIZE 1024 * 1024
 using namespace std::chrono;
 
+namespace LiveLinkDragonSource
+{
+	// Property order of the state subject, its frames fill PropertyValues in this order
+	enum class EStateProperty : int32
+	{
+		Frame,
+		Exposure,
+		MocoFrame,
+		ReadyToCapture,
+		StereoIndex,
+		Num
+	};
+
+	static void SetCameraSupport(FLiveLinkCameraStaticData& StaticData)
+	{
+		StaticData.bIsFocalLengthSupported = true;
+		StaticData.bIsApertureSupported = true;
+		StaticData.bIsFocusDistanceSupported = true;
+
+		StaticData.bIsFieldOfViewSupported = false;
+		StaticData.bIsAspectRatioSupported = false;
+		StaticData.bIsProjectionModeSupported = false;
+	}
+
+	/** Copies the scene strings into a subject's frame only if that subject hasn't had this map yet, other frames go without */
+	static void TakeSceneMetadata(const FLensPacket& Packet, TSharedPtr<const TMap<FName, FString>, ESPMode::ThreadSafe>& Published, FLiveLinkMetaData& MetaData)
+	{
+		if (Packet.SceneMetadata.IsValid() && Packet.SceneMetadata != Published)
+		{
+			MetaData.StringMetaData = *Packet.SceneMetadata;
+			Published = Packet.SceneMetadata;
+		}
+	}
+}
+
 FLiveLinkDragonSource::FLiveLinkDragonSource(FLiveLinkDragonConnectionSettings InConnectionSettings)
-	: SocketSubsystem(ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM))
-	, ConnectionSettings(MoveTemp(InConnectionSettings))
-	, LastTimeDataReceived(0.0)
-	, bReceivedData(false)
+	: ConnectionSettings(MoveTemp(InConnectionSettings))
+	, Metrics(MakeShared<FLiveLinkDragonMetrics, ESPMode::ThreadSafe>())
+	, bIsShuttingDown(false)
 {
 	SourceMachineName = FText::Format(LOCTEXT("MachineName", "{0}:{1}"), 
-        FText::FromString(ConnectionSettings.IPAddress), 
+        FText::FromString(ConnectionSettings.MulticastGroup.IsEmpty() ? ConnectionSettings.IPAddress : ConnectionSettings.MulticastGroup), 
         FText::AsNumber(DragonPortNumber, 
        	 &FNumberFormattingOptions::DefaultNoGrouping()));
 }
@@ -122,37 +161,104 @@ FLiveLinkDragonSource::~FLiveLinkDragonSource()
 void FLiveLinkDragonSource::ReceiveClient(ILiveLinkClient* InClient, FGuid InSourceGuid)
 {
 	Client = InClient;
+	SourceGuid = InSourceGuid;
 
 	SubjectKey = FLiveLinkSubjectKey(InSourceGuid, ConnectionSettings.SubjectName);
 
+	FLiveLinkDragonMetricsRegistry::Register(SourceGuid, ConnectionSettings.SubjectName, Metrics);
+
+	if (ConnectionSettings.bStereo)
+	{
+		EyeSubjectKeys[0] = FLiveLinkSubjectKey(InSourceGuid, *(ConnectionSettings.SubjectName.ToString() + TEXT("_Left")));
+		EyeSubjectKeys[1] = FLiveLinkSubjectKey(InSourceGuid, *(ConnectionSettings.SubjectName.ToString() + TEXT("_Right")));
+
+		// Each eye sits half the interaxial out from the rig pose and toes in towards the convergence point
+		const float HalfInteraxial = ConnectionSettings.InteraxialDistance * 0.5f;
+		const float ToeIn = ConnectionSettings.ConvergenceDistance > 0.0f ? FMath::RadiansToDegrees(FMath::Atan2(HalfInteraxial, ConnectionSettings.ConvergenceDistance)) : 0.0f;
+		EyeOffsets[0] = FTransform(FRotator(0.0f, ToeIn, 0.0f), FVector(0.0f, -HalfInteraxial, 0.0f));
+		EyeOffsets[1] = FTransform(FRotator(0.0f, -ToeIn, 0.0f), FVector(0.0f, HalfInteraxial, 0.0f));
+
+		PushStaticData(EyeSubjectKeys[0]);
+		PushStaticData(EyeSubjectKeys[1]);
+
+		if (ConnectionSettings.bLateLatchPose)
+		{
+			EyePoseSlots[0] = FLiveLinkDragonLateLatch::Register(EyeSubjectKeys[0]);
+			EyePoseSlots[1] = FLiveLinkDragonLateLatch::Register(EyeSubjectKeys[1]);
+		}
+	}
+	else
+	{
+		PushStaticData(SubjectKey);
+
+		if (ConnectionSettings.bLateLatchPose)
+		{
+			PoseSlot = FLiveLinkDragonLateLatch::Register(SubjectKey);
+		}
+	}
+
+	if (ConnectionSettings.bPublishStateAndLens)
+	{
+		StateSubjectKey = FLiveLinkSubjectKey(InSourceGuid, *(ConnectionSettings.SubjectName.ToString() + TEXT("_State")));
+		LensSubjectKey = FLiveLinkSubjectKey(InSourceGuid, *(ConnectionSettings.SubjectName.ToString() + TEXT("_Lens")));
+
+		PushStateStaticData();
+		PushLensStaticData();
+	}
+
+	OpenConnection();
+}
+
+void FLiveLinkDragonSource::PushStaticData(const FLiveLinkSubjectKey& InSubjectKey)
+{
 	FLiveLinkStaticDataStruct DragonStaticDataStruct(FLiveLinkCameraStaticData::StaticStruct());
 	FLiveLinkCameraStaticData* DragonStaticData = DragonStaticDataStruct.Cast<FLiveLinkCameraStaticData>();
+	LiveLinkDragonSource::SetCameraSupport(*DragonStaticData);
+
+	Client->PushSubjectStaticData_AnyThread(InSubjectKey, ULiveLinkCameraRole::StaticClass(), MoveTemp(DragonStaticDataStruct));
+}
 
-	DragonStaticData->bIsFocalLengthSupported = true;
-	DragonStaticData->bIsApertureSupported = true;
-	DragonStaticData->bIsFocusDistanceSupported = true;
+void FLiveLinkDragonSource::PushStateStaticData()
+{
+	using namespace LiveLinkDragonSource;
 
-	DragonStaticData->bIsFieldOfViewSupported = false;
-	DragonStaticData->bIsAspectRatioSupported = false;
-	DragonStaticData->bIsProjectionModeSupported = false;
+	FLiveLinkStaticDataStruct StateStaticDataStruct(FLiveLinkBaseStaticData::StaticStruct());
+	FLiveLinkBaseStaticData* StateStaticData = StateStaticDataStruct.Cast<FLiveLinkBaseStaticData>();
 
-	Client->PushSubjectStaticData_AnyThread(SubjectKey, ULiveLinkCameraRole::StaticClass(), MoveTemp(DragonStaticDataStruct));
+	TArray<FName>& PropertyNames = StateStaticData->PropertyNames;
+	PropertyNames.SetNum(static_cast<int32>(EStateProperty::Num));
+	PropertyNames[static_cast<int32>(EStateProperty::Frame)] = TEXT("Frame");
+	PropertyNames[static_cast<int32>(EStateProperty::Exposure)] = TEXT("Exposure");
+	PropertyNames[static_cast<int32>(EStateProperty::MocoFrame)] = TEXT("MocoFrame");
+	PropertyNames[static_cast<int32>(EStateProperty::ReadyToCapture)] = TEXT("ReadyToCapture");
+	PropertyNames[static_cast<int32>(EStateProperty::StereoIndex)] = TEXT("StereoIndex");
 
-	OpenConnection();
+	Client->PushSubjectStaticData_AnyThread(StateSubjectKey, ULiveLinkBasicRole::StaticClass(), MoveTemp(StateStaticDataStruct));
 }
 
-void FLiveLinkDragonSource::OnHandshakeEstablished_AnyThread()
+void FLiveLinkDragonSource::PushLensStaticData()
 {
-	bReceivedData = true;
+	FLiveLinkStaticDataStruct LensStaticDataStruct(FLiveLinkLensStaticData::StaticStruct());
+	FLiveLinkLensStaticData* LensStaticData = LensStaticDataStruct.Cast<FLiveLinkLensStaticData>();
+	LiveLinkDragonSource::SetCameraSupport(*LensStaticData);
+
+	Client->PushSubjectStaticData_AnyThread(LensSubjectKey, ULiveLinkLensRole::StaticClass(), MoveTemp(LensStaticDataStruct));
+}
+
+void FLiveLinkDragonSource::OnHandshakeEstablished_Task()
+{
+	UE_LOG(LogLiveLinkDragonPlugin, Log, TEXT("Handshake established with Dragonframe on port %d"), ConnectionSettings.Port);
 }
 
 bool FLiveLinkDragonSource::IsSourceStillValid() const
 {
-	if (Socket->GetConnectionState() != ESocketConnectionState::SCS_Connected)
+	// Only the snapshot published by the message thread, never the socket itself
+	const FLiveLinkDragonStatusSnapshot Status = Metrics->Status.Read();
+	if (bIsShuttingDown || Status.ConnectionState != ELiveLinkDragonConnectionState::Listening)
 	{
 		return false;
 	}
-	else if (bReceivedData == false)
+	else if (!Status.bHandshook)
 	{
 		return false;
 	}
@@ -186,16 +292,29 @@ bool FLiveLinkDragonSource::IsSourceStillValid() const
 
 bool FLiveLinkDragonSource::RequestSourceShutdown()
 {
+	bIsShuttingDown = true;
+
+	FLiveLinkDragonMetricsRegistry::Unregister(SourceGuid);
+
 	if (MessageThread)
 	{
 		MessageThread->Stop();
 		MessageThread.Reset();
 	}
 
-	if (Socket)
+	// After the thread, which is the only writer. The render thread may still hold the slots for a frame.
+	if (PoseSlot.IsValid())
 	{
-		SocketSubsystem->DestroySocket(Socket);
-		Socket = nullptr;
+		FLiveLinkDragonLateLatch::Unregister(SubjectKey);
+		PoseSlot.Reset();
+	}
+	for (int32 Eye = 0; Eye < 2; ++Eye)
+	{
+		if (EyePoseSlots[Eye].IsValid())
+		{
+			FLiveLinkDragonLateLatch::Unregister(EyeSubjectKeys[Eye]);
+			EyePoseSlots[Eye].Reset();
+		}
 	}
 
 	return true;
@@ -208,28 +327,50 @@ FText FLiveLinkDragonSource::GetSourceType() const
 
 FText FLiveLinkDragonSource::GetSourceStatus() const
 {
-	if (Socket->GetConnectionState() == ESocketConnectionState::SCS_ConnectionError)
+	const FLiveLinkDragonStatusSnapshot Status = Metrics->Status.Read();
+	if (bIsShuttingDown || Status.ConnectionState == ELiveLinkDragonConnectionState::Stopped)
 	{
-		return LOCTEXT("FailedConnectionStatus", "Failed to connect");
+		return LOCTEXT("StoppedStatus", "Stopped");
 	}
-	else if (bReceivedData == false)
+
+	switch (Status.SessionState)
 	{
+	case ELiveLinkDragonSessionState::Unbound:
+		return LOCTEXT("FailedConnectionStatus", "Failed to connect...retrying");
+	case ELiveLinkDragonSessionState::Rebinding:
+		return LOCTEXT("RebindingStatus", "Connection lost...reconnecting");
+	case ELiveLinkDragonSessionState::Listening:
 		return LOCTEXT("InvalidConnectionStatus", "Connected...waiting for handshake");
+	case ELiveLinkDragonSessionState::Stale:
+		return LOCTEXT("StaleStatus", "Connected...no data, Dragonframe may have stopped");
+	default:
+		break;
 	}
-	else if (FPlatformTime::Seconds() - LastTimeDataReceived > DataReceivedTimeout)
+
+	FText StatusText = LOCTEXT("ActiveStatus", "Active");
+
+	const uint64 Lost = Metrics->PacketsLost.load(std::memory_order_relaxed);
+	const uint64 Reordered = Metrics->PacketsReordered.load(std::memory_order_relaxed);
+	const uint64 Duplicated = Metrics->PacketsDuplicated.load(std::memory_order_relaxed);
+	if (Lost > 0 || Reordered > 0 || Duplicated > 0)
 	{
-		return LOCTEXT("WaitingForDataStatus", "Connected...waiting for data");
+		StatusText = FText::Format(LOCTEXT("ActiveHealthStatus", "{0} ({1} lost, {2} reordered, {3} duplicated)"),
+			StatusText, FText::AsNumber(Lost), FText::AsNumber(Reordered), FText::AsNumber(Duplicated));
 	}
-	return LOCTEXT("ActiveStatus", "Active");
+
+	if (ConnectionSettings.bBusyPoll)
+	{
+		StatusText = FText::Format(LOCTEXT("ActiveBusyPollStatus", "{0} (busy poll: {1} CPU, {2} of packets without a wakeup)"),
+			StatusText,
+			FText::AsPercent(Metrics->BusyPollCpuFraction.load(std::memory_order_relaxed)),
+			FText::AsPercent(Metrics->BusyPollHitFraction.load(std::memory_order_relaxed)));
+	}
+	return StatusText;
 }
 
 void FLiveLinkDragonSource::OpenConnection()
 {
-	check(!Socket);
-
-	SocketSubsystem = nullptr;
-	if (SocketSubsystem == nullptr)
-		SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	check(!MessageThread);
 
 	FIPv4Address IPAddr;
 	if (FIPv4Address::Parse(ConnectionSettings.IPAddress, IPAddr) == false)
@@ -238,49 +379,124 @@ void FLiveLinkDragonSource::OpenConnection()
 		return;
 	}
 
-	// need to parse this from the settings
-	uint16 PortNumber = ConnectionSettings.Port;
-	if (PortNumber == 0)
+	if (ConnectionSettings.Port <= 0)
 	{
-		UE_LOG(LogLiveLinkDragonPlugin, Warning, TEXT("Ill-formed Port Number, %d, defaulting to %d"), PortNumber, DragonPortNumber);
-		PortNumber = DragonPortNumber; // default port
+		UE_LOG(LogLiveLinkDragonPlugin, Warning, TEXT("Ill-formed Port Number, %d, defaulting to %d"), ConnectionSettings.Port, DragonPortNumber);
+		ConnectionSettings.Port = DragonPortNumber; // default port
 	}
 
-	// All good, let's a gooooo
-	DragonEndpoint = FIPv4Endpoint(FIPv4Address::Any, PortNumber);
+	// The message thread binds the socket itself, so it can rebind when the socket fails
+	MessageThread = MakeUnique<FLiveLinkDragonMessageThread>(ConnectionSettings, *Metrics);
 
-	// TSharedRef<FInternetAddr> Addr = DragonEndpoint.ToInternetAddr();
-
-	Socket = FUdpSocketBuilder(TEXT("Dragon Socket"))
-				 // .AsNonBlocking()
-				 .AsReusable()
-				 .BoundToEndpoint(DragonEndpoint)
-				 .WithReceiveBufferSize(DragonBufferSize)
-				 .WithSendBufferSize(DragonBufferSize)
-				 .WithBroadcast();
-
-	MessageThread = MakeUnique<FLiveLinkDragonMessageThread>(Socket);
-
-	MessageThread->OnHandshakeEstablished_AnyThread().BindRaw(this, &FLiveLinkDragonSource::OnHandshakeEstablished_AnyThread);
+	// Pushes and queueing for the game thread are cheap and stay on the socket thread, anything that may block goes to tasks
+	MessageThread->OnHandshakeEstablished_Task().BindRaw(this, &FLiveLinkDragonSource::OnHandshakeEstablished_Task);
 	MessageThread->OnFrameDataReady_AnyThread().BindRaw(this, &FLiveLinkDragonSource::OnFrameDataReady_AnyThread);
+	MessageThread->OnCaptureReady_AnyThread().BindRaw(this, &FLiveLinkDragonSource::OnCaptureReady_AnyThread);
+	MessageThread->OnCaptureReady_Task().BindRaw(this, &FLiveLinkDragonSource::OnCaptureReady_Task);
 
 	MessageThread->Start();
 }
 
 void FLiveLinkDragonSource::OnFrameDataReady_AnyThread(FLensPacket InData)
 {
+	using namespace LiveLinkDragonSource;
+
 	FLiveLinkFrameDataStruct LensFrameDataStruct(FLiveLinkCameraFrameData::StaticStruct());
 	FLiveLinkCameraFrameData* LensFrameData = LensFrameDataStruct.Cast<FLiveLinkCameraFrameData>();
 
-	LastTimeDataReceived = FPlatformTime::Seconds();
-	LensFrameData->WorldTime = LastTimeDataReceived.load();
+	// Use when the datagram hit the socket, so parse and handling stalls on our side don't show up as motion jitter.
+	// The message thread also takes the network delay and any clock offset to the sender off that.
+	const double ArrivalTime = InData.ArrivalTime > 0.0 ? InData.ArrivalTime : FPlatformTime::Seconds();
+	LensFrameData->WorldTime = InData.WorldTime > 0.0 ? InData.WorldTime : ArrivalTime;
 	LensFrameData->MetaData.SceneTime = InData.FrameTime;
 	LensFrameData->FocusDistance = InData.FocusDistance;
 	LensFrameData->FocalLength = InData.FocalLength;
 	LensFrameData->Aperture = InData.Aperture;
 	LensFrameData->FieldOfView = InData.HorizontalFOV;
 
-	Client->PushSubjectFrameData_AnyThread(SubjectKey, MoveTemp(LensFrameDataStruct));
+	// Every subject's frame is built from this one packet before any is pushed, so they all land together
+	// with the same world and scene time
+	FLiveLinkFrameDataStruct StateFrameDataStruct;
+	FLiveLinkFrameDataStruct LensRoleFrameDataStruct;
+	if (ConnectionSettings.bPublishStateAndLens)
+	{
+		StateFrameDataStruct.InitializeWith(FLiveLinkBaseFrameData::StaticStruct(), nullptr);
+		FLiveLinkBaseFrameData* StateFrameData = StateFrameDataStruct.Cast<FLiveLinkBaseFrameData>();
+		StateFrameData->WorldTime = LensFrameData->WorldTime;
+		StateFrameData->MetaData = LensFrameData->MetaData;
+		TakeSceneMetadata(InData, PublishedRigSceneMetadata, StateFrameData->MetaData);
+
+		TArray<float>& PropertyValues = StateFrameData->PropertyValues;
+		PropertyValues.SetNumUninitialized(static_cast<int32>(EStateProperty::Num));
+		PropertyValues[static_cast<int32>(EStateProperty::Frame)] = InData.Frame;
+		PropertyValues[static_cast<int32>(EStateProperty::Exposure)] = InData.Exposure;
+		PropertyValues[static_cast<int32>(EStateProperty::MocoFrame)] = InData.MocoFrame;
+		PropertyValues[static_cast<int32>(EStateProperty::ReadyToCapture)] = InData.bReadyToCapture ? 1.0f : 0.0f;
+		PropertyValues[static_cast<int32>(EStateProperty::StereoIndex)] = InData.StereoIndex;
+
+		// The lens of the rig as a whole, whichever eye the event was for
+		LensRoleFrameDataStruct.InitializeWith(FLiveLinkLensFrameData::StaticStruct(), nullptr);
+		FLiveLinkLensFrameData* LensRoleFrameData = LensRoleFrameDataStruct.Cast<FLiveLinkLensFrameData>();
+		static_cast<FLiveLinkCameraFrameData&>(*LensRoleFrameData) = *LensFrameData;
+		LensRoleFrameData->MetaData.StringMetaData = StateFrameData->MetaData.StringMetaData;
+	}
+
+	if (!ConnectionSettings.bStereo)
+	{
+		if (PoseSlot.IsValid())
+		{
+			PoseSlot->Write(FLiveLinkDragonLatchedPose::FromTransform(LensFrameData->Transform, LensFrameData->WorldTime));
+		}
+
+		TakeSceneMetadata(InData, PublishedEyeSceneMetadata[0], LensFrameData->MetaData);
+		Client->PushSubjectFrameData_AnyThread(SubjectKey, MoveTemp(LensFrameDataStruct));
+	}
+	else
+	{
+		// Each eye is captured separately, so only the eye the event was for gets a frame. Pushing the other one too
+		// would hand it this event's lens and world time next to the scene time of its own last capture.
+		// Dragonframe sends no rig pose, the transform is identity and each eye sits at its offset from the rig.
+		const int32 Eye = InData.StereoIndex > 0 ? 1 : 0;
+		LensFrameData->Transform = EyeOffsets[Eye] * LensFrameData->Transform;
+		TakeSceneMetadata(InData, PublishedEyeSceneMetadata[Eye], LensFrameData->MetaData);
+
+		if (EyePoseSlots[Eye].IsValid())
+		{
+			EyePoseSlots[Eye]->Write(FLiveLinkDragonLatchedPose::FromTransform(LensFrameData->Transform, LensFrameData->WorldTime));
+		}
+
+		Client->PushSubjectFrameData_AnyThread(EyeSubjectKeys[Eye], MoveTemp(LensFrameDataStruct));
+	}
+
+	if (ConnectionSettings.bPublishStateAndLens)
+	{
+		Client->PushSubjectFrameData_AnyThread(StateSubjectKey, MoveTemp(StateFrameDataStruct));
+		Client->PushSubjectFrameData_AnyThread(LensSubjectKey, MoveTemp(LensRoleFrameDataStruct));
+	}
+
+	Metrics->ArrivalToPushLatency.Record(FPlatformTime::Seconds() - ArrivalTime);
+}
+
+void FLiveLinkDragonSource::StampCaptureEvent(FLiveLinkDragonCaptureEvent& InEvent) const
+{
+	InEvent.SourceGuid = SourceGuid;
+	InEvent.SubjectName = ConnectionSettings.SubjectName;
+	InEvent.CameraSubjectName = ConnectionSettings.bStereo ? EyeSubjectKeys[InEvent.StereoIndex > 0 ? 1 : 0].SubjectName.Name : SubjectKey.SubjectName.Name;
+}
+
+void FLiveLinkDragonSource::OnCaptureReady_AnyThread(FLiveLinkDragonCaptureEvent InEvent)
+{
+	StampCaptureEvent(InEvent);
+
+	// The event subsystem delivers it on the game thread with the rest of this tick's events
+	FLiveLinkDragonEventQueue::Get().Enqueue(InEvent);
+}
+
+void FLiveLinkDragonSource::OnCaptureReady_Task(FLiveLinkDragonCaptureEvent InEvent)
+{
+	StampCaptureEvent(InEvent);
+
+	FLiveLinkDragonCaptureEvents::OnCapture_AnyThread().Broadcast(InEvent);
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -7,13 +7,14 @@
 
 #include "LiveLinkDragonSourceSettings.h"
 #include "LiveLinkDragonConnectionSettings.h"
+#include "LiveLinkDragonMetrics.h"
 
+#include "LiveLinkDragonLateLatch.h"
 #include "LiveLinkDragonMessageThread.h"
 
 #include <atomic>
 
 static constexpr uint16 DragonPortNumber = 55555;  // need to make this selectable in the settings panel
-static constexpr uint32 DragonBufferSize = 1024 * 32;
 ;
 
 // TODO: move this into DL class
@@ -49,8 +50,6 @@ struct RobotData {
 	float zoom = 0.0f;
 };
 
-class ISocketSubsystem;
-
 class LIVELINKDRAGON_API FLiveLinkDragonSource : public ILiveLinkSource
 {
 public:
@@ -78,27 +77,47 @@ private:
 	// LiveLink 
 	ILiveLinkClient* Client = nullptr;
 
-	void OnHandshakeEstablished_AnyThread();
+	void OnHandshakeEstablished_Task();
 	void OnFrameDataReady_AnyThread(FLensPacket InData); // todo: change to dragon packet
+	void OnCaptureReady_AnyThread(FLiveLinkDragonCaptureEvent InEvent);
+	void OnCaptureReady_Task(FLiveLinkDragonCaptureEvent InEvent);
+	void StampCaptureEvent(FLiveLinkDragonCaptureEvent& InEvent) const;
 
-	// Socketry
-	FSocket* Socket = nullptr;
-	ISocketSubsystem* SocketSubsystem = nullptr;
-	FString SocketDescription = "Dragin Live Link Socket";
-	FIPv4Endpoint DragonEndpoint;	// IP address and port number of the Dragon instance
+	void PushStaticData(const FLiveLinkSubjectKey& InSubjectKey);
+	void PushStateStaticData();
+	void PushLensStaticData();
 
 	// Buffers
 	TArray<uint8> ReceivedData;
 
 	FLiveLinkDragonConnectionSettings ConnectionSettings;
 
+	FGuid SourceGuid;
 	FLiveLinkSubjectKey SubjectKey;
+
+	// Published next to the camera unless turned off, from the same events
+	FLiveLinkSubjectKey StateSubjectKey;
+	FLiveLinkSubjectKey LensSubjectKey;
+
+	// Only when late latching, per subject we push. Written from the message thread, read on the render thread.
+	TSharedPtr<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> PoseSlot;
+	TSharedPtr<FLiveLinkDragonPoseSlot, ESPMode::ThreadSafe> EyePoseSlots[2];
+
+	// Stereo mode only, left then right. Each event only moves the eye it names, as each eye is captured separately.
+	FLiveLinkSubjectKey EyeSubjectKeys[2];
+	FTransform EyeOffsets[2];
+
+	// The scene metadata each subject was last given, it is only copied into a frame when it changed. The camera,
+	// or in stereo each eye, and then the state and lens subjects, which are always pushed together.
+	TSharedPtr<const TMap<FName, FString>, ESPMode::ThreadSafe> PublishedEyeSceneMetadata[2];
+	TSharedPtr<const TMap<FName, FString>, ESPMode::ThreadSafe> PublishedRigSceneMetadata;
 	FText SourceMachineName;
 
 	TUniquePtr<FLiveLinkDragonMessageThread> MessageThread;
 
-	std::atomic<double> LastTimeDataReceived;
-	std::atomic<bool> bReceivedData;
+	// Shared so the diagnostics UI can keep reading while we shut down
+	TSharedRef<FLiveLinkDragonMetrics, ESPMode::ThreadSafe> Metrics;
 
-	const float DataReceivedTimeout = 20.0f;
+	// Set once shutdown starts, after which the status queries stop trusting the snapshot
+	std::atomic<bool> bIsShuttingDown;
 };
\ No newline at end of file
@@ -1,16 +0,0 @@
-// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
-
-#pragma once
-
-#include "UObject/ObjectMacros.h"
-
-#include "LiveLinkSourceSettings.h"
-
-#include "LiveLinkDragonSourceSettings.generated.h"
-
-UCLASS()
-class LIVELINKDRAGON_API ULiveLinkDragonSourceSettings : public ULiveLinkSourceSettings
-{
-public:
-	GENERATED_BODY()
-};
\ No newline at end of file
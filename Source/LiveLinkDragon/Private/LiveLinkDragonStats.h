@@ -0,0 +1,15 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("LiveLinkDragon"), STATGROUP_LiveLinkDragon, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Packets Received"), STAT_DragonPacketsReceived, STATGROUP_LiveLinkDragon, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Packets Lost"), STAT_DragonPacketsLost, STATGROUP_LiveLinkDragon, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Packets Reordered"), STAT_DragonPacketsReordered, STATGROUP_LiveLinkDragon, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Packets Duplicated"), STAT_DragonPacketsDuplicated, STATGROUP_LiveLinkDragon, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Stale Updates Dropped"), STAT_DragonStaleUpdatesDropped, STATGROUP_LiveLinkDragon, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Packets Filtered"), STAT_DragonPacketsFiltered, STATGROUP_LiveLinkDragon, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Events Coalesced"), STAT_DragonEventsCoalesced, STATGROUP_LiveLinkDragon, );
@@ -0,0 +1,281 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonStillCache.h"
+
+#include "LiveLinkDragonCaptureEvents.h"
+#include "LiveLinkDragonSourceSettings.h"
+
+#include "Async/Async.h"
+#include "Engine/Texture2D.h"
+#include "Features/IModularFeatures.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "ILiveLinkClient.h"
+#include "Misc/FileHelper.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLiveLinkDragonStills, Log, All);
+
+namespace LiveLinkDragonStillCache
+{
+	/** Box filter down to half size, odd edges fold into the last pixel */
+	void Downsample(const TArray<FColor>& Source, FIntPoint SourceSize, TArray<FColor>& OutMip, FIntPoint& OutSize)
+	{
+		OutSize = FIntPoint(FMath::Max(1, SourceSize.X / 2), FMath::Max(1, SourceSize.Y / 2));
+		OutMip.SetNumUninitialized(OutSize.X * OutSize.Y);
+
+		for (int32 Y = 0; Y < OutSize.Y; ++Y)
+		{
+			const int32 Y0 = FMath::Min(Y * 2, SourceSize.Y - 1);
+			const int32 Y1 = FMath::Min(Y * 2 + 1, SourceSize.Y - 1);
+			for (int32 X = 0; X < OutSize.X; ++X)
+			{
+				const int32 X0 = FMath::Min(X * 2, SourceSize.X - 1);
+				const int32 X1 = FMath::Min(X * 2 + 1, SourceSize.X - 1);
+				const FColor& A = Source[Y0 * SourceSize.X + X0];
+				const FColor& B = Source[Y0 * SourceSize.X + X1];
+				const FColor& C = Source[Y1 * SourceSize.X + X0];
+				const FColor& D = Source[Y1 * SourceSize.X + X1];
+				OutMip[Y * OutSize.X + X] = FColor(
+					static_cast<uint8>((A.R + B.R + C.R + D.R + 2) / 4),
+					static_cast<uint8>((A.G + B.G + C.G + D.G + 2) / 4),
+					static_cast<uint8>((A.B + B.B + C.B + D.B + 2) / 4),
+					255);
+			}
+		}
+	}
+}
+
+FLiveLinkDragonStillCache::FLiveLinkDragonStillCache()
+	: ImageWrapperModule(FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper")))
+{
+}
+
+FLiveLinkDragonStillCache::~FLiveLinkDragonStillCache()
+{
+	FLiveLinkDragonCaptureEvents::OnCapture().Remove(OnCaptureHandle);
+}
+
+void FLiveLinkDragonStillCache::Start()
+{
+	OnCaptureHandle = FLiveLinkDragonCaptureEvents::OnCapture().AddSP(this, &FLiveLinkDragonStillCache::OnCapture);
+}
+
+UTexture2D* FLiveLinkDragonStillCache::Find(const FString& Take, int32 Frame, int32 Exposure, int32 StereoIndex)
+{
+	const FKey Key{ Take, Frame, Exposure, StereoIndex };
+	const int32 Index = Entries.IndexOfByPredicate([&Key](const FEntry& Entry) { return Entry.Key == Key; });
+	if (Index == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	// Move to the most recently used end, a still being looked at stays while older captures go
+	FEntry Entry = MoveTemp(Entries[Index]);
+	Entries.RemoveAt(Index);
+	return Entries.Add_GetRef(MoveTemp(Entry)).Texture;
+}
+
+void FLiveLinkDragonStillCache::GetRecent(int32 Count, TArray<UTexture2D*>& OutStills) const
+{
+	TArray<const FEntry*> ByCapture;
+	for (const FEntry& Entry : Entries)
+	{
+		ByCapture.Add(&Entry);
+	}
+	ByCapture.Sort([](const FEntry& A, const FEntry& B) { return A.CaptureNumber > B.CaptureNumber; });
+
+	OutStills.Reset();
+	for (int32 Index = 0; Index < ByCapture.Num() && OutStills.Num() < Count; ++Index)
+	{
+		OutStills.Add(ByCapture[Index]->Texture);
+	}
+}
+
+void FLiveLinkDragonStillCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (FEntry& Entry : Entries)
+	{
+		Collector.AddReferencedObject(Entry.Texture);
+	}
+}
+
+void FLiveLinkDragonStillCache::OnCapture(const FLiveLinkDragonCaptureEvent& Event)
+{
+	if (Event.Kind != ELiveLinkDragonCaptureEventKind::CaptureComplete || Event.ImageFileName.IsEmpty())
+	{
+		return;
+	}
+
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	if (!ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+	{
+		return;
+	}
+	ILiveLinkClient& Client = ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName);
+
+	const ULiveLinkDragonSourceSettings* Settings = Cast<ULiveLinkDragonSourceSettings>(Client.GetSourceSettings(Event.SourceGuid));
+	if (!Settings || !Settings->bImportStills)
+	{
+		return;
+	}
+
+	FRequest Request;
+	Request.ImageFileName = Event.ImageFileName;
+	Request.Key = FKey{ Event.Take, Event.Frame, Event.Exposure, Event.StereoIndex };
+	Request.MaxSize = Settings->MaxStillSize;
+
+	if (ActiveDecodes < MaxDecodes)
+	{
+		StartDecode(MoveTemp(Request));
+		return;
+	}
+
+	// Behind on decoding, and an overlay only ever wants the latest stills
+	if (PendingDecodes.Num() >= MaxPendingDecodes)
+	{
+		PendingDecodes.RemoveAt(0);
+	}
+	PendingDecodes.Add(MoveTemp(Request));
+}
+
+void FLiveLinkDragonStillCache::StartDecode(FRequest Request)
+{
+	++ActiveDecodes;
+
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [WeakCache = TWeakPtr<FLiveLinkDragonStillCache>(AsShared()), &ImageWrapperModule = ImageWrapperModule, Request = MoveTemp(Request)]()
+	{
+		FDecodedStill Still;
+		const bool bDecoded = Decode(ImageWrapperModule, Request, Still);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakCache, bDecoded, Still = MoveTemp(Still)]() mutable
+		{
+			TSharedPtr<FLiveLinkDragonStillCache> Cache = WeakCache.Pin();
+			if (!Cache.IsValid())
+			{
+				return;
+			}
+
+			--Cache->ActiveDecodes;
+			if (bDecoded)
+			{
+				Cache->OnDecoded(MoveTemp(Still));
+			}
+
+			if (Cache->PendingDecodes.Num() > 0 && Cache->ActiveDecodes < MaxDecodes)
+			{
+				FRequest Next = MoveTemp(Cache->PendingDecodes[0]);
+				Cache->PendingDecodes.RemoveAt(0);
+				Cache->StartDecode(MoveTemp(Next));
+			}
+		});
+	});
+}
+
+bool FLiveLinkDragonStillCache::Decode(IImageWrapperModule& ImageWrapperModule, const FRequest& Request, FDecodedStill& OutStill)
+{
+	using namespace LiveLinkDragonStillCache;
+
+	TArray64<uint8> Compressed;
+	if (!FFileHelper::LoadFileToArray(Compressed, *Request.ImageFileName))
+	{
+		UE_LOG(LogLiveLinkDragonStills, Warning, TEXT("Could not read still %s, is Dragonframe's image folder visible from here?"), *Request.ImageFileName);
+		return false;
+	}
+
+	const EImageFormat Format = ImageWrapperModule.DetectImageFormat(Compressed.GetData(), Compressed.Num());
+	TSharedPtr<IImageWrapper> ImageWrapper = Format != EImageFormat::Invalid ? ImageWrapperModule.CreateImageWrapper(Format) : nullptr;
+	if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(Compressed.GetData(), Compressed.Num()))
+	{
+		UE_LOG(LogLiveLinkDragonStills, Warning, TEXT("Could not decode still %s"), *Request.ImageFileName);
+		return false;
+	}
+
+	TArray64<uint8> Raw;
+	if (!ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, Raw))
+	{
+		UE_LOG(LogLiveLinkDragonStills, Warning, TEXT("Could not decode still %s"), *Request.ImageFileName);
+		return false;
+	}
+	Compressed.Empty();
+
+	TArray<FColor> Pixels;
+	FIntPoint Size(ImageWrapper->GetWidth(), ImageWrapper->GetHeight());
+	Pixels.SetNumUninitialized(Size.X * Size.Y);
+	FMemory::Memcpy(Pixels.GetData(), Raw.GetData(), Pixels.Num() * sizeof(FColor));
+	Raw.Empty();
+
+	// Camera raw sizes are far more than an overlay needs, halve down to the cap before keeping anything
+	while (FMath::Max(Size.X, Size.Y) > Request.MaxSize && FMath::Min(Size.X, Size.Y) > 1)
+	{
+		TArray<FColor> Smaller;
+		FIntPoint SmallerSize;
+		Downsample(Pixels, Size, Smaller, SmallerSize);
+		Pixels = MoveTemp(Smaller);
+		Size = SmallerSize;
+	}
+
+	OutStill.Key = Request.Key;
+	OutStill.MipSizes.Add(Size);
+	OutStill.Mips.Add(MoveTemp(Pixels));
+
+	while (Size.X > 1 || Size.Y > 1)
+	{
+		TArray<FColor> Mip;
+		Downsample(OutStill.Mips.Last(), Size, Mip, Size);
+		OutStill.MipSizes.Add(Size);
+		OutStill.Mips.Add(MoveTemp(Mip));
+	}
+
+	return true;
+}
+
+void FLiveLinkDragonStillCache::OnDecoded(FDecodedStill&& Still)
+{
+	const FIntPoint TopSize = Still.MipSizes[0];
+	UTexture2D* Texture = UTexture2D::CreateTransient(TopSize.X, TopSize.Y, PF_B8G8R8A8);
+	if (Texture == nullptr)
+	{
+		return;
+	}
+
+	// CreateTransient made the top mip, the rest are added as they are. All that happens here is copying.
+	FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+	for (int32 MipIndex = 0; MipIndex < Still.Mips.Num(); ++MipIndex)
+	{
+		if (MipIndex > 0)
+		{
+			FTexture2DMipMap* Mip = new FTexture2DMipMap();
+			Mip->SizeX = Still.MipSizes[MipIndex].X;
+			Mip->SizeY = Still.MipSizes[MipIndex].Y;
+			PlatformData->Mips.Add(Mip);
+		}
+
+		FTexture2DMipMap& Mip = PlatformData->Mips[MipIndex];
+		const int64 Bytes = Still.Mips[MipIndex].Num() * sizeof(FColor);
+		Mip.BulkData.Lock(LOCK_READ_WRITE);
+		void* Data = Mip.BulkData.Realloc(Bytes);
+		FMemory::Memcpy(Data, Still.Mips[MipIndex].GetData(), Bytes);
+		Mip.BulkData.Unlock();
+	}
+
+	Texture->SRGB = true;
+	Texture->UpdateResource();
+
+	Add(Still.Key, Texture);
+}
+
+void FLiveLinkDragonStillCache::Add(const FKey& Key, UTexture2D* Texture)
+{
+	// A re-shot frame replaces the old still and counts as the newest
+	Entries.RemoveAll([&Key](const FEntry& Entry) { return Entry.Key == Key; });
+
+	if (Entries.Num() >= MaxStills)
+	{
+		Entries.RemoveAt(0);
+	}
+
+	FEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Key = Key;
+	Entry.CaptureNumber = ++NumCaptured;
+	Entry.Texture = Texture;
+}
@@ -0,0 +1,106 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+
+struct FLiveLinkDragonCaptureEvent;
+class IImageWrapperModule;
+class UTexture2D;
+
+/**
+ * The last few stills Dragonframe captured, as textures, for onion-skin overlays over the CG.
+ *
+ * For sources with still import enabled, each captureComplete's image is read, decoded and shrunk into a mip
+ * chain on a background task. The game thread only turns finished mips into a texture. Stills are keyed by take,
+ * frame, exposure and stereo eye, and the cache keeps the MaxStills most recently used ones, a capture or a Find
+ * counting as a use, so memory stays flat however long a take runs.
+ */
+class FLiveLinkDragonStillCache : public FGCObject, public TSharedFromThis<FLiveLinkDragonStillCache>
+{
+public:
+
+	static constexpr int32 MaxStills = 16;
+
+	// Decodes at a time, captures queued behind them only keep the newest
+	static constexpr int32 MaxDecodes = 2;
+	static constexpr int32 MaxPendingDecodes = 4;
+
+	FLiveLinkDragonStillCache();
+	~FLiveLinkDragonStillCache();
+
+	/** Hook up to capture events. Separate from construction as the cache must be shared by then. */
+	void Start();
+
+	/** Marks the still as the most recently used, so it is the last to be evicted */
+	UTexture2D* Find(const FString& Take, int32 Frame, int32 Exposure, int32 StereoIndex);
+
+	/** The most recently captured, newest first */
+	void GetRecent(int32 Count, TArray<UTexture2D*>& OutStills) const;
+
+	//~ Begin FGCObject interface
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FLiveLinkDragonStillCache"); }
+	//~ End FGCObject interface
+
+private:
+
+	struct FKey
+	{
+		FString Take;
+		int32 Frame = 0;
+		int32 Exposure = 0;
+		int32 StereoIndex = 0;
+
+		bool operator==(const FKey& Other) const
+		{
+			return Frame == Other.Frame && Exposure == Other.Exposure && StereoIndex == Other.StereoIndex && Take == Other.Take;
+		}
+	};
+
+	struct FRequest
+	{
+		FString ImageFileName;
+		FKey Key;
+		int32 MaxSize = 0;
+	};
+
+	/** A decoded still, top mip first, each half the size of the one before */
+	struct FDecodedStill
+	{
+		FKey Key;
+		TArray<FIntPoint> MipSizes;
+		TArray<TArray<FColor>> Mips;
+	};
+
+	struct FEntry
+	{
+		FKey Key;
+		uint64 CaptureNumber = 0;
+		TObjectPtr<UTexture2D> Texture;
+	};
+
+	void OnCapture(const FLiveLinkDragonCaptureEvent& Event);
+
+	void StartDecode(FRequest Request);
+	static bool Decode(IImageWrapperModule& ImageWrapperModule, const FRequest& Request, FDecodedStill& OutStill);
+
+	/** Game thread */
+	void OnDecoded(FDecodedStill&& Still);
+	void Add(const FKey& Key, UTexture2D* Texture);
+
+	IImageWrapperModule& ImageWrapperModule;
+
+	// Least recently used first
+	TArray<FEntry> Entries;
+
+	// Counts stills as they are added, GetRecent goes by capture order rather than use
+	uint64 NumCaptured = 0;
+
+	// Game thread only, decodes report back there
+	TArray<FRequest> PendingDecodes;
+	int32 ActiveDecodes = 0;
+
+	FDelegateHandle OnCaptureHandle;
+};
@@ -0,0 +1,27 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonStringTable.h"
+
+FLiveLinkDragonStringTable::FLiveLinkDragonStringTable()
+{
+	Strings.Add(FString());
+}
+
+FDragonStringHandle FLiveLinkDragonStringTable::Intern(const FString& Value)
+{
+	FDragonStringHandle Handle;
+	if (Value.IsEmpty())
+	{
+		return Handle;
+	}
+
+	if (const uint32* Existing = Lookup.Find(Value))
+	{
+		Handle.Index = *Existing;
+		return Handle;
+	}
+
+	Handle.Index = Strings.Add(Value);
+	Lookup.Add(Value, Handle.Index);
+	return Handle;
+}
@@ -0,0 +1,45 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Stable handle to a string in an FLiveLinkDragonStringTable. Handles are never reused, so equal handles mean equal strings. */
+struct FDragonStringHandle
+{
+	uint32 Index = 0;
+
+	bool IsSet() const { return Index != 0; }
+
+	bool operator==(const FDragonStringHandle& Other) const { return Index == Other.Index; }
+	bool operator!=(const FDragonStringHandle& Other) const { return Index != Other.Index; }
+};
+
+/**
+ * Interns the scene strings Dragonframe repeats in nearly every event (production, scene, take, ...).
+ *
+ * They change a handful of times per shoot, so after the first time a value is seen it costs a
+ * hash lookup and no allocation. Only used from the message thread.
+ */
+class FLiveLinkDragonStringTable
+{
+public:
+
+	FLiveLinkDragonStringTable();
+
+	/** Returns the handle for the value, adding it the first time it is seen. Empty strings get the unset handle. */
+	FDragonStringHandle Intern(const FString& Value);
+
+	const FString& Get(FDragonStringHandle Handle) const
+	{
+		return Strings.IsValidIndex(Handle.Index) ? Strings[Handle.Index] : Strings[0];
+	}
+
+	int32 Num() const { return Strings.Num() - 1; }
+
+private:
+
+	// Slot 0 is the empty string, so unset handles resolve to something valid
+	TArray<FString> Strings;
+	TMap<FString, uint32> Lookup;
+};
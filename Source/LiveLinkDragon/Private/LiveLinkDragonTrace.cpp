@@ -0,0 +1,178 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonTrace.h"
+
+#if LIVELINKDRAGON_TRACE
+
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLiveLinkDragonTrace, Log, All);
+
+namespace LiveLinkDragonTrace
+{
+	// Most lines per second and category, anything beyond that is only counted
+	static const int32 RateLimits[static_cast<int32>(EDragonTraceCategory::Num)] =
+	{
+		10,	// Packet
+		20,	// Event
+		5,	// UnknownEvent
+		5,	// Dropped
+	};
+
+	static const TCHAR* CategoryNames[static_cast<int32>(EDragonTraceCategory::Num)] =
+	{
+		TEXT("packet"),
+		TEXT("event"),
+		TEXT("unknown event"),
+		TEXT("dropped"),
+	};
+}
+
+FLiveLinkDragonTrace::FLiveLinkDragonTrace(FName InSubjectName)
+	: SubjectName(InSubjectName)
+{
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool();
+}
+
+FLiveLinkDragonTrace::~FLiveLinkDragonTrace()
+{
+	if (Thread.IsValid())
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		Thread.Reset();
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+}
+
+void FLiveLinkDragonTrace::Start()
+{
+	bIsRunning = true;
+	Thread.Reset(FRunnableThread::Create(this, TEXT("Dragon Trace Flusher"), 0, TPri_Lowest));
+}
+
+void FLiveLinkDragonTrace::Stop()
+{
+	bIsRunning = false;
+	WakeEvent->Trigger();
+}
+
+void FLiveLinkDragonTrace::Add(EDragonTraceCategory Category, ELiveLinkDragonEventType EventType, uint32 Sender, int32 Size, float Microseconds)
+{
+	const uint32 WriteIndex = Head.load(std::memory_order_relaxed);
+	if (WriteIndex - Tail.load(std::memory_order_acquire) >= Capacity)
+	{
+		Overflows.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	FDragonTraceRecord& Record = Ring[WriteIndex & (Capacity - 1)];
+	Record.Time = FPlatformTime::Seconds();
+	Record.Microseconds = Microseconds;
+	Record.Size = Size;
+	Record.Sender = Sender;
+	Record.Category = Category;
+	Record.EventType = EventType;
+
+	Head.store(WriteIndex + 1, std::memory_order_release);
+}
+
+void FLiveLinkDragonTrace::AddSender(uint32 Sender, FString&& Description)
+{
+	NewSenders.Enqueue(TPair<uint32, FString>(Sender, MoveTemp(Description)));
+}
+
+uint32 FLiveLinkDragonTrace::Run()
+{
+	while (bIsRunning)
+	{
+		WakeEvent->Wait(FTimespan::FromMilliseconds(FlushIntervalMilliseconds));
+		Flush();
+	}
+	return 0;
+}
+
+void FLiveLinkDragonTrace::Flush()
+{
+	using namespace LiveLinkDragonTrace;
+
+	TPair<uint32, FString> NewSender;
+	while (NewSenders.Dequeue(NewSender))
+	{
+		UE_LOG(LogLiveLinkDragonTrace, Log, TEXT("[%s] sender %u is %s"), *SubjectName.ToString(), NewSender.Key, *NewSender.Value);
+		SenderNames.Add(NewSender.Key, MoveTemp(NewSender.Value));
+
+		if (NewSender.Key > MaxSenderNames)
+		{
+			const uint32 Oldest = NewSender.Key - MaxSenderNames;
+			SenderNames.Remove(Oldest);
+		}
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (Now - RateWindowStart >= 1.0)
+	{
+		for (int32 Category = 0; Category < static_cast<int32>(EDragonTraceCategory::Num); ++Category)
+		{
+			if (SuppressedInWindow[Category] > 0)
+			{
+				UE_LOG(LogLiveLinkDragonTrace, Log, TEXT("[%s] %d more %s records in the last second not logged"), *SubjectName.ToString(), SuppressedInWindow[Category], CategoryNames[Category]);
+			}
+			LinesInWindow[Category] = 0;
+			SuppressedInWindow[Category] = 0;
+		}
+		RateWindowStart = Now;
+	}
+
+	const uint32 ReadEnd = Head.load(std::memory_order_acquire);
+	uint32 ReadIndex = Tail.load(std::memory_order_relaxed);
+	for (; ReadIndex != ReadEnd; ++ReadIndex)
+	{
+		const FDragonTraceRecord& Record = Ring[ReadIndex & (Capacity - 1)];
+		const int32 Category = static_cast<int32>(Record.Category);
+		if (LinesInWindow[Category] < RateLimits[Category])
+		{
+			++LinesInWindow[Category];
+			Log(Record);
+		}
+		else
+		{
+			++SuppressedInWindow[Category];
+		}
+	}
+	Tail.store(ReadIndex, std::memory_order_release);
+
+	if (const uint32 Lost = Overflows.exchange(0, std::memory_order_relaxed))
+	{
+		UE_LOG(LogLiveLinkDragonTrace, Warning, TEXT("[%s] trace ring overflowed, %u records lost"), *SubjectName.ToString(), Lost);
+	}
+}
+
+void FLiveLinkDragonTrace::Log(const FDragonTraceRecord& Record)
+{
+	const FString* SenderName = SenderNames.Find(Record.Sender);
+	const TCHAR* Sender = SenderName ? **SenderName : TEXT("?");
+
+	switch (Record.Category)
+	{
+	case EDragonTraceCategory::Packet:
+		UE_LOG(LogLiveLinkDragonTrace, Log, TEXT("[%s] %.6f received %d bytes from %s, %.0fus after arrival"), *SubjectName.ToString(), Record.Time, Record.Size, Sender, Record.Microseconds);
+		break;
+	case EDragonTraceCategory::Event:
+		UE_LOG(LogLiveLinkDragonTrace, Log, TEXT("[%s] %.6f %s event, %d bytes parsed in %.0fus"), *SubjectName.ToString(), Record.Time, GetDragonEventTypeName(Record.EventType), Record.Size, Record.Microseconds);
+		break;
+	case EDragonTraceCategory::UnknownEvent:
+		UE_LOG(LogLiveLinkDragonTrace, Log, TEXT("[%s] %.6f %d bytes from %s with an unknown or missing event type"), *SubjectName.ToString(), Record.Time, Record.Size, Sender);
+		break;
+	case EDragonTraceCategory::Dropped:
+		UE_LOG(LogLiveLinkDragonTrace, Log, TEXT("[%s] %.6f dropped %d bytes from %s as duplicate or stale"), *SubjectName.ToString(), Record.Time, Record.Size, Sender);
+		break;
+	default:
+		break;
+	}
+}
+
+#endif
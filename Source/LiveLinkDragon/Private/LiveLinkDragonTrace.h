@@ -0,0 +1,121 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/Runnable.h"
+
+#include "LiveLinkDragonMetrics.h"
+
+#include <atomic>
+
+// Packet tracing costs a few stores per datagram, shipping builds leave it out entirely
+#ifndef LIVELINKDRAGON_TRACE
+#define LIVELINKDRAGON_TRACE !UE_BUILD_SHIPPING
+#endif
+
+#if LIVELINKDRAGON_TRACE
+#define DRAGON_TRACE(Trace, ...) (Trace).Add(__VA_ARGS__)
+#define DRAGON_TRACE_SENDER(Trace, ...) (Trace).AddSender(__VA_ARGS__)
+#else
+#define DRAGON_TRACE(Trace, ...)
+#define DRAGON_TRACE_SENDER(Trace, ...)
+#endif
+
+enum class EDragonTraceCategory : uint8
+{
+	Packet,			// a datagram came in
+	Event,			// it parsed as a Dragonframe event we handle
+	UnknownEvent,	// it parsed but we don't know the event, or it has none
+	Dropped,		// duplicate or stale, thrown away
+
+	Num
+};
+
+/** One traced occurrence. No strings, the flusher turns it into text later. */
+struct FDragonTraceRecord
+{
+	double Time = 0.0;
+	float Microseconds = 0.0f;	// receive latency for packets, parse time for events
+	int32 Size = 0;
+	uint32 Sender = 0;		// handles only ever increase, so a record can't be pinned on a later sender
+	EDragonTraceCategory Category = EDragonTraceCategory::Packet;
+	ELiveLinkDragonEventType EventType = ELiveLinkDragonEventType::Unknown;
+};
+
+#if LIVELINKDRAGON_TRACE
+
+class FEvent;
+class FRunnableThread;
+
+/**
+ * Structured trace of the message thread, formatted and logged off the socket thread.
+ *
+ * The message thread writes fixed-size records into a single-producer ring, a flusher thread
+ * drains it a few times a second and logs with a per-category rate limit, so leaving tracing on
+ * costs the socket thread a handful of stores per datagram rather than string formatting.
+ * If the flusher falls behind, records are dropped and counted rather than blocking.
+ */
+class FLiveLinkDragonTrace : public FRunnable
+{
+public:
+
+	explicit FLiveLinkDragonTrace(FName InSubjectName);
+	~FLiveLinkDragonTrace();
+
+	void Start();
+
+	//~ Called from the message thread only
+	void Add(EDragonTraceCategory Category, ELiveLinkDragonEventType EventType, uint32 Sender, int32 Size, float Microseconds);
+
+	/** Name a sender handle, once per new sender, so records can carry the handle instead of the address */
+	void AddSender(uint32 Sender, FString&& Description);
+
+	//~ FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End FRunnable Interface
+
+private:
+
+	void Flush();
+	void Log(const FDragonTraceRecord& Record);
+
+	const FName SubjectName;
+
+	static constexpr uint32 Capacity = 4096; // power of two
+	FDragonTraceRecord Ring[Capacity];
+	std::atomic<uint32> Head{ 0 };	// next slot the message thread writes
+	std::atomic<uint32> Tail{ 0 };	// next slot the flusher reads
+	std::atomic<uint32> Overflows{ 0 };
+
+	TQueue<TPair<uint32, FString>, EQueueMode::Spsc> NewSenders;
+
+	//~ Flusher thread only. Names far behind the newest handle are forgotten, their records log as an unknown sender.
+	TMap<uint32, FString> SenderNames;
+	double RateWindowStart = 0.0;
+	int32 LinesInWindow[static_cast<int32>(EDragonTraceCategory::Num)] = { 0 };
+	int32 SuppressedInWindow[static_cast<int32>(EDragonTraceCategory::Num)] = { 0 };
+
+	FEvent* WakeEvent = nullptr;
+	TUniquePtr<FRunnableThread> Thread;
+	std::atomic<bool> bIsRunning{ false };
+
+	static constexpr float FlushIntervalMilliseconds = 200.0f;
+	static constexpr uint32 MaxSenderNames = 1024;
+};
+
+#else
+
+/** Stands in for the trace when it is compiled out */
+class FLiveLinkDragonTrace
+{
+public:
+
+	explicit FLiveLinkDragonTrace(FName) {}
+
+	void Start() {}
+};
+
+#endif
@@ -0,0 +1,97 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+
+#include "LiveLinkDragonCaptureEvents.generated.h"
+
+/** The Dragonframe events that mark a point in the shoot, as opposed to state that is simply replaced */
+UENUM(BlueprintType)
+enum class ELiveLinkDragonCaptureEventKind : uint8
+{
+	Shoot,
+	Delete,
+	CaptureComplete,
+	FrameComplete
+};
+
+/** A shoot, delete or capture Dragonframe reported, with the camera state at the time */
+USTRUCT(BlueprintType)
+struct LIVELINKDRAGON_API FLiveLinkDragonCaptureEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	ELiveLinkDragonCaptureEventKind Kind = ELiveLinkDragonCaptureEventKind::CaptureComplete;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FGuid SourceGuid;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FName SubjectName;
+
+	// The camera subject the capture was for, on a stereo rig the eye's (SubjectName_Left or SubjectName_Right)
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FName CameraSubjectName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FString Production;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FString Scene;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FString Take;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FString ImageFileName;
+
+	// Deletes carry no frame, this is the last one captured, INDEX_NONE if none was seen this session
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	int32 Frame = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	int32 Exposure = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	int32 StereoIndex = 0;
+
+	// frameComplete rather than captureComplete, i.e. the last exposure of the frame
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	bool bFrameComplete = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	float FocalLength = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	float FocusDistance = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	float Aperture = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	float HorizontalFOV = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	double WorldTime = 0.0;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnLiveLinkDragonCapture, const FLiveLinkDragonCaptureEvent&);
+DECLARE_TS_MULTICAST_DELEGATE_OneParam(FOnLiveLinkDragonCaptureAnyThread, const FLiveLinkDragonCaptureEvent&);
+
+/** Captures from every Dragon source, for tools that react to the shoot rather than to every frame */
+class LIVELINKDRAGON_API FLiveLinkDragonCaptureEvents
+{
+public:
+
+	/** Broadcast on the game thread, for captureComplete and frameComplete only */
+	static FOnLiveLinkDragonCapture& OnCapture();
+
+	/**
+	 * Broadcast on a background task for every kind of event, in order for each source. For work too slow for the
+	 * game thread, like writing files. Handlers run off the game thread and must not touch UObjects.
+	 */
+	static FOnLiveLinkDragonCaptureAnyThread& OnCapture_AnyThread();
+};
@@ -0,0 +1,106 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+enum class EDragonCaptureRecordFlags : uint8
+{
+	None = 0,
+	FrameComplete = 1 << 0,	// the last exposure of the frame, from frameComplete when that exposure's captureComplete was missed
+	Deleted = 1 << 1,		// Dragonframe deleted the frame, the record keeps what it was
+};
+ENUM_CLASS_FLAGS(EDragonCaptureRecordFlags);
+
+/**
+ * One capture as written to a take's journal.
+ * Fixed size and append-only, so record N always lives at a known offset and never moves.
+ */
+struct FDragonCaptureRecord
+{
+	static constexpr int32 MaxImageFileNameLength = 400;
+
+	int64 CaptureTimeUtcTicks = 0;	// FDateTime ticks
+	double WorldTime = 0.0;			// FPlatformTime::Seconds() of the capture event, after clock sync
+
+	float FocalLength = 0.0f;
+	float FocusDistance = 0.0f;
+	float Aperture = 0.0f;
+	float HorizontalFOV = 0.0f;
+
+	uint16 Frame = 0;
+	uint16 Exposure = 0;
+	uint16 StereoIndex = 0;
+	EDragonCaptureRecordFlags Flags = EDragonCaptureRecordFlags::None;
+	uint8 Reserved[9] = { 0 };
+
+	// UTF-8, always NUL terminated, truncated if Dragonframe sends something longer
+	ANSICHAR ImageFileName[MaxImageFileNameLength] = { 0 };
+
+	FString GetImageFileName() const
+	{
+		return FString(UTF8_TO_TCHAR(ImageFileName));
+	}
+};
+static_assert(sizeof(FDragonCaptureRecord) == 448, "Capture records are a file format, don't change their size without bumping the journal version");
+
+/** The files starting a journal (.dragonjournal) and its index (.dragonindex) */
+struct FDragonCaptureFileHeader
+{
+	static constexpr uint32 JournalMagic = 0x4C4E524A;	// 'JRNL'
+	static constexpr uint32 IndexMagic = 0x58444E49;	// 'INDX'
+	static constexpr uint32 CurrentVersion = 1;
+
+	// Index slots per frame, exposures past this are journalled but not indexed
+	static constexpr uint32 ExposureSlots = 16;
+
+	uint32 Magic = 0;
+	uint32 Version = CurrentVersion;
+	uint32 RecordSize = 0;		// sizeof(FDragonCaptureRecord) for journals, sizeof(uint32) for index slots
+	uint32 FrameCapacity = 0;	// index only, frames the slot table currently covers
+};
+static_assert(sizeof(FDragonCaptureFileHeader) == 16, "Capture file headers are a file format");
+
+/**
+ * Read side of a take's capture journal, for tools that need random access to what was shot.
+ *
+ * Both files are memory-mapped. The index is a flat table of uint32 slots, one per frame and exposure,
+ * holding the record number plus one, so a lookup is two pointer offsets. Safe to use while the
+ * plugin keeps appending, call Refresh() to see captures made since the last Open or Refresh.
+ */
+class LIVELINKDRAGON_API FLiveLinkDragonCaptureIndex
+{
+public:
+
+	~FLiveLinkDragonCaptureIndex();
+
+	/** Where the journal of a take lives, without extension */
+	static FString GetTakePath(const FString& JournalDirectory, const FString& Production, const FString& Scene, const FString& Take);
+
+	static FString GetDefaultJournalDirectory();
+
+	bool Open(const FString& InTakePath);
+	void Close();
+	bool Refresh();
+
+	bool IsOpen() const { return JournalRegion.IsValid(); }
+
+	/** The latest capture of a frame and exposure, or null if there is none or it was deleted */
+	const FDragonCaptureRecord* Find(int32 Frame, int32 Exposure) const;
+
+	/** All records in capture order, including deleted ones */
+	int32 NumRecords() const;
+	const FDragonCaptureRecord* GetRecord(int32 RecordIndex) const;
+
+private:
+
+	FString TakePath;
+
+	TUniquePtr<IMappedFileHandle> JournalHandle;
+	TUniquePtr<IMappedFileRegion> JournalRegion;
+	TUniquePtr<IMappedFileHandle> IndexHandle;
+	TUniquePtr<IMappedFileRegion> IndexRegion;
+};
@@ -17,4 +17,74 @@ struct FLiveLinkDragonConnectionSettings
 
 	UPROPERTY(EditAnywhere, Category = "Settings")
 	FName SubjectName = TEXT("DragonBridgeDevice");
+
+	/** Only accept datagrams from these hosts or subnets, e.g. 192.168.1.20 or 10.0.0.0/24. Leave empty to accept anyone. */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	TArray<FString> AllowedSenders;
+
+	/** Answer Dragonframe's hello and send it commands. When several nodes share one multicast stream, leave this on for exactly one of them. */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	bool bReplyToSender = true;
+
+	/** Join this multicast group, e.g. 239.1.2.3 or ff15::1:2:3, so every node in a cluster receives the same datagrams. Leave empty for unicast and broadcast. */
+	UPROPERTY(EditAnywhere, Category = "Multicast")
+	FString MulticastGroup;
+
+	/** Address of the local interface to join the group on, the system default if empty */
+	UPROPERTY(EditAnywhere, Category = "Multicast")
+	FString MulticastInterface;
+
+	/** Also receive datagrams sent to the group from this machine, e.g. from a relay running alongside */
+	UPROPERTY(EditAnywhere, Category = "Multicast")
+	bool bMulticastLoopback = true;
+
+	/** Keep spinning on the socket for a short while after each packet instead of going straight back to a blocking wait. Trades CPU for latency, so only use it on dedicated machines. */
+	UPROPERTY(EditAnywhere, Category = "Latency")
+	bool bBusyPoll = false;
+
+	/** How long to spin after each packet before falling back to a blocking wait, in microseconds */
+	UPROPERTY(EditAnywhere, Category = "Latency", meta = (EditCondition = "bBusyPoll", ClampMin = "0", ClampMax = "20000"))
+	int32 BusyPollBudgetMicroseconds = 500;
+
+	/**
+	 * Correct frame timestamps for the network delay and, when a bridge answers pings, for the clock offset and drift between the hosts.
+	 * Off by default, it shifts WorldTime, and until a bridge answers pings the delay is only estimated from the handshake.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Latency")
+	bool bClockSync = false;
+
+	/** How often to ping a binary-framing bridge for clock samples, in seconds */
+	UPROPERTY(EditAnywhere, Category = "Latency", meta = (EditCondition = "bClockSync", ClampMin = "0.1", ClampMax = "60.0"))
+	float ClockSyncIntervalSeconds = 1.0f;
+
+	/** Let the render thread pick up the newest pose just before it draws, for live preview. Applies to cameras whose actor is tagged with the subject name, the game thread pose is kept when nothing newer arrived. */
+	UPROPERTY(EditAnywhere, Category = "Latency")
+	bool bLateLatchPose = false;
+
+	/**
+	 * Also publish SubjectName_State, a basic role subject whose properties are Frame, Exposure, MocoFrame, ReadyToCapture
+	 * and StereoIndex, and SubjectName_Lens, a lens role subject. Both come from the same events as the camera.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	bool bPublishStateAndLens = true;
+
+	/** Publish a left and a right eye subject (SubjectName_Left, SubjectName_Right) instead of one camera. Events are routed by their stereoIndex, 0 being the left eye. */
+	UPROPERTY(EditAnywhere, Category = "Stereo")
+	bool bStereo = false;
+
+	/** Distance between the eyes in cm, each is offset by half of it from the rig pose */
+	UPROPERTY(EditAnywhere, Category = "Stereo", meta = (EditCondition = "bStereo", ClampMin = "0.0"))
+	float InteraxialDistance = 6.5f;
+
+	/** Distance in cm at which the eyes converge, zero for a parallel rig */
+	UPROPERTY(EditAnywhere, Category = "Stereo", meta = (EditCondition = "bStereo", ClampMin = "0.0"))
+	float ConvergenceDistance = 0.0f;
+
+	/** Keep a journal of every capture per take, with an index from frame and exposure to image file and camera state */
+	UPROPERTY(EditAnywhere, Category = "Capture")
+	bool bCaptureJournal = false;
+
+	/** Where the journals go, Saved/LiveLinkDragon/Journal if empty. One folder per production and scene, one journal per take. */
+	UPROPERTY(EditAnywhere, Category = "Capture", meta = (EditCondition = "bCaptureJournal"))
+	FString CaptureJournalDirectory;
 };
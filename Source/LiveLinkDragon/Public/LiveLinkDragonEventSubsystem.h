@@ -0,0 +1,145 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "Tickable.h"
+
+#include "LiveLinkDragonCaptureEvents.h"
+#include "LiveLinkDragonMetrics.h"
+
+#include "LiveLinkDragonEventSubsystem.generated.h"
+
+class FLiveLinkDragonPlateExporter;
+class FLiveLinkDragonStillCache;
+class UTexture2D;
+
+/** What a Dragon source last heard from Dragonframe, for Blueprint */
+USTRUCT(BlueprintType)
+struct LIVELINKDRAGON_API FLiveLinkDragonDeviceState
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FString Production;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FString Scene;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FString Take;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FString ExposureName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FString CaptureState;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	FString ImageFileName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	bool bReadyToCapture = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	int32 Frame = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	int32 MocoFrame = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	int32 Exposure = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	int32 StereoIndex = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	double MinAPIVersion = 0.0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Dragonframe")
+	double MaxAPIVersion = 0.0;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnLiveLinkDragonEvent, const FLiveLinkDragonCaptureEvent&, Event);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnLiveLinkDragonEventBatch, const TArray<FLiveLinkDragonCaptureEvent>&, Events);
+
+/**
+ * Shoots, deletes and captures from every Dragon source, delivered on the game thread.
+ *
+ * The message threads queue events as they are handled, and once a tick everything queued since the last
+ * one is fired in arrival order: the per-kind delegates for each event, then the whole batch at once for
+ * listeners that would rather see a tick's worth together. Lighting cues or a CG prop stepping per exposure
+ * can bind here instead of polling.
+ *
+ * The current device state of each source can be read at any time, without locks, from its seqlocked snapshot.
+ */
+UCLASS()
+class LIVELINKDRAGON_API ULiveLinkDragonEventSubsystem : public UEngineSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintAssignable, Category = "LiveLink Dragon")
+	FOnLiveLinkDragonEvent OnShoot;
+
+	UPROPERTY(BlueprintAssignable, Category = "LiveLink Dragon")
+	FOnLiveLinkDragonEvent OnDelete;
+
+	UPROPERTY(BlueprintAssignable, Category = "LiveLink Dragon")
+	FOnLiveLinkDragonEvent OnCaptureComplete;
+
+	UPROPERTY(BlueprintAssignable, Category = "LiveLink Dragon")
+	FOnLiveLinkDragonEvent OnFrameComplete;
+
+	/** Everything from one tick, after the per-kind delegates have fired */
+	UPROPERTY(BlueprintAssignable, Category = "LiveLink Dragon")
+	FOnLiveLinkDragonEventBatch OnEventBatch;
+
+	/** The latest device state of the source publishing this subject. False if there is no such source. */
+	UFUNCTION(BlueprintCallable, Category = "LiveLink Dragon")
+	bool GetDeviceState(FName SubjectName, FLiveLinkDragonDeviceState& OutState);
+
+	/** The still Dragonframe captured for this exposure and eye of the frame, if it is still cached. Needs still import on the source. */
+	UFUNCTION(BlueprintCallable, Category = "LiveLink Dragon")
+	UTexture2D* FindStill(const FString& Take, int32 Frame, int32 Exposure, int32 StereoIndex);
+
+	/** Up to Count of the most recently captured stills, newest first */
+	UFUNCTION(BlueprintCallable, Category = "LiveLink Dragon")
+	TArray<UTexture2D*> GetRecentStills(int32 Count) const;
+
+	/** Events thrown away because nothing was draining the queue */
+	UFUNCTION(BlueprintPure, Category = "LiveLink Dragon")
+	int64 GetDroppedEvents() const;
+
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickableInEditor() const override { return true; }
+	virtual bool IsTickableWhenPaused() const override { return true; }
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject interface
+
+private:
+
+	void Deliver(const FLiveLinkDragonCaptureEvent& Event);
+
+	// Reused from tick to tick, only filled when something listens for batches
+	TArray<FLiveLinkDragonCaptureEvent> Batch;
+
+	// Writes CG plates for sources that export them, driven by the capture events delivered here
+	TSharedPtr<FLiveLinkDragonPlateExporter> PlateExporter;
+
+	// Textures of the latest stills, for sources that import them
+	TSharedPtr<FLiveLinkDragonStillCache> StillCache;
+
+	// The registry only locks when sources come and go, so keep a copy and refresh it when its version moves
+	TArray<FLiveLinkDragonMetricsRegistry::FEntry> Sources;
+	uint32 SourcesVersion = MAX_uint32;
+};
@@ -0,0 +1,333 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "LiveLinkDragonSeqLock.h"
+
+#include <atomic>
+
+/**
+ * Lock-free latency histogram with power-of-two microsecond buckets.
+ * Bucket N holds samples in [2^N, 2^(N+1)) microseconds, so percentiles are accurate to a factor of two.
+ */
+struct FLiveLinkDragonLatencyHistogram
+{
+	static constexpr int32 NumBuckets = 32;
+
+	std::atomic<uint64> Buckets[NumBuckets] = {};
+	std::atomic<uint64> Count{ 0 };
+	std::atomic<uint64> TotalMicroseconds{ 0 };
+
+	void Record(double Seconds)
+	{
+		const uint64 Microseconds = Seconds > 0.0 ? static_cast<uint64>(Seconds * 1.0e6) : 0;
+		const int32 Bucket = Microseconds > 0 ? FMath::Min<int32>(NumBuckets - 1, FMath::FloorLog2_64(Microseconds)) : 0;
+
+		Buckets[Bucket].fetch_add(1, std::memory_order_relaxed);
+		TotalMicroseconds.fetch_add(Microseconds, std::memory_order_relaxed);
+		Count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/** Copies the bucket counts out, e.g. to diff against an earlier copy for a windowed percentile */
+	void GetBuckets(uint64 (&OutBuckets)[NumBuckets]) const
+	{
+		for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+		{
+			OutBuckets[Bucket] = Buckets[Bucket].load(std::memory_order_relaxed);
+		}
+	}
+
+	/** Returns the upper edge of the bucket holding the given percentile (0..1), in seconds */
+	double GetPercentile(double Percentile) const
+	{
+		uint64 Counts[NumBuckets];
+		GetBuckets(Counts);
+		return GetPercentile(Counts, Percentile);
+	}
+
+	static double GetPercentile(const uint64 (&InBuckets)[NumBuckets], double Percentile)
+	{
+		uint64 Total = 0;
+		for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+		{
+			Total += InBuckets[Bucket];
+		}
+
+		if (Total == 0)
+		{
+			return 0.0;
+		}
+
+		const uint64 Target = FMath::Max<uint64>(1, static_cast<uint64>(FMath::CeilToDouble(Percentile * Total)));
+		uint64 Seen = 0;
+		for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+		{
+			Seen += InBuckets[Bucket];
+			if (Seen >= Target)
+			{
+				return static_cast<double>(uint64(1) << (Bucket + 1)) * 1.0e-6;
+			}
+		}
+		return static_cast<double>(uint64(1) << NumBuckets) * 1.0e-6;
+	}
+
+	double GetAverage() const
+	{
+		const uint64 Samples = Count.load(std::memory_order_relaxed);
+		return Samples > 0 ? TotalMicroseconds.load(std::memory_order_relaxed) * 1.0e-6 / Samples : 0.0;
+	}
+};
+
+/** The Dragonframe events we know about, for per-type counters */
+enum class ELiveLinkDragonEventType : uint8
+{
+	KeepAlive,
+	Position,
+	CaptureState,
+	Shoot,
+	Delete,
+	CaptureComplete,
+	FrameComplete,
+	ViewFrame,
+	Unknown,
+
+	Num
+};
+
+inline const TCHAR* GetDragonEventTypeName(ELiveLinkDragonEventType EventType)
+{
+	switch (EventType)
+	{
+	case ELiveLinkDragonEventType::KeepAlive:		return TEXT("hello");
+	case ELiveLinkDragonEventType::Position:		return TEXT("position");
+	case ELiveLinkDragonEventType::CaptureState:	return TEXT("captureState");
+	case ELiveLinkDragonEventType::Shoot:			return TEXT("shoot");
+	case ELiveLinkDragonEventType::Delete:			return TEXT("delete");
+	case ELiveLinkDragonEventType::CaptureComplete:	return TEXT("captureComplete");
+	case ELiveLinkDragonEventType::FrameComplete:	return TEXT("frameComplete");
+	case ELiveLinkDragonEventType::ViewFrame:		return TEXT("viewFrame");
+	default:										return TEXT("unknown");
+	}
+}
+
+enum class ELiveLinkDragonConnectionState : uint8
+{
+	Stopped,
+	Listening,
+	Error,
+};
+
+/** Where the message thread is in its conversation with Dragonframe */
+enum class ELiveLinkDragonSessionState : uint8
+{
+	Unbound,		// no socket yet, retrying the bind
+	Listening,		// bound, nobody has talked to us yet
+	Active,			// Dragonframe has talked to us and had our hello back
+	Stale,			// handshook but quiet for a while, which is also what a crashed Dragonframe looks like
+	Rebinding,		// the socket failed, backing off before binding again
+};
+
+inline const TCHAR* GetDragonSessionStateName(ELiveLinkDragonSessionState SessionState)
+{
+	switch (SessionState)
+	{
+	case ELiveLinkDragonSessionState::Unbound:		return TEXT("unbound");
+	case ELiveLinkDragonSessionState::Listening:	return TEXT("listening");
+	case ELiveLinkDragonSessionState::Active:		return TEXT("active");
+	case ELiveLinkDragonSessionState::Stale:		return TEXT("stale");
+	case ELiveLinkDragonSessionState::Rebinding:	return TEXT("rebinding");
+	default:										return TEXT("unknown");
+	}
+}
+
+/**
+ * What the message thread last knew about its connection, published as one consistent copy
+ * so game thread and UI queries never have to go near the socket.
+ */
+struct FLiveLinkDragonStatusSnapshot
+{
+	ELiveLinkDragonConnectionState ConnectionState = ELiveLinkDragonConnectionState::Stopped;
+	ELiveLinkDragonSessionState SessionState = ELiveLinkDragonSessionState::Unbound;
+	bool bHandshook = false;
+
+	// When the session state last changed, and how long the last failure took to recover from
+	double SessionStateTime = 0.0;
+	float LastRecoverySeconds = 0.0f;
+
+	// FPlatformTime::Seconds(), zero if nothing has arrived yet
+	double LastPacketTime = 0.0;
+	double PublishTime = 0.0;
+
+	// Over the last publish window
+	float PacketsPerSecond = 0.0f;
+	float BytesPerSecond = 0.0f;
+
+	uint32 SocketErrors = 0;
+	uint32 ParseErrors = 0;
+
+	// CPU time the message thread has used so far, only that thread's, as of PublishTime
+	double ThreadCPUSeconds = 0.0;
+};
+
+/**
+ * Everything the message thread knows about the Dragonframe it talks to, published as one consistent copy
+ * after each batch of events so game, render and editor threads can read it at any rate.
+ * Strings are UTF-8 in fixed buffers to keep the snapshot trivially copyable, always NUL terminated and
+ * truncated if Dragonframe sends something longer.
+ */
+struct FLiveLinkDragonDeviceSnapshot
+{
+	static constexpr int32 MaxNameLength = 64;
+	static constexpr int32 MaxImageFileNameLength = 256;
+
+	// False until Dragonframe has sent anything
+	bool bHasAppeared = false;
+	bool bReadyToCapture = false;
+
+	double MinAPIVersion = 0.0;
+	double MaxAPIVersion = 0.0;
+
+	uint16 Frame = 0;
+	uint16 MocoFrame = 0;
+	uint16 Exposure = 0;
+	uint16 StereoIndex = 0;
+
+	// World time of the last event that went into this copy
+	double UpdateTime = 0.0;
+
+	ANSICHAR Production[MaxNameLength] = { 0 };
+	ANSICHAR Scene[MaxNameLength] = { 0 };
+	ANSICHAR Take[MaxNameLength] = { 0 };
+	ANSICHAR ExposureName[MaxNameLength] = { 0 };
+	ANSICHAR CaptureState[MaxNameLength] = { 0 };
+	ANSICHAR ImageFileName[MaxImageFileNameLength] = { 0 };
+
+	static FString ToString(const ANSICHAR* Utf8)
+	{
+		return FString(UTF8_TO_TCHAR(Utf8));
+	}
+};
+
+/**
+ * Counters written by the Dragon message thread and readable from any thread.
+ * Everything is a relaxed atomic, so readers see recent values but not necessarily a consistent set.
+ */
+struct FLiveLinkDragonMetrics
+{
+	TLiveLinkDragonSeqLock<FLiveLinkDragonStatusSnapshot> Status;
+	TLiveLinkDragonSeqLock<FLiveLinkDragonDeviceSnapshot> Device;
+
+	//~ Begin receive path
+	std::atomic<uint64> PacketsReceived{ 0 };
+	std::atomic<uint64> BytesReceived{ 0 };
+	std::atomic<uint64> SocketErrors{ 0 };
+	std::atomic<uint64> ParseErrors{ 0 };
+
+	std::atomic<uint64> EventsReceived[static_cast<int32>(ELiveLinkDragonEventType::Num)] = {};
+
+	// Time spent turning a datagram into JSON
+	FLiveLinkDragonLatencyHistogram ParseLatency;
+
+	// Whether the socket hands us kernel arrival timestamps, otherwise arrival is when RecvFrom returned
+	std::atomic<bool> bKernelTimestamps{ false };
+
+	// Kernel arrival to RecvFrom returning, split by how the packet was picked up
+	FLiveLinkDragonLatencyHistogram BlockingReceiveLatency;
+	FLiveLinkDragonLatencyHistogram BusyPollReceiveLatency;
+
+	// Arrival to PushSubjectFrameData_AnyThread, i.e. everything we add on our side
+	FLiveLinkDragonLatencyHistogram ArrivalToPushLatency;
+
+	// Receive buffers are pooled, new ones are only allocated while every pooled one is in use
+	std::atomic<uint32> ReceiveBuffersAllocated{ 0 };
+	std::atomic<int32> ReceiveBuffersInUseHighWater{ 0 };
+	std::atomic<int32> LargestDatagram{ 0 };
+	//~ End receive path
+
+	//~ Begin network health
+	// Lost is a best guess, a packet counted lost that turns up later moves over to reordered
+	std::atomic<uint64> PacketsLost{ 0 };
+	std::atomic<uint64> PacketsReordered{ 0 };
+	std::atomic<uint64> PacketsDuplicated{ 0 };
+
+	// Out-of-order state updates that were thrown away instead of overwriting newer state
+	std::atomic<uint64> StaleUpdatesDropped{ 0 };
+
+	// Datagrams from senders outside the allow-list, dropped before parsing
+	std::atomic<uint64> PacketsFiltered{ 0 };
+
+	// Datagrams larger than the receive buffer, dropped rather than parsed cut off. Only seen with kernel timestamps.
+	std::atomic<uint64> PacketsTruncated{ 0 };
+	//~ End network health
+
+	//~ Begin backlog
+	// State updates superseded by a newer one for the same subject before we got to them, by event type
+	std::atomic<uint64> EventsCoalesced[static_cast<int32>(ELiveLinkDragonEventType::Num)] = {};
+
+	// Most events that were waiting to be handled at once
+	std::atomic<int32> BacklogHighWater{ 0 };
+	//~ End backlog
+
+	//~ Begin handler tasks
+	// Slow handlers thrown away because too many were already waiting on the task system
+	std::atomic<uint64> HandlerTasksDropped{ 0 };
+
+	// Most slow handlers waiting at once
+	std::atomic<int32> HandlerTasksHighWater{ 0 };
+	//~ End handler tasks
+
+	//~ Begin session
+	std::atomic<uint64> Rebinds{ 0 };
+	std::atomic<uint64> PeerRestarts{ 0 };
+
+	// From a socket failure, or the last packet before a Dragonframe restart, back to an active session
+	FLiveLinkDragonLatencyHistogram TimeToRecover;
+	//~ End session
+
+	//~ Begin clock sync
+	// True once a bridge has answered pings, before that only the one-way delay is known
+	std::atomic<bool> bClockSynced{ false };
+	std::atomic<double> ClockOffsetMicroseconds{ 0.0 };	// remote minus local
+	std::atomic<double> ClockDriftPpm{ 0.0 };
+	std::atomic<double> OneWayDelayMicroseconds{ 0.0 };
+	//~ End clock sync
+
+	//~ Begin busy-poll
+	// Packets that were picked up by a blocking wait vs. while spinning after a previous packet
+	std::atomic<uint64> BlockingPackets{ 0 };
+	std::atomic<uint64> BusyPollPackets{ 0 };
+
+	// Total time spent spinning, not counting the time spent handling the packets caught while spinning
+	std::atomic<uint64> BusyPollSpinMicroseconds{ 0 };
+
+	// Published by the message thread once per report interval
+	std::atomic<float> BusyPollCpuFraction{ 0.0f };	// share of one core burnt spinning
+	std::atomic<float> BusyPollHitFraction{ 0.0f };	// share of packets that arrived while spinning
+	//~ End busy-poll
+};
+
+/**
+ * Metrics of every running Dragon source, for diagnostics UI.
+ * Sources come and go rarely, so a lock is fine here. Reading the metrics themselves never takes it.
+ */
+class LIVELINKDRAGON_API FLiveLinkDragonMetricsRegistry
+{
+public:
+
+	struct FEntry
+	{
+		FGuid SourceGuid;
+		FName SubjectName;
+		TSharedRef<const FLiveLinkDragonMetrics, ESPMode::ThreadSafe> Metrics;
+	};
+
+	static void Register(const FGuid& SourceGuid, FName SubjectName, TSharedRef<const FLiveLinkDragonMetrics, ESPMode::ThreadSafe> Metrics);
+	static void Unregister(const FGuid& SourceGuid);
+
+	static TArray<FEntry> GetEntries();
+
+	/** Bumped whenever a source registers or unregisters, so UI knows when to rebuild */
+	static uint32 GetVersion();
+};
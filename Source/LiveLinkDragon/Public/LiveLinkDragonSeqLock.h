@@ -0,0 +1,84 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+#include <type_traits>
+
+/**
+ * Single-writer, many-reader sequence lock for small trivially copyable values.
+ *
+ * The writer never waits. Readers copy the value out and retry if a write raced them, so they never
+ * block the writer and never see a torn value. The payload is stored as atomic words so the racing
+ * copy is well defined.
+ */
+template<typename T>
+class TLiveLinkDragonSeqLock
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Sequence locked values are copied as raw bytes");
+
+public:
+
+	TLiveLinkDragonSeqLock()
+	{
+		Write(T());
+	}
+
+	/** Only ever call this from one thread */
+	void Write(const T& InValue)
+	{
+		uint64 Buffer[NumWords] = { 0 };
+		FMemory::Memcpy(Buffer, &InValue, sizeof(T));
+
+		const uint32 Sequence = SequenceNumber.load(std::memory_order_relaxed);
+		SequenceNumber.store(Sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (int32 Word = 0; Word < NumWords; ++Word)
+		{
+			Words[Word].store(Buffer[Word], std::memory_order_relaxed);
+		}
+
+		SequenceNumber.store(Sequence + 2, std::memory_order_release);
+	}
+
+	T Read() const
+	{
+		uint64 Buffer[NumWords];
+		uint32 Before = 0;
+		uint32 After = 0;
+
+		do
+		{
+			Before = SequenceNumber.load(std::memory_order_acquire);
+
+			for (int32 Word = 0; Word < NumWords; ++Word)
+			{
+				Buffer[Word] = Words[Word].load(std::memory_order_relaxed);
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			After = SequenceNumber.load(std::memory_order_relaxed);
+		}
+		while ((Before & 1) != 0 || Before != After);
+
+		T Result;
+		FMemory::Memcpy(&Result, Buffer, sizeof(T));
+		return Result;
+	}
+
+	/** Bumped on every write, handy for readers that only want to do work when something changed */
+	uint32 GetVersion() const
+	{
+		return SequenceNumber.load(std::memory_order_acquire) >> 1;
+	}
+
+private:
+
+	static constexpr int32 NumWords = (sizeof(T) + sizeof(uint64) - 1) / sizeof(uint64);
+
+	std::atomic<uint32> SequenceNumber{ 0 };
+	std::atomic<uint64> Words[NumWords];
+};
@@ -0,0 +1,49 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "UObject/ObjectMacros.h"
+#include "UObject/SoftObjectPath.h"
+
+#include "LiveLinkSourceSettings.h"
+
+#include "LiveLinkDragonSourceSettings.generated.h"
+
+UCLASS()
+class LIVELINKDRAGON_API ULiveLinkDragonSourceSettings : public ULiveLinkSourceSettings
+{
+public:
+	GENERATED_BODY()
+
+	/** Key each capture into a Level Sequence as it happens, one stepped key per channel per frame */
+	UPROPERTY(EditAnywhere, Category = "Bake")
+	bool bBakeCaptures = false;
+
+	/** The Level Sequence to bake into. The camera is bound by subject name and created on first capture. */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (EditCondition = "bBakeCaptures", AllowedClasses = "/Script/LevelSequence.LevelSequence"))
+	FSoftObjectPath BakeSequence;
+
+	/** Write a CG plate for every capture, named after Dragonframe's image, for compositing */
+	UPROPERTY(EditAnywhere, Category = "Plates")
+	bool bExportPlates = false;
+
+	/** The render target to write out, e.g. a scene capture's. Required, no plates are written without one. */
+	UPROPERTY(EditAnywhere, Category = "Plates", meta = (EditCondition = "bExportPlates", AllowedClasses = "/Script/Engine.TextureRenderTarget2D"))
+	FSoftObjectPath PlateRenderTarget;
+
+	/** Where the plates go, next to Dragonframe's images if empty. Only works when this machine can see Dragonframe's image folder. */
+	UPROPERTY(EditAnywhere, Category = "Plates", meta = (EditCondition = "bExportPlates"))
+	FString PlateDirectory;
+
+	/** Appended to the Dragonframe image name, so plates never overwrite the stills. Plates are skipped if it is empty. */
+	UPROPERTY(EditAnywhere, Category = "Plates", meta = (EditCondition = "bExportPlates"))
+	FString PlateSuffix = TEXT("_CG");
+
+	/** Load each captured still into a texture, for overlays comparing the CG with the last few captures. Needs Dragonframe's image folder visible from here. */
+	UPROPERTY(EditAnywhere, Category = "Stills")
+	bool bImportStills = false;
+
+	/** Stills are shrunk until their longest edge is no more than this */
+	UPROPERTY(EditAnywhere, Category = "Stills", meta = (EditCondition = "bImportStills", ClampMin = "64", ClampMax = "4096"))
+	int32 MaxStillSize = 1024;
+};
\ No newline at end of file
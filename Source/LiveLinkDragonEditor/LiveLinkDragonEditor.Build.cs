@@ -17,12 +17,24 @@ public class LiveLinkDragonEditor : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
+				"CinematicCamera",
 				"Core",
 				"CoreUObject",
+				"Engine",
+				"Json",
+				"LevelSequence",
+				"LiveLink",
 				"LiveLinkDragon",
+				"LiveLinkInterface",
+				"MovieScene",
+				"MovieSceneTracks",
+				"Networking",
+				"Projects",
 				"PropertyEditor",
 				"Slate",
-				"SlateCore"
+				"SlateCore",
+				"Sockets",
+				"WorkspaceMenuStructure"
 			});
 	}
 }
@@ -0,0 +1,397 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonBenchmark.h"
+
+#include "LiveLinkDragonConnectionSettings.h"
+#include "LiveLinkDragonFactory.h"
+#include "LiveLinkDragonMetrics.h"
+
+#include "Async/TaskGraphInterfaces.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Dom/JsonObject.h"
+#include "ILiveLinkSource.h"
+#include "Interfaces/IPluginManager.h"
+#include "LiveLinkClient.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeExit.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+
+#include <atomic>
+
+namespace LiveLinkDragonBenchmark
+{
+	static const TCHAR* SubjectName = TEXT("DragonBenchmark");
+
+	// Frames of the warm-up session, the paced and burst sessions number on from there
+	static constexpr int32 WarmUpCount = 100;
+
+	/**
+	 * Stands in for LiveLink. Only ever handed to the benchmark's own source, never registered as the client.
+	 *
+	 * The real client is only derived from for the rest of its interface, which differs between engine versions.
+	 * Pushes never reach it: state frames are timed against when their frame was sent and everything is dropped.
+	 */
+	class FFakeLiveLinkClient : public FLiveLinkClient
+	{
+	public:
+
+		FFakeLiveLinkClient(FName InTimedSubjectName, int32 InNumFrames)
+			: TimedSubjectName(InTimedSubjectName)
+			, NumFrames(InNumFrames)
+			, SendTimes(MakeUnique<std::atomic<double>[]>(InNumFrames))
+		{
+		}
+
+		/** Sender side, just before the frame's position goes out */
+		void MarkSent(int32 Frame)
+		{
+			if (Frame >= 0 && Frame < NumFrames)
+			{
+				SendTimes[Frame].store(FPlatformTime::Seconds(), std::memory_order_release);
+			}
+		}
+
+		//~ Begin ILiveLinkClient interface
+		virtual void PushSubjectStaticData_AnyThread(const FLiveLinkSubjectKey& SubjectKey, TSubclassOf<ULiveLinkRole> Role, FLiveLinkStaticDataStruct&& StaticData) override
+		{
+		}
+
+		virtual void PushSubjectFrameData_AnyThread(const FLiveLinkSubjectKey& SubjectKey, FLiveLinkFrameDataStruct&& FrameData) override
+		{
+			const double PushTime = FPlatformTime::Seconds();
+
+			// The state subject is pushed last for a packet, and its first property is the frame
+			const FLiveLinkBaseFrameData* BaseData = FrameData.GetBaseData();
+			if (SubjectKey.SubjectName.Name != TimedSubjectName || BaseData == nullptr || BaseData->PropertyValues.Num() == 0)
+			{
+				return;
+			}
+
+			const int32 Frame = FMath::RoundToInt(BaseData->PropertyValues[0]);
+			const double SendTime = Frame >= 0 && Frame < NumFrames ? SendTimes[Frame].load(std::memory_order_acquire) : 0.0;
+			if (SendTime > 0.0)
+			{
+				SendToPushLatency.Record(PushTime - SendTime);
+			}
+		}
+		//~ End ILiveLinkClient interface
+
+		FLiveLinkDragonLatencyHistogram SendToPushLatency;
+
+	private:
+
+		FName TimedSubjectName;
+		int32 NumFrames = 0;
+		TUniquePtr<std::atomic<double>[]> SendTimes;
+	};
+
+	/** Stands in for Dragonframe, from inside the same process */
+	class FFakeDragonframe
+	{
+	public:
+
+		~FFakeDragonframe()
+		{
+			if (Socket)
+			{
+				ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+			}
+		}
+
+		bool Open(uint16 TargetPort)
+		{
+			const FIPv4Address Loopback(127, 0, 0, 1);
+
+			Socket = FUdpSocketBuilder(TEXT("Dragon Benchmark Peer"))
+				.BoundToAddress(Loopback)
+				.BoundToPort(0)
+				.WithReceiveBufferSize(64 * 1024)
+				.WithSendBufferSize(1024 * 1024)
+				.Build();
+
+			Target = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+			Target->SetIp(Loopback.Value);
+			Target->SetPort(TargetPort);
+			return Socket != nullptr;
+		}
+
+		void Send(const FString& Json)
+		{
+			FTCHARToUTF8 Utf8(*Json);
+			int32 Sent = 0;
+			Socket->SendTo(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length(), Sent, *Target);
+		}
+
+		/** Says hello until the source answers, it may not have bound its socket yet */
+		bool Handshake(double TimeoutSeconds)
+		{
+			const double Deadline = FPlatformTime::Seconds() + TimeoutSeconds;
+			double NextHelloTime = 0.0;
+
+			TSharedRef<FInternetAddr> Sender = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+			uint8 Buffer[2048];
+
+			while (FPlatformTime::Seconds() < Deadline)
+			{
+				if (FPlatformTime::Seconds() >= NextHelloTime)
+				{
+					Send(TEXT("{\"event\":\"hello\",\"minVersion\":1.0,\"maxVersion\":1.0}"));
+					NextHelloTime = FPlatformTime::Seconds() + 0.5;
+				}
+
+				int32 Read = 0;
+				if (Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(50))
+					&& Socket->RecvFrom(Buffer, sizeof(Buffer), Read, *Sender) && Read > 0)
+				{
+					const FUTF8ToTCHAR Reply(reinterpret_cast<const ANSICHAR*>(Buffer), Read);
+					if (FString(Reply.Length(), Reply.Get()).Contains(TEXT("\"hello\"")))
+					{
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+
+	private:
+
+		FSocket* Socket = nullptr;
+		TSharedPtr<FInternetAddr> Target;
+	};
+
+	/** What Dragonframe sends while shooting: a position per frame, and a shoot and capture every so often */
+	int32 SendSession(FFakeDragonframe& Peer, FFakeLiveLinkClient& Client, int32 Count, int32 FirstFrame, double Rate)
+	{
+		static const TCHAR* Scene = TEXT("\"production\":\"Benchmark\",\"scene\":\"SC01\",\"take\":\"TK01\"");
+		static constexpr int32 CaptureEvery = 25;
+
+		const double StartTime = FPlatformTime::Seconds();
+		int32 Sent = 0;
+
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			// Sleep rather than spin, so the sender doesn't take a core away from the source's thread
+			if (Rate > 0.0)
+			{
+				const double Wait = StartTime + Index / Rate - FPlatformTime::Seconds();
+				if (Wait > 0.0)
+				{
+					FPlatformProcess::SleepNoStats(static_cast<float>(Wait));
+				}
+			}
+
+			const int32 Frame = FirstFrame + Index;
+			Client.MarkSent(Frame);
+			Peer.Send(FString::Printf(TEXT("{\"event\":\"position\",%s,\"frame\":%d,\"mocoFrame\":%d,\"exposure\":1,\"exposureName\":\"X1\",\"stereoIndex\":0}"),
+				Scene, Frame, Frame));
+			++Sent;
+
+			if (Index % CaptureEvery == CaptureEvery - 1)
+			{
+				Peer.Send(FString::Printf(TEXT("{\"event\":\"shoot\",%s,\"frame\":%d,\"exposure\":1,\"exposureName\":\"X1\",\"stereoIndex\":0}"),
+					Scene, Frame));
+				Peer.Send(FString::Printf(TEXT("{\"event\":\"captureComplete\",%s,\"frame\":%d,\"exposure\":1,\"exposureName\":\"X1\",\"stereoIndex\":0,\"imageFileName\":\"Benchmark_%05d.jpg\"}"),
+					Scene, Frame, Frame));
+				Sent += 2;
+			}
+		}
+		return Sent;
+	}
+
+	uint64 GetEventsReceived(const FLiveLinkDragonMetrics& Metrics)
+	{
+		uint64 Events = 0;
+		for (const std::atomic<uint64>& Counter : Metrics.EventsReceived)
+		{
+			Events += Counter.load(std::memory_order_relaxed);
+		}
+		return Events;
+	}
+
+	/**
+	 * Waits for the source to have handled everything sent so far, or for it to stop making progress, as lost
+	 * datagrams never turn up. Returns when the last event was seen, so the wait for lost ones isn't counted.
+	 */
+	double WaitForEvents(const FLiveLinkDragonMetrics& Metrics, uint64 Expected, double StallSeconds)
+	{
+		uint64 Events = GetEventsReceived(Metrics);
+		double LastEventTime = FPlatformTime::Seconds();
+		while (Events < Expected && FPlatformTime::Seconds() - LastEventTime < StallSeconds)
+		{
+			// Captures hop to the game thread, keep that moving like the editor would
+			FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+			FPlatformProcess::SleepNoStats(0.001f);
+
+			const uint64 NewEvents = GetEventsReceived(Metrics);
+			if (NewEvents != Events)
+			{
+				Events = NewEvents;
+				LastEventTime = FPlatformTime::Seconds();
+			}
+		}
+		return LastEventTime;
+	}
+
+	/** The message thread's own CPU time, from a status published no earlier than NotBefore */
+	double GetThreadCPUSeconds(const FLiveLinkDragonMetrics& Metrics, double NotBefore)
+	{
+		// The thread publishes at least once a session tick even when idle
+		const double Deadline = FPlatformTime::Seconds() + 3.0;
+		FLiveLinkDragonStatusSnapshot Status = Metrics.Status.Read();
+		while (Status.PublishTime < NotBefore && FPlatformTime::Seconds() < Deadline)
+		{
+			FPlatformProcess::SleepNoStats(0.01f);
+			Status = Metrics.Status.Read();
+		}
+		return Status.ThreadCPUSeconds;
+	}
+
+	TSharedRef<FJsonObject> FResults::ToJson() const
+	{
+		TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+		Json->SetNumberField(TEXT("SendToPushP50Microseconds"), SendToPushP50Microseconds);
+		Json->SetNumberField(TEXT("SendToPushP99Microseconds"), SendToPushP99Microseconds);
+		Json->SetNumberField(TEXT("CPUMicrosecondsPerPacket"), CPUMicrosecondsPerPacket);
+		Json->SetNumberField(TEXT("PacketsPerSecond"), PacketsPerSecond);
+		return Json;
+	}
+
+	bool FResults::FromJson(const TSharedPtr<FJsonObject>& Json, FResults& OutResults)
+	{
+		return Json.IsValid()
+			&& Json->TryGetNumberField(TEXT("SendToPushP50Microseconds"), OutResults.SendToPushP50Microseconds)
+			&& Json->TryGetNumberField(TEXT("SendToPushP99Microseconds"), OutResults.SendToPushP99Microseconds)
+			&& Json->TryGetNumberField(TEXT("CPUMicrosecondsPerPacket"), OutResults.CPUMicrosecondsPerPacket)
+			&& Json->TryGetNumberField(TEXT("PacketsPerSecond"), OutResults.PacketsPerSecond);
+	}
+
+	bool Run(const FOptions& Options, FResults& OutResults, FString& OutError)
+	{
+		FLiveLinkDragonConnectionSettings Settings;
+		Settings.IPAddress = TEXT("127.0.0.1");
+		Settings.Port = Options.Port;
+		Settings.SubjectName = SubjectName;
+		Settings.bBusyPoll = Options.bBusyPoll;
+		Settings.bPublishStateAndLens = true;
+
+		// Declared first so it outlives the source, whose thread pushes into it until shutdown
+		FFakeLiveLinkClient Client(*(FString(SubjectName) + TEXT("_State")), WarmUpCount + Options.Count * 2);
+
+		const TSharedPtr<ILiveLinkSource> Source = GetDefault<ULiveLinkDragonSourceFactory>()->CreateSource(ULiveLinkDragonSourceFactory::CreateConnectionString(Settings));
+		if (!Source.IsValid())
+		{
+			OutError = TEXT("Could not create a Dragon source");
+			return false;
+		}
+
+		const FGuid SourceGuid = FGuid::NewGuid();
+		Source->ReceiveClient(&Client, SourceGuid);
+		ON_SCOPE_EXIT
+		{
+			Source->RequestSourceShutdown();
+		};
+
+		TSharedPtr<const FLiveLinkDragonMetrics, ESPMode::ThreadSafe> Metrics;
+		for (const FLiveLinkDragonMetricsRegistry::FEntry& Entry : FLiveLinkDragonMetricsRegistry::GetEntries())
+		{
+			if (Entry.SourceGuid == SourceGuid)
+			{
+				Metrics = Entry.Metrics;
+			}
+		}
+
+		FFakeDragonframe Peer;
+		if (!Metrics.IsValid() || !Peer.Open(static_cast<uint16>(Options.Port)) || !Peer.Handshake(10.0))
+		{
+			OutError = FString::Printf(TEXT("Could not handshake with the Dragon source on port %d"), Options.Port);
+			return false;
+		}
+
+		// Warm up, so first-use allocations and the handshake round trip stay out of the numbers
+		const uint64 WarmUpStartEvents = GetEventsReceived(*Metrics);
+		WaitForEvents(*Metrics, WarmUpStartEvents + SendSession(Peer, Client, WarmUpCount, 0, Options.Rate), 1.0);
+
+		// Paced, for latency and CPU
+		uint64 LatencyBucketsBefore[FLiveLinkDragonLatencyHistogram::NumBuckets];
+		Client.SendToPushLatency.GetBuckets(LatencyBucketsBefore);
+		const double PacedCPUSecondsBefore = GetThreadCPUSeconds(*Metrics, FPlatformTime::Seconds());
+		const uint64 PacedStartEvents = GetEventsReceived(*Metrics);
+
+		const int32 PacedSent = SendSession(Peer, Client, Options.Count, WarmUpCount, Options.Rate);
+		const double PacedEndTime = WaitForEvents(*Metrics, PacedStartEvents + PacedSent, 1.0);
+		const uint64 PacedEvents = GetEventsReceived(*Metrics) - PacedStartEvents;
+		const double PacedCPUSeconds = GetThreadCPUSeconds(*Metrics, PacedEndTime) - PacedCPUSecondsBefore;
+
+		uint64 LatencyBuckets[FLiveLinkDragonLatencyHistogram::NumBuckets];
+		Client.SendToPushLatency.GetBuckets(LatencyBuckets);
+		for (int32 Bucket = 0; Bucket < FLiveLinkDragonLatencyHistogram::NumBuckets; ++Bucket)
+		{
+			LatencyBuckets[Bucket] -= LatencyBucketsBefore[Bucket];
+		}
+
+		// Flat out, for throughput
+		const double BurstStartTime = FPlatformTime::Seconds();
+		const uint64 BurstStartEvents = GetEventsReceived(*Metrics);
+		const int32 BurstSent = SendSession(Peer, Client, Options.Count, WarmUpCount + Options.Count, 0.0);
+		const double BurstEndTime = WaitForEvents(*Metrics, BurstStartEvents + BurstSent, 1.0);
+		const uint64 BurstEvents = GetEventsReceived(*Metrics) - BurstStartEvents;
+
+		OutResults.SendToPushP50Microseconds = FLiveLinkDragonLatencyHistogram::GetPercentile(LatencyBuckets, 0.5) * 1.0e6;
+		OutResults.SendToPushP99Microseconds = FLiveLinkDragonLatencyHistogram::GetPercentile(LatencyBuckets, 0.99) * 1.0e6;
+		OutResults.CPUMicrosecondsPerPacket = PacedEvents > 0 ? PacedCPUSeconds * 1.0e6 / PacedEvents : 0.0;
+		OutResults.PacketsPerSecond = BurstEndTime > BurstStartTime ? BurstEvents / (BurstEndTime - BurstStartTime) : 0.0;
+		OutResults.PacedPacketsLost = PacedSent - static_cast<int32>(FMath::Min<uint64>(PacedEvents, PacedSent));
+		OutResults.BurstPacketsLost = BurstSent - static_cast<int32>(FMath::Min<uint64>(BurstEvents, BurstSent));
+		return true;
+	}
+
+	FString GetBaselinePath()
+	{
+		const TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("LiveLinkDragon"));
+		return Plugin.IsValid() ? FPaths::Combine(Plugin->GetBaseDir(), TEXT("Resources"), TEXT("BenchmarkBaseline.json")) : FString();
+	}
+
+	bool LoadBaseline(const FString& Path, FResults& OutBaseline)
+	{
+		FString BaselineText;
+		TSharedPtr<FJsonObject> BaselineJson;
+		return FFileHelper::LoadFileToString(BaselineText, *Path)
+			&& FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineText), BaselineJson)
+			&& FResults::FromJson(BaselineJson, OutBaseline);
+	}
+
+	bool SaveBaseline(const FString& Path, const FResults& Results)
+	{
+		FString ResultsText;
+		return FJsonSerializer::Serialize(Results.ToJson(), TJsonWriterFactory<>::Create(&ResultsText))
+			&& FFileHelper::SaveStringToFile(ResultsText, *Path);
+	}
+
+	TArray<FString> FindRegressions(const FResults& Results, const FResults& Baseline, double Tolerance)
+	{
+		TArray<FString> Regressions;
+
+		// Nothing should go missing on loopback at the paced rate, a burst overrunning the socket buffer may
+		if (Results.PacedPacketsLost > 0)
+		{
+			Regressions.Add(FString::Printf(TEXT("%d packets lost at the paced rate"), Results.PacedPacketsLost));
+		}
+
+		auto Check = [&Regressions, Tolerance](const TCHAR* Name, double Value, double BaselineValue, bool bHigherIsWorse)
+		{
+			const bool bFailed = bHigherIsWorse ? Value > BaselineValue * Tolerance : Value * Tolerance < BaselineValue;
+			if (bFailed)
+			{
+				Regressions.Add(FString::Printf(TEXT("%s regressed: %.1f against a baseline of %.1f"), Name, Value, BaselineValue));
+			}
+		};
+		Check(TEXT("Send to push p99"), Results.SendToPushP99Microseconds, Baseline.SendToPushP99Microseconds, true);
+		Check(TEXT("CPU per packet"), Results.CPUMicrosecondsPerPacket, Baseline.CPUMicrosecondsPerPacket, true);
+		Check(TEXT("Throughput"), Results.PacketsPerSecond, Baseline.PacketsPerSecond, false);
+		return Regressions;
+	}
+}
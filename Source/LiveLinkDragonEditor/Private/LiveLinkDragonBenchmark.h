@@ -0,0 +1,62 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FJsonObject;
+
+/**
+ * Loopback latency benchmark, shared by the benchmark commandlet and automation test.
+ *
+ * A fake Dragonframe on 127.0.0.1 handshakes with a Dragon source that is handed a fake LiveLink client, plays a
+ * scripted session at it, first paced for latency and then flat out for throughput. Nothing is added to the
+ * editor's LiveLink client, so whatever else is connected there doesn't show up in the numbers.
+ *
+ * Latency is from the fake Dragonframe sending a frame's position to the source pushing that frame's state
+ * subject, the last push for it. The percentiles come out of power-of-two buckets, so they only move in doublings.
+ * CPU per packet is the message thread's own CPU time over the paced run, divided by the packets it handled.
+ * Work handed to the game thread or tasks, like capture handlers, isn't in it. Throughput is the packets handled
+ * over the time to the last one, datagrams the burst loses are counted apart rather than waited for.
+ */
+namespace LiveLinkDragonBenchmark
+{
+	// How far past the baseline a figure may get before it counts as a regression, as a ratio
+	static constexpr double DefaultTolerance = 1.5;
+
+	struct FOptions
+	{
+		int32 Count = 2000;
+		double Rate = 500.0;
+		int32 Port = 55600;
+		bool bBusyPoll = false;
+	};
+
+	struct FResults
+	{
+		double SendToPushP50Microseconds = 0.0;
+		double SendToPushP99Microseconds = 0.0;
+		double CPUMicrosecondsPerPacket = 0.0;
+		double PacketsPerSecond = 0.0;
+
+		// Not part of the baseline. Any loss at the paced rate fails the run.
+		int32 PacedPacketsLost = 0;
+		int32 BurstPacketsLost = 0;
+
+		TSharedRef<FJsonObject> ToJson() const;
+		static bool FromJson(const TSharedPtr<FJsonObject>& Json, FResults& OutResults);
+	};
+
+	/** Returns false with a reason if the source couldn't be brought up or never answered */
+	bool Run(const FOptions& Options, FResults& OutResults, FString& OutError);
+
+	/** The baseline checked in with the plugin */
+	FString GetBaselinePath();
+
+	/** False if the baseline is missing or unreadable, which callers treat as a failure */
+	bool LoadBaseline(const FString& Path, FResults& OutBaseline);
+	bool SaveBaseline(const FString& Path, const FResults& Results);
+
+	/** One line per figure that got worse than the baseline by more than Tolerance, or per loss, empty if none did */
+	TArray<FString> FindRegressions(const FResults& Results, const FResults& Baseline, double Tolerance);
+}
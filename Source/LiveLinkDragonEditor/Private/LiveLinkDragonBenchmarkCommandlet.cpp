@@ -0,0 +1,68 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonBenchmarkCommandlet.h"
+
+#include "LiveLinkDragonBenchmark.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLiveLinkDragonBenchmark, Log, All);
+
+ULiveLinkDragonBenchmarkCommandlet::ULiveLinkDragonBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 ULiveLinkDragonBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace LiveLinkDragonBenchmark;
+
+	FOptions Options;
+	double Tolerance = DefaultTolerance;
+	FString BaselinePath = GetBaselinePath();
+	FParse::Value(*Params, TEXT("Count="), Options.Count);
+	FParse::Value(*Params, TEXT("Rate="), Options.Rate);
+	FParse::Value(*Params, TEXT("Port="), Options.Port);
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+	FParse::Value(*Params, TEXT("Baseline="), BaselinePath);
+	Options.bBusyPoll = FParse::Param(*Params, TEXT("BusyPoll"));
+	const bool bUpdateBaseline = FParse::Param(*Params, TEXT("UpdateBaseline"));
+
+	FResults Results;
+	FString Error;
+	if (!Run(Options, Results, Error))
+	{
+		UE_LOG(LogLiveLinkDragonBenchmark, Error, TEXT("%s"), *Error);
+		return 2;
+	}
+
+	UE_LOG(LogLiveLinkDragonBenchmark, Display, TEXT("Send to push p50/p99 %.0f / %.0f us, %.1f us CPU per packet, %.0f packets/s flat out, %d lost paced, %d lost flat out"),
+		Results.SendToPushP50Microseconds, Results.SendToPushP99Microseconds, Results.CPUMicrosecondsPerPacket, Results.PacketsPerSecond, Results.PacedPacketsLost, Results.BurstPacketsLost);
+
+	if (bUpdateBaseline)
+	{
+		if (!SaveBaseline(BaselinePath, Results))
+		{
+			UE_LOG(LogLiveLinkDragonBenchmark, Error, TEXT("Could not write the baseline to %s"), *BaselinePath);
+			return 2;
+		}
+		UE_LOG(LogLiveLinkDragonBenchmark, Display, TEXT("Baseline written to %s"), *BaselinePath);
+		return 0;
+	}
+
+	FResults Baseline;
+	if (!LoadBaseline(BaselinePath, Baseline))
+	{
+		UE_LOG(LogLiveLinkDragonBenchmark, Error, TEXT("No readable baseline at %s, run with -UpdateBaseline to store one"), *BaselinePath);
+		return 2;
+	}
+
+	const TArray<FString> Regressions = FindRegressions(Results, Baseline, Tolerance);
+	for (const FString& Regression : Regressions)
+	{
+		UE_LOG(LogLiveLinkDragonBenchmark, Error, TEXT("%s"), *Regression);
+	}
+
+	return Regressions.Num() > 0 ? 1 : 0;
+}
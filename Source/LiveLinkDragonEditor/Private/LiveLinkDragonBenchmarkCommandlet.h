@@ -0,0 +1,32 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "LiveLinkDragonBenchmarkCommandlet.generated.h"
+
+/**
+ * Runs the loopback benchmark (see LiveLinkDragonBenchmark.h) headless, and exits non-zero when it regresses beyond
+ * the baseline or there is no baseline to compare against. -UpdateBaseline stores this machine's run instead:
+ *
+ *   UnrealEditor-Cmd Project.uproject -run=LiveLinkDragonBenchmark -unattended -nullrhi
+ *       [-Count=2000] [-Rate=500] [-Port=55600] [-BusyPoll]
+ *       [-Baseline=File.json] [-UpdateBaseline] [-Tolerance=1.5]
+ *
+ * The baseline defaults to Resources/BenchmarkBaseline.json in the plugin, which the LiveLinkDragon.Benchmark
+ * automation test checks against too.
+ */
+UCLASS()
+class ULiveLinkDragonBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	ULiveLinkDragonBenchmarkCommandlet();
+
+	//~ Begin UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet interface
+};
@@ -3,7 +3,15 @@
 #include "LiveLinkDragonEditorModule.h"
 
 #include "LiveLinkDragonFactory.h"
+#include "LiveLinkDragonSequenceBaker.h"
 #include "LiveLinkDragonSourcePanel.h"
+#include "SLiveLinkDragonDiagnostics.h"
+
+#include "Framework/Application/SlateApplication.h"
+#include "Framework/Docking/TabManager.h"
+#include "Widgets/Docking/SDockTab.h"
+#include "WorkspaceMenuStructure.h"
+#include "WorkspaceMenuStructureModule.h"
 
 #define LOCTEXT_NAMESPACE "LiveLinkDragonEditorModule"
 
@@ -18,11 +26,34 @@ void FLiveLinkDragonEditorModule::StartupModule()
 			.OnSourceCreated(OnSourceCreated);
 	};
 	ULiveLinkDragonSourceFactory::OnBuildCreationPanel.BindLambda(BuildCreationPanel);
+
+	// register the diagnostics tab
+	auto SpawnDiagnosticsTab = [](const FSpawnTabArgs&) -> TSharedRef<SDockTab>
+	{
+		return SNew(SDockTab)
+			.TabRole(ETabRole::NomadTab)
+			[
+				SNew(SLiveLinkDragonDiagnostics)
+			];
+	};
+	FGlobalTabmanager::Get()->RegisterNomadTabSpawner(SLiveLinkDragonDiagnostics::TabName, FOnSpawnTab::CreateLambda(SpawnDiagnosticsTab))
+		.SetDisplayName(LOCTEXT("DiagnosticsTabTitle", "Dragonframe Diagnostics"))
+		.SetTooltipText(LOCTEXT("DiagnosticsTabTooltip", "Live packet rates, latency and network health of running Dragonframe sources."))
+		.SetGroup(WorkspaceMenu::GetMenuStructure().GetDeveloperToolsDebugCategory());
+
+	SequenceBaker = MakeUnique<FLiveLinkDragonSequenceBaker>();
 }
 
 void FLiveLinkDragonEditorModule::ShutdownModule()
 {
+	SequenceBaker.Reset();
+
 	ULiveLinkDragonSourceFactory::OnBuildCreationPanel.Unbind();
+
+	if (FSlateApplication::IsInitialized())
+	{
+		FGlobalTabmanager::Get()->UnregisterNomadTabSpawner(SLiveLinkDragonDiagnostics::TabName);
+	}
 }
 
 #undef LOCTEXT_NAMESPACE
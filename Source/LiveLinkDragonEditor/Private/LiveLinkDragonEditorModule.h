@@ -4,6 +4,8 @@
 
 #include "Modules/ModuleManager.h"
 
+class FLiveLinkDragonSequenceBaker;
+
 class FLiveLinkDragonEditorModule : public IModuleInterface
 {
 public:
@@ -11,4 +13,8 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+private:
+
+	TUniquePtr<FLiveLinkDragonSequenceBaker> SequenceBaker;
 };
\ No newline at end of file
@@ -0,0 +1,225 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonSequenceBaker.h"
+
+#include "LiveLinkDragonCaptureEvents.h"
+#include "LiveLinkDragonSourceSettings.h"
+
+#include "CineCameraActor.h"
+#include "CineCameraComponent.h"
+#include "Features/IModularFeatures.h"
+#include "ILiveLinkClient.h"
+#include "LevelSequence.h"
+#include "MovieScene.h"
+#include "MovieSceneTimeHelpers.h"
+#include "Roles/LiveLinkCameraRole.h"
+#include "Roles/LiveLinkCameraTypes.h"
+#include "Sections/MovieScene3DTransformSection.h"
+#include "Sections/MovieSceneFloatSection.h"
+#include "Tracks/MovieScene3DTransformTrack.h"
+#include "Tracks/MovieSceneFloatTrack.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLiveLinkDragonBake, Log, All);
+
+namespace LiveLinkDragonSequenceBaker
+{
+	/** One constant key at the time, replacing what's there so re-shooting a frame doesn't stack keys */
+	template<typename ChannelType, typename ValueType>
+	void SetSteppedKey(ChannelType& Channel, FFrameNumber Time, ValueType Value)
+	{
+		auto ChannelData = Channel.GetData();
+		const int32 Existing = ChannelData.FindKey(Time);
+		if (Existing != INDEX_NONE)
+		{
+			ChannelData.GetValues()[Existing].Value = Value;
+			ChannelData.GetValues()[Existing].InterpMode = RCIM_Constant;
+		}
+		else
+		{
+			Channel.AddConstantKey(Time, Value);
+		}
+	}
+
+	FGuid FindOrAddPossessable(UMovieScene* MovieScene, const FString& Name, UClass* Class, const FGuid& ParentGuid)
+	{
+		for (int32 Index = 0; Index < MovieScene->GetPossessableCount(); ++Index)
+		{
+			const FMovieScenePossessable& Possessable = MovieScene->GetPossessable(Index);
+			if (Possessable.GetName() == Name && Possessable.GetPossessedObjectClass() == Class && Possessable.GetParent() == ParentGuid)
+			{
+				return Possessable.GetGuid();
+			}
+		}
+
+		const FGuid Guid = MovieScene->AddPossessable(Name, Class);
+		if (ParentGuid.IsValid())
+		{
+			MovieScene->FindPossessable(Guid)->SetParent(ParentGuid, MovieScene);
+		}
+		return Guid;
+	}
+
+	template<typename TrackType, typename SectionType>
+	SectionType* FindOrAddSection(UMovieScene* MovieScene, const FGuid& Binding, FName PropertyName, const FString& PropertyPath)
+	{
+		TrackType* Track = nullptr;
+		for (UMovieSceneTrack* Existing : MovieScene->FindTracks(TrackType::StaticClass(), Binding))
+		{
+			UMovieScenePropertyTrack* PropertyTrack = Cast<UMovieScenePropertyTrack>(Existing);
+			if (PropertyName.IsNone() || (PropertyTrack && PropertyTrack->GetPropertyPath() == FName(*PropertyPath)))
+			{
+				Track = CastChecked<TrackType>(Existing);
+				break;
+			}
+		}
+
+		if (!Track)
+		{
+			Track = MovieScene->AddTrack<TrackType>(Binding);
+			if (!PropertyName.IsNone())
+			{
+				Track->SetPropertyNameAndPath(PropertyName, PropertyPath);
+			}
+		}
+
+		if (Track->GetAllSections().Num() > 0)
+		{
+			return Cast<SectionType>(Track->GetAllSections()[0]);
+		}
+
+		SectionType* Section = CastChecked<SectionType>(Track->CreateNewSection());
+		Section->SetRange(TRange<FFrameNumber>::All());
+		Track->AddSection(*Section);
+		return Section;
+	}
+}
+
+FLiveLinkDragonSequenceBaker::FLiveLinkDragonSequenceBaker()
+{
+	OnCaptureHandle = FLiveLinkDragonCaptureEvents::OnCapture().AddRaw(this, &FLiveLinkDragonSequenceBaker::OnCapture);
+}
+
+FLiveLinkDragonSequenceBaker::~FLiveLinkDragonSequenceBaker()
+{
+	FLiveLinkDragonCaptureEvents::OnCapture().Remove(OnCaptureHandle);
+}
+
+void FLiveLinkDragonSequenceBaker::OnCapture(const FLiveLinkDragonCaptureEvent& Event)
+{
+	using namespace LiveLinkDragonSequenceBaker;
+
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	if (!ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+	{
+		return;
+	}
+	ILiveLinkClient& Client = ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName);
+
+	const ULiveLinkDragonSourceSettings* Settings = Cast<ULiveLinkDragonSourceSettings>(Client.GetSourceSettings(Event.SourceGuid));
+	if (!Settings || !Settings->bBakeCaptures)
+	{
+		return;
+	}
+
+	ULevelSequence* Sequence = Cast<ULevelSequence>(Settings->BakeSequence.TryLoad());
+	if (!Sequence || !Sequence->GetMovieScene())
+	{
+		UE_LOG(LogLiveLinkDragonBake, Warning, TEXT("Baking is enabled for %s but '%s' is not a Level Sequence"), *Event.SubjectName.ToString(), *Settings->BakeSequence.ToString());
+		return;
+	}
+
+	// Each eye of a stereo rig is its own subject and gets its own binding
+	const FName CameraSubjectName = Event.CameraSubjectName.IsNone() ? Event.SubjectName : Event.CameraSubjectName;
+
+	FBakeTarget& Target = Targets.FindOrAdd(CameraSubjectName);
+	if (Target.Sequence.Get() != Sequence || !Target.IsValid())
+	{
+		if (!CreateTarget(Sequence, CameraSubjectName, Target))
+		{
+			return;
+		}
+	}
+
+	// The transform comes from the subject as LiveLink has it, so anything layered on the Dragon data is baked too.
+	// Taken at the capture's own time, frames pushed since it happened must not end up on its key.
+	FTransform Transform = FTransform::Identity;
+	FLiveLinkSubjectFrameData SubjectFrame;
+	if (Client.EvaluateFrameAtWorldTime_AnyThread(CameraSubjectName, Event.WorldTime, ULiveLinkCameraRole::StaticClass(), SubjectFrame))
+	{
+		if (const FLiveLinkCameraFrameData* CameraFrame = SubjectFrame.FrameData.Cast<FLiveLinkCameraFrameData>())
+		{
+			Transform = CameraFrame->Transform;
+		}
+	}
+
+	UMovieScene* MovieScene = Sequence->GetMovieScene();
+	const FFrameNumber KeyTime = FFrameRate::TransformTime(FFrameTime(Event.Frame), MovieScene->GetDisplayRate(), MovieScene->GetTickResolution()).FloorToFrame();
+	const FFrameNumber NextFrameTime = FFrameRate::TransformTime(FFrameTime(Event.Frame + 1), MovieScene->GetDisplayRate(), MovieScene->GetTickResolution()).FloorToFrame();
+
+	Sequence->Modify();
+
+	UMovieScene3DTransformSection* TransformSection = Target.Transform.Get();
+	TransformSection->Modify();
+	TArrayView<FMovieSceneDoubleChannel*> TransformChannels = TransformSection->GetChannelProxy().GetChannels<FMovieSceneDoubleChannel>();
+	if (TransformChannels.Num() >= 9)
+	{
+		const FVector Location = Transform.GetLocation();
+		const FRotator Rotation = Transform.Rotator();
+		const FVector Scale = Transform.GetScale3D();
+
+		const double Values[9] = { Location.X, Location.Y, Location.Z, Rotation.Roll, Rotation.Pitch, Rotation.Yaw, Scale.X, Scale.Y, Scale.Z };
+		for (int32 Channel = 0; Channel < 9; ++Channel)
+		{
+			SetSteppedKey(*TransformChannels[Channel], KeyTime, Values[Channel]);
+		}
+	}
+
+	auto KeyFloat = [KeyTime](UMovieSceneFloatSection* Section, float Value)
+	{
+		Section->Modify();
+		if (FMovieSceneFloatChannel* Channel = Section->GetChannelProxy().GetChannel<FMovieSceneFloatChannel>(0))
+		{
+			SetSteppedKey(*Channel, KeyTime, Value);
+		}
+	};
+	KeyFloat(Target.FocalLength.Get(), Event.FocalLength);
+	KeyFloat(Target.FocusDistance.Get(), Event.FocusDistance);
+	KeyFloat(Target.Aperture.Get(), Event.Aperture);
+
+	// Grow the playback range to cover the frame just shot
+	const TRange<FFrameNumber> PlaybackRange = MovieScene->GetPlaybackRange();
+	const FFrameNumber Start = UE::MovieScene::DiscreteInclusiveLower(PlaybackRange);
+	const FFrameNumber End = UE::MovieScene::DiscreteExclusiveUpper(PlaybackRange);
+	if (KeyTime < Start || NextFrameTime > End)
+	{
+		MovieScene->Modify();
+		MovieScene->SetPlaybackRange(TRange<FFrameNumber>(FMath::Min(Start, KeyTime), FMath::Max(End, NextFrameTime)));
+	}
+}
+
+bool FLiveLinkDragonSequenceBaker::CreateTarget(ULevelSequence* Sequence, FName SubjectName, FBakeTarget& OutTarget) const
+{
+	using namespace LiveLinkDragonSequenceBaker;
+
+	UMovieScene* MovieScene = Sequence->GetMovieScene();
+	MovieScene->Modify();
+
+	// Possessables, so the bake can be bound to whichever camera actor the shot uses
+	const FGuid CameraBinding = FindOrAddPossessable(MovieScene, SubjectName.ToString(), ACineCameraActor::StaticClass(), FGuid());
+	const FGuid ComponentBinding = FindOrAddPossessable(MovieScene, TEXT("CameraComponent"), UCineCameraComponent::StaticClass(), CameraBinding);
+
+	OutTarget.Sequence = Sequence;
+	OutTarget.Transform = FindOrAddSection<UMovieScene3DTransformTrack, UMovieScene3DTransformSection>(MovieScene, CameraBinding, NAME_None, FString());
+	OutTarget.FocalLength = FindOrAddSection<UMovieSceneFloatTrack, UMovieSceneFloatSection>(MovieScene, ComponentBinding, GET_MEMBER_NAME_CHECKED(UCineCameraComponent, CurrentFocalLength), TEXT("CurrentFocalLength"));
+	OutTarget.FocusDistance = FindOrAddSection<UMovieSceneFloatTrack, UMovieSceneFloatSection>(MovieScene, ComponentBinding, GET_MEMBER_NAME_CHECKED(FCameraFocusSettings, ManualFocusDistance), TEXT("FocusSettings.ManualFocusDistance"));
+	OutTarget.Aperture = FindOrAddSection<UMovieSceneFloatTrack, UMovieSceneFloatSection>(MovieScene, ComponentBinding, GET_MEMBER_NAME_CHECKED(UCineCameraComponent, CurrentAperture), TEXT("CurrentAperture"));
+
+	if (!OutTarget.IsValid())
+	{
+		UE_LOG(LogLiveLinkDragonBake, Warning, TEXT("Could not set up tracks for %s in %s"), *SubjectName.ToString(), *Sequence->GetPathName());
+		return false;
+	}
+
+	UE_LOG(LogLiveLinkDragonBake, Log, TEXT("Baking captures of %s into %s"), *SubjectName.ToString(), *Sequence->GetPathName());
+	return true;
+}
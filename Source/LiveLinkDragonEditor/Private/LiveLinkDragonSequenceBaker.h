@@ -0,0 +1,50 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+
+struct FLiveLinkDragonCaptureEvent;
+
+class ULevelSequence;
+class UMovieScene3DTransformSection;
+class UMovieSceneFloatSection;
+
+/**
+ * Keys captures from Dragon sources that have baking enabled into their Level Sequence.
+ *
+ * Stop-motion cameras only change between captures, so each capture adds one stepped key per channel
+ * at its frame instead of recording every tick. Keys go in as frames are shot, nothing is ever re-baked.
+ */
+class FLiveLinkDragonSequenceBaker
+{
+public:
+
+	FLiveLinkDragonSequenceBaker();
+	~FLiveLinkDragonSequenceBaker();
+
+private:
+
+	/** Where a subject's keys go, looked up once per sequence rather than on every capture */
+	struct FBakeTarget
+	{
+		TWeakObjectPtr<ULevelSequence> Sequence;
+		TWeakObjectPtr<UMovieScene3DTransformSection> Transform;
+		TWeakObjectPtr<UMovieSceneFloatSection> FocalLength;
+		TWeakObjectPtr<UMovieSceneFloatSection> FocusDistance;
+		TWeakObjectPtr<UMovieSceneFloatSection> Aperture;
+
+		bool IsValid() const
+		{
+			return Sequence.IsValid() && Transform.IsValid() && FocalLength.IsValid() && FocusDistance.IsValid() && Aperture.IsValid();
+		}
+	};
+
+	void OnCapture(const FLiveLinkDragonCaptureEvent& Event);
+
+	bool CreateTarget(ULevelSequence* Sequence, FName SubjectName, FBakeTarget& OutTarget) const;
+
+	TMap<FName, FBakeTarget> Targets;
+	FDelegateHandle OnCaptureHandle;
+};
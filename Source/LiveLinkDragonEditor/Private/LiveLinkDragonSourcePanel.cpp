@@ -2,6 +2,10 @@
 
 #include "LiveLinkDragonSourcePanel.h"
 
+#include "SLiveLinkDragonDiagnostics.h"
+
+#include "Framework/Docking/TabManager.h"
+
 #include "IStructureDetailsView.h"
 
 #include "Modules/ModuleManager.h"
@@ -47,6 +51,15 @@ void SLiveLinkDragonSourcePanel::Construct(const FArguments& Args)
 		[
 			SNew(SHorizontalBox)
 			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.HAlign(EHorizontalAlignment::HAlign_Left)
+			[
+				SNew(SButton)
+				.Text(LOCTEXT("DiagnosticsButton", "Diagnostics"))
+				.ToolTipText(LOCTEXT("DiagnosticsButtonTooltip", "Open the live diagnostics of running Dragonframe sources"))
+				.OnClicked(this, &SLiveLinkDragonSourcePanel::OpenDiagnostics)
+			]
+			+ SHorizontalBox::Slot()
 			.FillWidth(1.f)
 			+ SHorizontalBox::Slot()
 			.AutoWidth()
@@ -86,4 +99,10 @@ FReply SLiveLinkDragonSourcePanel::CreateNewSource(bool bShouldCreateSource)
 	return FReply::Handled();
 }
 
+FReply SLiveLinkDragonSourcePanel::OpenDiagnostics()
+{
+	FGlobalTabmanager::Get()->TryInvokeTab(SLiveLinkDragonDiagnostics::TabName);
+	return FReply::Handled();
+}
+
 #undef LOCTEXT_NAMESPACE
\ No newline at end of file
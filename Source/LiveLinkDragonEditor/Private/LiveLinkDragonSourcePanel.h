@@ -19,6 +19,7 @@ class SLiveLinkDragonSourcePanel : public SCompoundWidget
 
 public:
 	FReply CreateNewSource(bool bShouldCreateSource);
+	FReply OpenDiagnostics();
 
 private:
 	FLiveLinkDragonConnectionSettings ConnectionSettings;
@@ -0,0 +1,373 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "SLiveLinkDragonDiagnostics.h"
+
+#include "Rendering/DrawElements.h"
+#include "Styling/AppStyle.h"
+
+#include "Widgets/SBoxPanel.h"
+#include "Widgets/SLeafWidget.h"
+#include "Widgets/Layout/SBorder.h"
+#include "Widgets/Layout/SScrollBox.h"
+#include "Widgets/Text/STextBlock.h"
+
+#define LOCTEXT_NAMESPACE "LiveLinkDragonDiagnostics"
+
+const FName SLiveLinkDragonDiagnostics::TabName = TEXT("LiveLinkDragonDiagnostics");
+
+static const double DiagnosticPercentiles[3] = { 0.5, 0.95, 0.99 };
+
+/** Bare line graph over a ring of samples, scaled to its own maximum */
+class SLiveLinkDragonGraph : public SLeafWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SLiveLinkDragonGraph)
+		: _Color(FLinearColor::Green)
+	{}
+		SLATE_ARGUMENT(FText, Label)
+		SLATE_ARGUMENT(FLinearColor, Color)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& Args, TSharedRef<const TArray<float>> InValues, TSharedRef<const int32> InHead)
+	{
+		Label = Args._Label;
+		Color = Args._Color;
+		Values = InValues;
+		Head = InHead;
+	}
+
+	virtual FVector2D ComputeDesiredSize(float) const override
+	{
+		return FVector2D(240.0f, 48.0f);
+	}
+
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override
+	{
+		FSlateDrawElement::MakeBox(OutDrawElements, LayerId, AllottedGeometry.ToPaintGeometry(), FAppStyle::GetBrush("ToolPanel.DarkGroupBorder"));
+
+		const TArray<float>& Samples = *Values;
+		const int32 NumSamples = Samples.Num();
+		if (NumSamples > 1)
+		{
+			float MaxValue = KINDA_SMALL_NUMBER;
+			for (float Sample : Samples)
+			{
+				MaxValue = FMath::Max(MaxValue, Sample);
+			}
+
+			const FVector2D Size = AllottedGeometry.GetLocalSize();
+			TArray<FVector2D> Points;
+			Points.Reserve(NumSamples);
+
+			// Oldest sample on the left
+			for (int32 Index = 0; Index < NumSamples; ++Index)
+			{
+				const float Sample = Samples[(*Head + Index) % NumSamples];
+				Points.Add(FVector2D(Size.X * Index / (NumSamples - 1), Size.Y * (1.0f - Sample / MaxValue)));
+			}
+
+			FSlateDrawElement::MakeLines(OutDrawElements, LayerId + 1, AllottedGeometry.ToPaintGeometry(), Points, ESlateDrawEffect::None, Color, true, 1.0f);
+
+			const FText Caption = FText::Format(LOCTEXT("GraphCaption", "{0} (max {1})"), Label, FText::AsNumber(MaxValue));
+			FSlateDrawElement::MakeText(OutDrawElements, LayerId + 2, AllottedGeometry.ToOffsetPaintGeometry(FVector2D(4.0f, 2.0f)), Caption, FAppStyle::GetFontStyle("SmallFont"), ESlateDrawEffect::None, FLinearColor::White);
+		}
+
+		return LayerId + 2;
+	}
+
+private:
+	FText Label;
+	FLinearColor Color;
+	TSharedPtr<const TArray<float>> Values;
+	TSharedPtr<const int32> Head;
+};
+
+void SLiveLinkDragonDiagnostics::FSeries::Add(float Value)
+{
+	if (Values.Num() < HistoryLength)
+	{
+		Values.Add(Value);
+		return;
+	}
+
+	Values[Head] = Value;
+	Head = (Head + 1) % Values.Num();
+}
+
+void SLiveLinkDragonDiagnostics::Construct(const FArguments& Args)
+{
+	ChildSlot
+	[
+		SNew(SScrollBox)
+		+ SScrollBox::Slot()
+		[
+			SAssignNew(SourceBox, SVerticalBox)
+		]
+	];
+
+	RebuildSourceList();
+	LastSampleTime = FPlatformTime::Seconds();
+
+	RegisterActiveTimer(SampleInterval, FWidgetActiveTimerDelegate::CreateSP(this, &SLiveLinkDragonDiagnostics::Sample));
+}
+
+EActiveTimerReturnType SLiveLinkDragonDiagnostics::Sample(double InCurrentTime, float InDeltaTime)
+{
+	if (RegistryVersion != FLiveLinkDragonMetricsRegistry::GetVersion())
+	{
+		RebuildSourceList();
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	const float Elapsed = static_cast<float>(Now - LastSampleTime);
+	LastSampleTime = Now;
+
+	for (const TSharedRef<FSourceView>& View : Sources)
+	{
+		SampleSource(*View, Elapsed);
+	}
+
+	return EActiveTimerReturnType::Continue;
+}
+
+void SLiveLinkDragonDiagnostics::SampleSource(FSourceView& View, float DeltaTime)
+{
+	const FLiveLinkDragonMetrics& Metrics = *View.Entry.Metrics;
+
+	View.Status = Metrics.Status.Read();
+	View.Device = Metrics.Device.Read();
+
+	float PacketRate = 0.0f;
+	for (int32 EventIndex = 0; EventIndex < static_cast<int32>(ELiveLinkDragonEventType::Num); ++EventIndex)
+	{
+		const uint64 Events = Metrics.EventsReceived[EventIndex].load(std::memory_order_relaxed);
+		View.EventRates[EventIndex] = DeltaTime > 0.0f ? (Events - View.PreviousEvents[EventIndex]) / DeltaTime : 0.0f;
+		View.PreviousEvents[EventIndex] = Events;
+		PacketRate += View.EventRates[EventIndex];
+	}
+
+	// Percentiles over this sample window only, by diffing the histogram against the last copy
+	auto WindowPercentiles = [](const FLiveLinkDragonLatencyHistogram& Histogram, uint64 (&Previous)[FLiveLinkDragonLatencyHistogram::NumBuckets], double (&OutPercentiles)[3])
+	{
+		uint64 Current[FLiveLinkDragonLatencyHistogram::NumBuckets];
+		Histogram.GetBuckets(Current);
+
+		uint64 Window[FLiveLinkDragonLatencyHistogram::NumBuckets];
+		uint64 WindowTotal = 0;
+		for (int32 Bucket = 0; Bucket < FLiveLinkDragonLatencyHistogram::NumBuckets; ++Bucket)
+		{
+			Window[Bucket] = Current[Bucket] - Previous[Bucket];
+			WindowTotal += Window[Bucket];
+			Previous[Bucket] = Current[Bucket];
+		}
+
+		// Keep showing the last values through quiet periods
+		if (WindowTotal > 0)
+		{
+			for (int32 Index = 0; Index < 3; ++Index)
+			{
+				OutPercentiles[Index] = FLiveLinkDragonLatencyHistogram::GetPercentile(Window, DiagnosticPercentiles[Index]);
+			}
+		}
+	};
+
+	WindowPercentiles(Metrics.ParseLatency, View.PreviousParseBuckets, View.ParsePercentiles);
+	WindowPercentiles(Metrics.ArrivalToPushLatency, View.PreviousPushBuckets, View.PushPercentiles);
+
+	View.PacketRateHistory->Add(PacketRate);
+	View.PushLatencyHistory->Add(static_cast<float>(View.PushPercentiles[2] * 1.0e3));
+}
+
+void SLiveLinkDragonDiagnostics::RebuildSourceList()
+{
+	RegistryVersion = FLiveLinkDragonMetricsRegistry::GetVersion();
+
+	TArray<TSharedRef<FSourceView>> OldSources = MoveTemp(Sources);
+	Sources.Reset();
+	SourceBox->ClearChildren();
+
+	for (const FLiveLinkDragonMetricsRegistry::FEntry& Entry : FLiveLinkDragonMetricsRegistry::GetEntries())
+	{
+		// Keep the history of sources we were already showing
+		const TSharedRef<FSourceView>* Existing = OldSources.FindByPredicate([&Entry](const TSharedRef<FSourceView>& View) { return View->Entry.SourceGuid == Entry.SourceGuid; });
+		TSharedRef<FSourceView> View = Existing ? *Existing : MakeShared<FSourceView>(Entry);
+		Sources.Add(View);
+
+		SourceBox->AddSlot()
+		.AutoHeight()
+		.Padding(4.0f)
+		[
+			BuildSourceWidget(View)
+		];
+	}
+
+	if (Sources.Num() == 0)
+	{
+		SourceBox->AddSlot()
+		.AutoHeight()
+		.Padding(4.0f)
+		[
+			SNew(STextBlock)
+			.Text(LOCTEXT("NoSources", "No Dragonframe sources are running."))
+		];
+	}
+}
+
+TSharedRef<SWidget> SLiveLinkDragonDiagnostics::BuildSourceWidget(TSharedRef<FSourceView> View)
+{
+	auto StatusText = [View]()
+	{
+		const FLiveLinkDragonStatusSnapshot& Status = View->Status;
+
+		FText Connection;
+		switch (Status.ConnectionState)
+		{
+		case ELiveLinkDragonConnectionState::Listening:	Connection = LOCTEXT("Listening", "Listening"); break;
+		case ELiveLinkDragonConnectionState::Error:		Connection = LOCTEXT("Error", "Socket error"); break;
+		default:										Connection = LOCTEXT("Stopped", "Stopped"); break;
+		}
+
+		const double Now = FPlatformTime::Seconds();
+		const double SinceLastPacket = Status.LastPacketTime > 0.0 ? Now - Status.LastPacketTime : -1.0;
+		return FText::Format(LOCTEXT("StatusLine", "{0}, session {1} for {2}s, last packet {3}s ago, {4} socket / {5} parse errors, last recovery took {6}s"),
+			Connection,
+			FText::FromString(GetDragonSessionStateName(Status.SessionState)),
+			FText::AsNumber(FMath::FloorToInt(Now - Status.SessionStateTime)),
+			SinceLastPacket >= 0.0 ? FText::AsNumber(SinceLastPacket) : LOCTEXT("Never", "-"),
+			FText::AsNumber(Status.SocketErrors),
+			FText::AsNumber(Status.ParseErrors),
+			Status.LastRecoverySeconds > 0.0f ? FText::AsNumber(Status.LastRecoverySeconds) : LOCTEXT("Never", "-"));
+	};
+
+	auto DeviceText = [View]()
+	{
+		const FLiveLinkDragonDeviceSnapshot& Device = View->Device;
+		if (!Device.bHasAppeared)
+		{
+			return LOCTEXT("NoDevice", "Nothing from Dragonframe yet");
+		}
+
+		return FText::Format(LOCTEXT("DeviceLine", "{0} / {1} / {2}   frame {3} exposure {4} ({5})   {6}{7}   API {8}-{9}"),
+			FText::FromString(FLiveLinkDragonDeviceSnapshot::ToString(Device.Production)),
+			FText::FromString(FLiveLinkDragonDeviceSnapshot::ToString(Device.Scene)),
+			FText::FromString(FLiveLinkDragonDeviceSnapshot::ToString(Device.Take)),
+			FText::AsNumber(Device.Frame),
+			FText::AsNumber(Device.Exposure),
+			FText::FromString(FLiveLinkDragonDeviceSnapshot::ToString(Device.ExposureName)),
+			FText::FromString(FLiveLinkDragonDeviceSnapshot::ToString(Device.CaptureState)),
+			Device.bReadyToCapture ? LOCTEXT("ReadyToCapture", ", ready to capture") : FText::GetEmpty(),
+			FText::AsNumber(Device.MinAPIVersion),
+			FText::AsNumber(Device.MaxAPIVersion));
+	};
+
+	auto RatesText = [View]()
+	{
+		FString Rates;
+		for (int32 EventIndex = 0; EventIndex < static_cast<int32>(ELiveLinkDragonEventType::Num); ++EventIndex)
+		{
+			Rates += FString::Printf(TEXT("%s %.1f/s   "), GetDragonEventTypeName(static_cast<ELiveLinkDragonEventType>(EventIndex)), View->EventRates[EventIndex]);
+		}
+		return FText::FromString(Rates);
+	};
+
+	auto LatencyText = [View]()
+	{
+		const FLiveLinkDragonMetrics& Metrics = *View->Entry.Metrics;
+		return FText::FromString(FString::Printf(TEXT("Parse p50/p95/p99 %.0f / %.0f / %.0f us      Arrival to push p50/p95/p99 %.0f / %.0f / %.0f us      Largest datagram %d B, %u receive buffers (peak %d in use)"),
+			View->ParsePercentiles[0] * 1.0e6, View->ParsePercentiles[1] * 1.0e6, View->ParsePercentiles[2] * 1.0e6,
+			View->PushPercentiles[0] * 1.0e6, View->PushPercentiles[1] * 1.0e6, View->PushPercentiles[2] * 1.0e6,
+			Metrics.LargestDatagram.load(std::memory_order_relaxed),
+			Metrics.ReceiveBuffersAllocated.load(std::memory_order_relaxed),
+			Metrics.ReceiveBuffersInUseHighWater.load(std::memory_order_relaxed)));
+	};
+
+	auto HealthText = [View]()
+	{
+		const FLiveLinkDragonMetrics& Metrics = *View->Entry.Metrics;
+
+		uint64 EventsCoalesced = 0;
+		for (const std::atomic<uint64>& Count : Metrics.EventsCoalesced)
+		{
+			EventsCoalesced += Count.load(std::memory_order_relaxed);
+		}
+
+		return FText::Format(LOCTEXT("HealthLine", "Lost {0}   Reordered {1}   Duplicated {2}   Stale updates dropped {3}   Filtered senders {4}   Rebinds {5}   Peer restarts {6}   Coalesced {7} (backlog peak {8})   Handler tasks dropped {9} (peak {10})   Truncated {11}"),
+			FText::AsNumber(Metrics.PacketsLost.load(std::memory_order_relaxed)),
+			FText::AsNumber(Metrics.PacketsReordered.load(std::memory_order_relaxed)),
+			FText::AsNumber(Metrics.PacketsDuplicated.load(std::memory_order_relaxed)),
+			FText::AsNumber(Metrics.StaleUpdatesDropped.load(std::memory_order_relaxed)),
+			FText::AsNumber(Metrics.PacketsFiltered.load(std::memory_order_relaxed)),
+			FText::AsNumber(Metrics.Rebinds.load(std::memory_order_relaxed)),
+			FText::AsNumber(Metrics.PeerRestarts.load(std::memory_order_relaxed)),
+			FText::AsNumber(EventsCoalesced),
+			FText::AsNumber(Metrics.BacklogHighWater.load(std::memory_order_relaxed)),
+			FText::AsNumber(Metrics.HandlerTasksDropped.load(std::memory_order_relaxed)),
+			FText::AsNumber(Metrics.HandlerTasksHighWater.load(std::memory_order_relaxed)),
+			FText::AsNumber(Metrics.PacketsTruncated.load(std::memory_order_relaxed)));
+	};
+
+	TSharedRef<FSeries> PacketRate = View->PacketRateHistory;
+	TSharedRef<FSeries> PushLatency = View->PushLatencyHistory;
+
+	return SNew(SBorder)
+		.BorderImage(FAppStyle::GetBrush("ToolPanel.GroupBorder"))
+		.Padding(6.0f)
+		[
+			SNew(SVerticalBox)
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			[
+				SNew(STextBlock)
+				.Font(FAppStyle::GetFontStyle("BoldFont"))
+				.Text(FText::FromName(View->Entry.SubjectName))
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			[
+				SNew(STextBlock).Text_Lambda(StatusText)
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			[
+				SNew(STextBlock).Text_Lambda(DeviceText)
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			[
+				SNew(STextBlock).Text_Lambda(RatesText)
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			[
+				SNew(STextBlock).Text_Lambda(LatencyText)
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			[
+				SNew(STextBlock).Text_Lambda(HealthText)
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(0.0f, 4.0f)
+			[
+				SNew(SHorizontalBox)
+				+ SHorizontalBox::Slot()
+				.FillWidth(1.0f)
+				.Padding(0.0f, 0.0f, 4.0f, 0.0f)
+				[
+					SNew(SLiveLinkDragonGraph, TSharedRef<const TArray<float>>(PacketRate, &PacketRate->Values), TSharedRef<const int32>(PacketRate, &PacketRate->Head))
+					.Label(LOCTEXT("PacketRateGraph", "Packets/s"))
+					.Color(FLinearColor(0.2f, 0.8f, 0.2f))
+				]
+				+ SHorizontalBox::Slot()
+				.FillWidth(1.0f)
+				[
+					SNew(SLiveLinkDragonGraph, TSharedRef<const TArray<float>>(PushLatency, &PushLatency->Values), TSharedRef<const int32>(PushLatency, &PushLatency->Head))
+					.Label(LOCTEXT("PushLatencyGraph", "Arrival to push p99 (ms)"))
+					.Color(FLinearColor(0.9f, 0.6f, 0.1f))
+				]
+			]
+		];
+}
+
+#undef LOCTEXT_NAMESPACE
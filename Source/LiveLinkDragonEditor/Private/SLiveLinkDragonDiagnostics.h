@@ -0,0 +1,74 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#pragma once
+
+#include "LiveLinkDragonMetrics.h"
+
+#include "Widgets/DeclarativeSyntaxSupport.h"
+#include "Widgets/SCompoundWidget.h"
+
+class SVerticalBox;
+
+/**
+ * Live view of every running Dragon source: event rates, parse and push latency, network health and handshake state.
+ *
+ * Samples the lock-free metrics on a slow active timer, never per paint, so watching it doesn't
+ * disturb the message thread.
+ */
+class SLiveLinkDragonDiagnostics : public SCompoundWidget
+{
+	SLATE_BEGIN_ARGS(SLiveLinkDragonDiagnostics) {}
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& Args);
+
+	static const FName TabName;
+
+private:
+
+	/** Ring of recent samples for one graph */
+	struct FSeries
+	{
+		TArray<float> Values;
+		int32 Head = 0;
+
+		void Add(float Value);
+	};
+
+	/** Everything we keep per source between samples */
+	struct FSourceView
+	{
+		FLiveLinkDragonMetricsRegistry::FEntry Entry;
+
+		FLiveLinkDragonStatusSnapshot Status;
+		FLiveLinkDragonDeviceSnapshot Device;
+
+		// Counters at the previous sample, to turn them into rates
+		uint64 PreviousEvents[static_cast<int32>(ELiveLinkDragonEventType::Num)] = { 0 };
+		uint64 PreviousParseBuckets[FLiveLinkDragonLatencyHistogram::NumBuckets] = { 0 };
+		uint64 PreviousPushBuckets[FLiveLinkDragonLatencyHistogram::NumBuckets] = { 0 };
+
+		float EventRates[static_cast<int32>(ELiveLinkDragonEventType::Num)] = { 0.0f };
+		double ParsePercentiles[3] = { 0.0 };
+		double PushPercentiles[3] = { 0.0 };
+
+		TSharedRef<FSeries> PacketRateHistory = MakeShared<FSeries>();
+		TSharedRef<FSeries> PushLatencyHistory = MakeShared<FSeries>();
+
+		explicit FSourceView(const FLiveLinkDragonMetricsRegistry::FEntry& InEntry) : Entry(InEntry) {}
+	};
+
+	EActiveTimerReturnType Sample(double InCurrentTime, float InDeltaTime);
+	void SampleSource(FSourceView& View, float DeltaTime);
+
+	void RebuildSourceList();
+	TSharedRef<SWidget> BuildSourceWidget(TSharedRef<FSourceView> View);
+
+	TArray<TSharedRef<FSourceView>> Sources;
+	TSharedPtr<SVerticalBox> SourceBox;
+	uint32 RegistryVersion = 0;
+	double LastSampleTime = 0.0;
+
+	static constexpr float SampleInterval = 0.25f;
+	static constexpr int32 HistoryLength = 240;
+};
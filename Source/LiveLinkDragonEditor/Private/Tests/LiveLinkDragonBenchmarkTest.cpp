@@ -0,0 +1,42 @@
+// Copyright (c) RITMPS, Rochester Institute of Technology, 2022
+
+#include "LiveLinkDragonBenchmark.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLiveLinkDragonBenchmarkTest, "LiveLinkDragon.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::CommandletContext | EAutomationTestFlags::PerfFilter)
+
+bool FLiveLinkDragonBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace LiveLinkDragonBenchmark;
+
+	const FString BaselinePath = GetBaselinePath();
+	FResults Baseline;
+	if (!LoadBaseline(BaselinePath, Baseline))
+	{
+		AddError(FString::Printf(TEXT("No readable baseline at %s, store one with -run=LiveLinkDragonBenchmark -UpdateBaseline"), *BaselinePath));
+		return false;
+	}
+
+	FResults Results;
+	FString Error;
+	if (!Run(FOptions(), Results, Error))
+	{
+		AddError(Error);
+		return false;
+	}
+
+	AddInfo(FString::Printf(TEXT("Send to push p50/p99 %.0f / %.0f us, %.1f us CPU per packet, %.0f packets/s flat out, %d lost paced, %d lost flat out"),
+		Results.SendToPushP50Microseconds, Results.SendToPushP99Microseconds, Results.CPUMicrosecondsPerPacket, Results.PacketsPerSecond, Results.PacedPacketsLost, Results.BurstPacketsLost));
+
+	for (const FString& Regression : FindRegressions(Results, Baseline, DefaultTolerance))
+	{
+		AddError(Regression);
+	}
+
+	return !HasAnyErrors();
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS